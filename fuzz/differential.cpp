@@ -0,0 +1,348 @@
+#include "differential.h"
+#include "../src/unit-file/parser/incremental_tokeniser.h"
+#include "../src/utf8/utf8_validator.h"
+
+#include <QBuffer>
+#include <QEventLoop>
+#include <QList>
+#include <QStringList>
+
+#include <cstring>
+
+bool ReaderEvent::operator==(const ReaderEvent& other) const
+{
+    return kind == other.kind && text == other.text && bytes == other.bytes && offset == other.offset && absOffset == other.absOffset;
+}
+
+/*
+ * A device which cannot seek, and which hands out at most a few bytes per read: multi-byte sequences end up split between reads.
+ */
+class PipeDevice: public QIODevice
+{
+public:
+    PipeDevice(const QByteArray& data) : m_data(data), m_pos(0) {}
+    bool isSequential(void) const Q_DECL_OVERRIDE { return true; }
+    qint64 bytesAvailable(void) const Q_DECL_OVERRIDE { return m_data.size() - m_pos + QIODevice::bytesAvailable(); }
+protected:
+    qint64 readData(char * data, qint64 maxSize) Q_DECL_OVERRIDE
+    {
+        const qint64 size = qMin(qMin(maxSize, (qint64) (m_data.size() - m_pos)), (qint64) (1 + m_pos % 7));
+        memcpy(data, m_data.constData() + m_pos, (size_t) size);
+        m_pos += size;
+        return size;
+    }
+    qint64 writeData(const char *, qint64) Q_DECL_OVERRIDE { return -1; }
+private:
+    const QByteArray m_data;
+    qint64 m_pos;
+};
+
+static void append(ReaderTranscript& transcript, ReaderEvent::Kind kind, const QString& text = QString(), const QByteArray& bytes = QByteArray(),
+                   qint64 offset = 0, qint64 absOffset = 0)
+{
+    if(!transcript.isEmpty() && transcript.last().kind == kind) {
+        ReaderEvent& last = transcript.last();
+        if(kind == ReaderEvent::Text) {
+            last.text.append(text);
+            return;
+        }
+        if(kind == ReaderEvent::Invalid && last.offset + last.bytes.size() == offset) {
+            last.bytes.append(bytes);
+            return;
+        }
+    }
+    const ReaderEvent event = { kind, text, bytes, offset, absOffset };
+    transcript.append(event);
+}
+
+static void read(UTF8Reader& reader, QIODevice& input, Device device)
+{
+    if(!input.open(QIODevice::ReadOnly)) {
+        qFatal("Unable to open the input device");
+    }
+    if(device == Stream) {
+        QEventLoop loop;
+        QList<QMetaObject::Connection> cs;
+        cs.append(QObject::connect(&reader, &UTF8Reader::done, &loop, &QEventLoop::quit));
+        cs.append(QObject::connect(&reader, &UTF8Reader::doneWithInvalidBytes, &loop, &QEventLoop::quit));
+        cs.append(QObject::connect(&reader, &UTF8Reader::failed, &loop, &QEventLoop::quit));
+        reader.start(&input);
+        loop.exec();
+        for(const QMetaObject::Connection& c: cs) {
+            QObject::disconnect(c);
+        }
+    }
+    else {
+        reader.consume(input);
+    }
+}
+
+ReaderTranscript readerTranscript(const QByteArray& input, UTF8Reader::Mode mode, UTF8Reader::Recovery recovery, Device device)
+{
+    ReaderTranscript result;
+    QString chars;
+    UTF8Reader reader(mode);
+    reader.setRecovery(recovery);
+    QObject::connect(&reader, &UTF8Reader::pushChunk, [&result](QString chunk) -> void {
+        append(result, ReaderEvent::Text, chunk);
+    });
+    // the per-character signals must report the very same text as the chunks
+    QObject::connect(&reader, &UTF8Reader::push, [&chars](QChar c) -> void {
+        chars.append(c);
+    });
+    QObject::connect(&reader, &UTF8Reader::pushPair, [&chars](QChar fst, QChar snd) -> void {
+        chars.append(fst).append(snd);
+    });
+    QObject::connect(&reader, &UTF8Reader::reportBytes, [&result](QByteArray bytes, qint64 offset, qint64 absOffset) -> void {
+        append(result, ReaderEvent::Invalid, QString(), bytes, offset, absOffset);
+    });
+    QObject::connect(&reader, &UTF8Reader::recoveryError, [&result](qint64 at) -> void {
+        append(result, ReaderEvent::RecoveryError, QString(), QByteArray(), at, at);
+    });
+    QObject::connect(&reader, &UTF8Reader::done, [&result](void) -> void {
+        append(result, ReaderEvent::Done);
+    });
+    QObject::connect(&reader, &UTF8Reader::doneWithInvalidBytes, [&result](void) -> void {
+        append(result, ReaderEvent::DoneWithInvalidBytes);
+    });
+    QObject::connect(&reader, &UTF8Reader::failed, [&result](void) -> void {
+        append(result, ReaderEvent::Failed);
+    });
+    if(device == Pipe) {
+        PipeDevice pipe(input);
+        read(reader, pipe, device);
+    }
+    else {
+        QBuffer buffer;
+        buffer.setData(input);
+        read(reader, buffer, device);
+    }
+    QString text;
+    for(const ReaderEvent& event: result) {
+        if(event.kind == ReaderEvent::Text) {
+            text.append(event.text);
+        }
+    }
+    if(chars != text) {
+        qFatal("UTF8Reader mode %d reports different text through push()/pushPair() than through pushChunk()", (int) mode);
+    }
+    return result;
+}
+
+QString describe(const ReaderTranscript& transcript)
+{
+    QStringList events;
+    for(const ReaderEvent& event: transcript) {
+        switch(event.kind) {
+            case ReaderEvent::Text:
+                events << QStringLiteral("text:") + event.text;
+                break;
+            case ReaderEvent::Invalid:
+                events << QStringLiteral("invalid:%1@%2/%3").arg(QString::fromLatin1(event.bytes.toHex())).arg(event.offset).arg(event.absOffset);
+                break;
+            case ReaderEvent::RecoveryError:
+                events << QStringLiteral("recovery error@%1").arg(event.offset);
+                break;
+            case ReaderEvent::Done:
+                events << QStringLiteral("done");
+                break;
+            case ReaderEvent::DoneWithInvalidBytes:
+                events << QStringLiteral("done with invalid bytes");
+                break;
+            case ReaderEvent::Failed:
+                events << QStringLiteral("failed");
+                break;
+        }
+    }
+    return events.join(QStringLiteral(" | "));
+}
+
+/*
+ * Records the results of UTF8Validator the way a UTF8Reader reading from a QBuffer would report them.
+ */
+class ValidatorTranscript: public UTF8Validator::Sink
+{
+public:
+    ReaderTranscript transcript;
+    void valid(const char * data, qint64 length, qint64) Q_DECL_OVERRIDE
+    {
+        append(transcript, ReaderEvent::Text, QString::fromUtf8(data, (int) length));
+    }
+    void invalid(const char * data, qint64 length, qint64 offset) Q_DECL_OVERRIDE
+    {
+        append(transcript, ReaderEvent::Invalid, QString(), QByteArray(data, (int) length), offset, offset);
+    }
+};
+
+static ReaderTranscript validatorTranscript(const QByteArray& input, UTF8Validator::Strategy strategy)
+{
+    ValidatorTranscript sink;
+    UTF8Validator validator(strategy);
+    // feed pieces of varying size, so sequences straddle the boundaries between them at every possible point
+    qint64 offset = 0;
+    for(int i = 0; offset < input.size(); ++i) {
+        const qint64 size = qMin((qint64) (1 + (i * 7) % 61), input.size() - offset);
+        validator.feed(input.constData() + offset, size, sink);
+        offset += size;
+    }
+    validator.finish(sink);
+    bool invalid = false;
+    for(const ReaderEvent& event: sink.transcript) {
+        invalid = invalid || event.kind == ReaderEvent::Invalid;
+    }
+    append(sink.transcript, invalid ? ReaderEvent::DoneWithInvalidBytes : ReaderEvent::Done);
+    return sink.transcript;
+}
+
+static void compare(const ReaderTranscript& expected, const ReaderTranscript& actual, const char * what)
+{
+    if(expected != actual) {
+        qFatal("%s differs from TextStream mode.\nExpected: %s\nGot: %s", what, qPrintable(describe(expected)), qPrintable(describe(actual)));
+    }
+}
+
+void checkReader(const QByteArray& input)
+{
+    const ReaderTranscript expected = readerTranscript(input, UTF8Reader::TextStream, UTF8Reader::Seek, Buffer);
+    compare(expected, readerTranscript(input, UTF8Reader::TextStream, UTF8Reader::Lookahead, Buffer), "TextStream mode with lookahead");
+    compare(expected, readerTranscript(input, UTF8Reader::TextStream, UTF8Reader::Seek, Pipe), "TextStream mode reading from a pipe");
+    compare(expected, readerTranscript(input, UTF8Reader::Bulk, UTF8Reader::Seek, Buffer), "Bulk mode");
+    compare(expected, readerTranscript(input, UTF8Reader::Bulk, UTF8Reader::Seek, Pipe), "Bulk mode reading from a pipe");
+    compare(expected, readerTranscript(input, UTF8Reader::Vectorised, UTF8Reader::Seek, Buffer), "Vectorised mode");
+    compare(expected, readerTranscript(input, UTF8Reader::Vectorised, UTF8Reader::Seek, Pipe), "Vectorised mode reading from a pipe");
+    compare(expected, readerTranscript(input, UTF8Reader::Bulk, UTF8Reader::Seek, Stream), "Bulk mode streaming");
+    compare(expected, readerTranscript(input, UTF8Reader::Vectorised, UTF8Reader::Seek, Stream), "Vectorised mode streaming");
+    compare(expected, validatorTranscript(input, UTF8Validator::Scalar), "The scalar validator");
+    compare(expected, validatorTranscript(input, UTF8Validator::Vectorised), "The vectorised validator");
+
+    qint64 firstInvalid = -1;
+    for(const ReaderEvent& event: expected) {
+        if(event.kind == ReaderEvent::Invalid) {
+            firstInvalid = event.offset;
+            break;
+        }
+    }
+    if(UTF8Validator::findInvalid(input.constData(), input.size()) != firstInvalid) {
+        qFatal("UTF8Validator::findInvalid() does not find the first invalid byte at %lld", firstInvalid);
+    }
+}
+
+/*
+ * Runs the Tokeniser behind a UTF8Reader. TextStream mode feeds it one character at a time, the other modes feed it chunks.
+ */
+static QVector<TokenRecord> readerTokens(const QByteArray& input, const Tokeniser::LineEnding& lineEnding, UTF8Reader::Mode mode)
+{
+    QVector<TokenRecord> result;
+    UTF8Reader reader(mode);
+    Tokeniser tk(lineEnding);
+    if(mode == UTF8Reader::TextStream) {
+        QObject::connect(&reader, &UTF8Reader::push, &tk, &Tokeniser::receive);
+        QObject::connect(&reader, &UTF8Reader::pushPair, &tk, &Tokeniser::receivePair);
+    }
+    else {
+        QObject::connect(&reader, &UTF8Reader::pushChunk, &tk, &Tokeniser::receiveChunk);
+    }
+    QObject::connect(&reader, &UTF8Reader::done, &tk, &Tokeniser::end);
+    QObject::connect(&reader, &UTF8Reader::doneWithInvalidBytes, &tk, &Tokeniser::end);
+    QObject::connect(&tk, &Tokeniser::token, [&result](const Token& token) -> void {
+        const TokenRecord record = { token.span(), token.toString() };
+        result.append(record);
+    });
+    QBuffer buffer;
+    buffer.setData(input);
+    read(reader, buffer, Buffer);
+    return result;
+}
+
+static QString describe(const TokenSpan& span, const QString& text)
+{
+    return QStringLiteral("kind %1 hint %2 flags %3 at %4:%5 offset %6 length %7: '%8'").arg(span.kind).arg(span.hint).arg(span.flags)
+        .arg(span.line).arg(span.column).arg(span.offset).arg(span.length).arg(text);
+}
+
+/*
+ * Offsets are only comparable between paths which count in the same unit: QChar for text received as QString, bytes for UTF-8.
+ */
+static bool sameSpan(const TokenSpan& a, const TokenSpan& b, bool positions)
+{
+    return a.kind == b.kind && a.hint == b.hint && a.flags == b.flags && a.literal == b.literal && a.line == b.line && a.column == b.column &&
+        (!positions || (a.offset == b.offset && a.length == b.length));
+}
+
+static void compare(const QVector<TokenRecord>& expected, const QVector<TokenRecord>& actual, bool positions, const char * what)
+{
+    for(int i = 0; i < qMin(expected.size(), actual.size()); ++i) {
+        if(!sameSpan(expected.at(i).span, actual.at(i).span, positions) || expected.at(i).text != actual.at(i).text) {
+            qFatal("%s reports a different token %d.\nExpected: %s\nGot: %s", what, i,
+                   qPrintable(describe(expected.at(i).span, expected.at(i).text)), qPrintable(describe(actual.at(i).span, actual.at(i).text)));
+        }
+    }
+    if(expected.size() != actual.size()) {
+        qFatal("%s reports %d tokens rather than %d", what, actual.size(), expected.size());
+    }
+}
+
+template<typename TextOf>
+static QVector<TokenRecord> records(const QVector<TokenSpan>& spans, TextOf textOf)
+{
+    QVector<TokenRecord> result;
+    for(const TokenSpan& span: spans) {
+        const TokenRecord record = { span, textOf(span) };
+        result.append(record);
+    }
+    return result;
+}
+
+static void compare(const QVector<ByteRange>& expected, const QVector<ByteRange>& actual, const char * what)
+{
+    bool same = expected.size() == actual.size();
+    for(int i = 0; same && i < expected.size(); ++i) {
+        same = expected.at(i).offset == actual.at(i).offset && expected.at(i).length == actual.at(i).length;
+    }
+    if(!same) {
+        qFatal("%s reports different runs of invalid bytes than UTF8Reader", what);
+    }
+}
+
+void checkTokeniser(const QByteArray& input, const Tokeniser::LineEnding& lineEnding)
+{
+    const QVector<TokenRecord> expected = readerTokens(input, lineEnding, UTF8Reader::TextStream);
+    compare(expected, readerTokens(input, lineEnding, UTF8Reader::Vectorised), true, "The Tokeniser fed in chunks");
+
+    // the text and invalid bytes as the reference reader sees them
+    QString text;
+    QVector<ByteRange> invalid;
+    for(const ReaderEvent& event: readerTranscript(input, UTF8Reader::TextStream, UTF8Reader::Seek, Buffer)) {
+        if(event.kind == ReaderEvent::Text) {
+            text.append(event.text);
+        }
+        else if(event.kind == ReaderEvent::Invalid) {
+            const ByteRange range = { (quint32) event.offset, (quint32) event.bytes.size() };
+            invalid.append(range);
+        }
+    }
+
+    compare(expected, records(Tokeniser::tokenise(text, lineEnding), [&text](const TokenSpan& span) -> QString {
+        return Tokeniser::text(text, span);
+    }), true, "Tokeniser::tokenise() on UTF-16");
+
+    QVector<ByteRange> batchInvalid;
+    const QVector<TokenSpan> batch = Tokeniser::tokenise(input, lineEnding, &batchInvalid);
+    const auto utf8Text = [&input](const TokenSpan& span) -> QString {
+        return Tokeniser::text(input, span);
+    };
+    compare(expected, records(batch, utf8Text), false, "Tokeniser::tokenise() on UTF-8");
+    compare(invalid, batchInvalid, "Tokeniser::tokenise() on UTF-8");
+
+    // IncrementalTokeniser must agree with Tokeniser::tokenise() to the byte, whether it tokenised the document in one go or after an edit
+    IncrementalTokeniser incremental(lineEnding);
+    incremental.setText(input);
+    compare(records(batch, utf8Text), records(incremental.tokens(), utf8Text), true, "IncrementalTokeniser");
+    compare(invalid, incremental.invalidBytes(), "IncrementalTokeniser");
+
+    const int from = input.size() / 3, to = 2 * input.size() / 3;
+    incremental.setText(input.left(from) + input.mid(to));
+    incremental.edit(from, 0, input.mid(from, to - from));
+    compare(records(batch, utf8Text), records(incremental.tokens(), utf8Text), true, "IncrementalTokeniser after an edit");
+    compare(invalid, incremental.invalidBytes(), "IncrementalTokeniser after an edit");
+}
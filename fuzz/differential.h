@@ -0,0 +1,70 @@
+#ifndef SD_UIKIT_FUZZ_DIFFERENTIAL
+#define SD_UIKIT_FUZZ_DIFFERENTIAL
+
+/*
+ * Differential checks shared by the fuzz targets. Each check runs the reference path (UTF8Reader in TextStream mode, feeding the Tokeniser
+ * one character at a time) and every optimised path over the same input, and aborts through qFatal() on the first difference found,
+ * which is what libFuzzer picks up as a crash.
+ */
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include "../src/unit-file/parser/token.h"
+#include "../src/unit-file/parser/tokeniser.h"
+#include "../src/utf8/utf8_reader.h"
+
+/*
+ * Something reported by a UTF8Reader. Adjacent runs of text (and of invalid bytes) are merged, so readers which report text in different
+ * sized chunks compare equal as long as they report the same text.
+ */
+struct ReaderEvent
+{
+    enum Kind {
+        Text, Invalid, RecoveryError, Done, DoneWithInvalidBytes, Failed
+    };
+    Kind kind;
+    QString text;
+    QByteArray bytes;
+    qint64 offset;
+    qint64 absOffset;
+    bool operator==(const ReaderEvent& other) const;
+};
+
+typedef QVector<ReaderEvent> ReaderTranscript;
+
+/*
+ * How the input is presented to the reader.
+ */
+enum Device {
+    Buffer, /* a QBuffer, which supports seeking */
+    Pipe, /* a sequential device, which hands out data in small pieces */
+    Stream /* a QBuffer read through UTF8Reader::start() rather than UTF8Reader::consume() */
+};
+
+ReaderTranscript readerTranscript(const QByteArray& input, UTF8Reader::Mode mode, UTF8Reader::Recovery recovery, Device device);
+QString describe(const ReaderTranscript& transcript);
+
+/*
+ * A token along with its text, as reported through Tokeniser::token().
+ */
+struct TokenRecord
+{
+    TokenSpan span;
+    QString text;
+};
+
+/*
+ * Compares UTF8Reader in all its modes, on all kinds of devices, against TextStream mode reading from a QBuffer,
+ * and UTF8Validator (fed in arbitrary pieces) in both its strategies against that as well.
+ */
+void checkReader(const QByteArray& input);
+
+/*
+ * Compares the Tokeniser fed in chunks, Tokeniser::tokenise() on both UTF-16 and UTF-8 and IncrementalTokeniser against
+ * the Tokeniser fed one character at a time by a UTF8Reader in TextStream mode.
+ */
+void checkTokeniser(const QByteArray& input, const Tokeniser::LineEnding& lineEnding);
+
+#endif
@@ -0,0 +1,49 @@
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QtDebug>
+
+/*
+ * Stands in for libFuzzer with compilers which do not have it: runs the fuzz target once for each file given on the command line
+ * (directories are read recursively), e.g. to check the seed corpus or to reproduce a crash found elsewhere.
+ */
+
+extern "C" int LLVMFuzzerInitialize(int * argc, char *** argv);
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t * data, size_t size);
+
+static bool run(const QString& fileName)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Unable to read:" << fileName;
+        return false;
+    }
+    const QByteArray data = file.readAll();
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t *>(data.constData()), (size_t) data.size());
+    return true;
+}
+
+int main(int argc, char ** argv)
+{
+    LLVMFuzzerInitialize(&argc, &argv);
+    const QStringList args = QCoreApplication::arguments().mid(1);
+    int inputs = 0;
+    bool ok = true;
+    for(const QString& arg: args) {
+        if(QFileInfo(arg).isDir()) {
+            QDirIterator it(arg, QDir::Files, QDirIterator::Subdirectories);
+            while(it.hasNext()) {
+                ok = run(it.next()) && ok;
+                ++inputs;
+            }
+        }
+        else {
+            ok = run(arg) && ok;
+            ++inputs;
+        }
+    }
+    qDebug() << "Replayed" << inputs << "inputs without finding differences.";
+    return ok && inputs > 0 ? 0 : 2;
+}
@@ -0,0 +1,27 @@
+#include "differential.h"
+
+#include <QCoreApplication>
+
+/*
+ * Fuzzes the Tokeniser: every way of tokenising must report exactly what the Tokeniser reports when fed one character at a time,
+ * for every kind of line ending.
+ */
+
+extern "C" int LLVMFuzzerInitialize(int * argc, char *** argv)
+{
+    static QCoreApplication app(*argc, *argv);
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t * data, size_t size)
+{
+    if(size > 65536) {
+        return 0;
+    }
+    const QByteArray input(reinterpret_cast<const char *>(data), (int) size);
+    checkTokeniser(input, Tokeniser::LF);
+    checkTokeniser(input, Tokeniser::CR);
+    checkTokeniser(input, Tokeniser::CRLF);
+    checkTokeniser(input, Tokeniser::Both);
+    return 0;
+}
@@ -0,0 +1,24 @@
+#include "differential.h"
+
+#include <QCoreApplication>
+
+/*
+ * Fuzzes UTF8Reader: every mode, on every kind of device, must report exactly what TextStream mode reports.
+ * The event loop is needed for UTF8Reader::start().
+ */
+
+extern "C" int LLVMFuzzerInitialize(int * argc, char *** argv)
+{
+    static QCoreApplication app(*argc, *argv);
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t * data, size_t size)
+{
+    // TextStream mode seeks back for every invalid byte: keep inputs small enough for that to stay quick
+    if(size > 65536) {
+        return 0;
+    }
+    checkReader(QByteArray(reinterpret_cast<const char *>(data), (int) size));
+    return 0;
+}
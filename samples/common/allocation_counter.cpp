@@ -0,0 +1,54 @@
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+
+extern "C" {
+    void * __libc_malloc(size_t size);
+    void * __libc_calloc(size_t count, size_t size);
+    void * __libc_realloc(void * ptr, size_t size);
+}
+
+/*
+ * Allocations are counted in every thread, e.g. that of a JournalReader, so both are atomic. Relaxed ordering is enough, as samples wait for
+ * those threads before stopping.
+ */
+static std::atomic<bool> counting(false);
+static std::atomic<qint64> allocations(0);
+
+static void countAllocation(void)
+{
+    if(counting.load(std::memory_order_relaxed)) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+extern "C" void * malloc(size_t size)
+{
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+extern "C" void * calloc(size_t count, size_t size)
+{
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+extern "C" void * realloc(void * ptr, size_t size)
+{
+    countAllocation();
+    return __libc_realloc(ptr, size);
+}
+
+void AllocationCounter::start(void)
+{
+    allocations.store(0, std::memory_order_relaxed);
+    counting.store(true, std::memory_order_relaxed);
+}
+
+qint64 AllocationCounter::stop(void)
+{
+    counting.store(false, std::memory_order_relaxed);
+    return allocations.load(std::memory_order_relaxed);
+}
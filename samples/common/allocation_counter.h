@@ -0,0 +1,21 @@
+#ifndef SD_UIKIT_SAMPLES_ALLOCATION_COUNTER
+#define SD_UIKIT_SAMPLES_ALLOCATION_COUNTER
+
+#include <QtGlobal>
+
+/**
+ * \brief Counts heap allocations made by the current process, in any of its threads, while counting is switched on.
+ * Works by interposing the C allocator, which is what both operator new and Qt containers end up calling.
+ * This relies on glibc, which is a given on systemd based systems. Link allocation_counter.cpp into the sample to use it.
+ */
+namespace AllocationCounter
+{
+    void start(void);
+    /**
+     * \brief stops counting.
+     * \return the number of allocations since #start()
+     */
+    qint64 stop(void);
+}
+
+#endif
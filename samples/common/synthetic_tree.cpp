@@ -0,0 +1,123 @@
+#include "synthetic_tree.h"
+
+#include <QDir>
+#include <QFile>
+#include <QtDebug>
+
+#include <cstring>
+
+const char * const SyntheticTree::serviceTemplate =
+    "# Generated unit %1\n"
+    "[Unit]\n"
+    "Description=Synthetic service number %1\n"
+    "Documentation=man:synthetic(8)\n"
+    "After=network.target remote-fs.target \\\n"
+    "    nss-lookup.target\n"
+    "Wants=network.target\n"
+    "\n"
+    "[Service]\n"
+    "Type=simple\n"
+    "ExecStart=/usr/bin/synthetic --instance=%1 --verbose\n"
+    "Restart=on-failure\n"
+    "RestartSec=5\n"
+    "Environment=LANG=C.UTF-8\n"
+    "\n"
+    "[Install]\n"
+    "WantedBy=multi-user.target\n";
+
+static const char * const dropInTemplate =
+    "[Service]\n"
+    "Environment=OVERRIDE=%1\n";
+
+int SyntheticTree::files(const QStringList& args)
+{
+    const int files = args.size() > 1 ? args.at(1).toInt() : defaultFiles;
+    return files < 100 ? defaultFiles : files;
+}
+
+bool SyntheticTree::writeFile(const QString& path, const QString& text)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(text.toUtf8()) >= 0;
+}
+
+bool SyntheticTree::create(const QString& root, int files, Expected& expected)
+{
+    QDir dir(root);
+    if(!dir.mkpath(QStringLiteral("etc")) || !dir.mkpath(QStringLiteral("run")) || !dir.mkpath(QStringLiteral("usr"))) {
+        return false;
+    }
+    const int units = files * 8 / 10;
+    const int overrides = files * 15 / 100;
+    const int dropIns = files - units - overrides;
+    for(int i = 0; i < units; ++i) {
+        if(!writeFile(QStringLiteral("%1/usr/synthetic-%2.service").arg(root).arg(i), QString::fromLatin1(serviceTemplate).arg(i))) {
+            return false;
+        }
+    }
+    for(int i = 0; i < overrides; ++i) {
+        const QString path = QStringLiteral("%1/etc/synthetic-%2.service").arg(root).arg(i * 3);
+        bool ok = i % 10 == 0 ? QFile::link(QStringLiteral("/dev/null"), path) : writeFile(path, QString::fromLatin1(serviceTemplate).arg(i * 3));
+        if(!ok) {
+            return false;
+        }
+    }
+    for(int i = 0; i < dropIns; ++i) {
+        const QString unitDir = QStringLiteral("run/synthetic-%1.service.d").arg(i * 2);
+        if(!dir.mkpath(unitDir) || !writeFile(QStringLiteral("%1/%2/override.conf").arg(root).arg(unitDir), QString::fromLatin1(dropInTemplate).arg(i))) {
+            return false;
+        }
+    }
+    expected.entries = units + overrides + dropIns;
+    expected.units = units;
+    return true;
+}
+
+QStringList SyntheticTree::searchPaths(const QString& root)
+{
+    return QStringList() << root + QStringLiteral("/etc") << root + QStringLiteral("/run") << root + QStringLiteral("/usr");
+}
+
+int SyntheticTree::verify(const UnitFileIndex& index, const Expected& expected)
+{
+    int result = 0;
+    if(index.size() != expected.entries) {
+        qDebug() << "Expected" << expected.entries << "entries but found" << index.size() << "\t[failed]";
+        result |= 1;
+    }
+    if(index.units().size() != expected.units) {
+        qDebug() << "Expected" << expected.units << "units but found" << index.units().size() << "\t[failed]";
+        result |= 1;
+    }
+    const int overridden = index.unit(QStringLiteral("synthetic-3.service"));
+    if(overridden < 0 || index.at(overridden).priority != 0) {
+        qDebug() << "The unit file in etc/ should take precedence over the one in usr/" << "\t[failed]";
+        result |= 1;
+    }
+    const int masked = index.unit(QStringLiteral("synthetic-0.service"));
+    if(masked < 0 || index.at(masked).kind != UnitFileEntry::Masked) {
+        qDebug() << "The unit masked in etc/ should be reported as such" << "\t[failed]";
+        result |= 1;
+    }
+    if(index.dropIns(QStringLiteral("synthetic-2.service")).size() != 1) {
+        qDebug() << "Expected a drop-in for synthetic-2.service" << "\t[failed]";
+        result |= 1;
+    }
+    return result;
+}
+
+bool SyntheticTree::sameEntries(const UnitFileIndex& a, const UnitFileIndex& b)
+{
+    if(a.size() != b.size()) {
+        return false;
+    }
+    for(int i = 0; i < a.size(); ++i) {
+        const UnitFileEntry& x = a.at(i);
+        const UnitFileEntry& y = b.at(i);
+        if(x.path != y.path || x.kind != y.kind || x.content != y.content || x.tokens.size() != y.tokens.size() ||
+            (!x.tokens.isEmpty() && memcmp(x.tokens.constData(), y.tokens.constData(), x.tokens.size() * sizeof(TokenSpan)) != 0)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef SD_UIKIT_SAMPLES_SYNTHETIC_TREE
+#define SD_UIKIT_SAMPLES_SYNTHETIC_TREE
+
+#include "../../src/unit-file/loader/unit_file_index.h"
+
+#include <QString>
+#include <QStringList>
+
+/**
+ * \brief Generates a synthetic tree of unit files resembling a (very) large system, for the samples which load unit files.
+ * Most units live in usr/, some are overridden in etc/ (a few of them masked) and some get a drop-in in run/. Every unit is generated from
+ * #serviceTemplate. Link synthetic_tree.cpp into the sample to use it.
+ */
+namespace SyntheticTree
+{
+    /**
+     * \brief the number of files generated unless a sample is told otherwise.
+     */
+    const int defaultFiles = 50000;
+    /**
+     * \brief the text of every generated unit, with %1 standing for its number.
+     */
+    extern const char * const serviceTemplate;
+
+    struct Expected {
+        int entries;
+        int units;
+    };
+
+    /**
+     * \brief the number of files to generate, as given by the first argument of the sample or #defaultFiles.
+     */
+    int files(const QStringList& args);
+    bool writeFile(const QString& path, const QString& text);
+    /**
+     * \brief generates a tree of files below root.
+     * \param expected set to the number of entries and units which loading the tree should find.
+     */
+    bool create(const QString& root, int files, Expected& expected);
+    /**
+     * \brief the search paths to load the tree below root with, most important first.
+     */
+    QStringList searchPaths(const QString& root);
+    /**
+     * \brief checks that an index of the tree has the expected entries, and that overrides, masks and drop-ins were found.
+     * \return 0 on success, 1 otherwise.
+     */
+    int verify(const UnitFileIndex& index, const Expected& expected);
+    /**
+     * \brief whether two indices have the same entries, with the same content and tokens.
+     */
+    bool sameEntries(const UnitFileIndex& a, const UnitFileIndex& b);
+}
+
+#endif
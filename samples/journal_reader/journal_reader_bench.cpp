@@ -0,0 +1,167 @@
+#include "../../src/journal/journal_reader.h"
+#include "../../src/journal/journal_ring.h"
+#include "../common/allocation_counter.h"
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QtDebug>
+#include <QTimer>
+#include <QCoreApplication>
+
+/*
+ * Generates journal files with systemd-journal-remote, then reads the last entries of one unit from them into a JournalRing, the way
+ * showing "the last 100k lines of nginx.service" would.
+ * Usage: journal_reader_bench [number of entries]
+ *
+ * Apart from reporting numbers, this checks that the right entries end up in the ring, that reading may be resumed from a cursor and that
+ * reading does not allocate per entry.
+ */
+
+static const int defaultEntries = 300000;
+static const int ringCapacity = 100000;
+static const double allocationBudget = 0.1; // per entry
+static const qint64 startTime = Q_INT64_C(1500000000000000); // usec since the epoch
+
+/*
+ * Writes entries in the journal export format to systemd-journal-remote, which turns them into a journal file. Two out of three entries
+ * are logged by nginx.service, numbered from first on; the others by another unit.
+ */
+bool generate(const QString& remote, const QString& file, int first, int entries)
+{
+    QProcess process;
+    process.start(remote, QStringList() << QStringLiteral("--split-mode=none") << QStringLiteral("--output=") + file << QStringLiteral("-"));
+    if(!process.waitForStarted()) {
+        return false;
+    }
+    QByteArray chunk;
+    for(int i = 0; i < entries; ++i) {
+        const int entry = first + i;
+        const bool nginx = entry % 3 != 2;
+        chunk += "__REALTIME_TIMESTAMP=" + QByteArray::number(startTime + (qint64) entry * 1000) + "\n"
+                 "__MONOTONIC_TIMESTAMP=" + QByteArray::number((qint64) entry * 1000 + 1) + "\n"
+                 "_BOOT_ID=0123456789abcdef0123456789abcdef\n"
+                 "_SYSTEMD_UNIT=" + (nginx ? "nginx.service" : "other.service") + "\n"
+                 "SYSLOG_IDENTIFIER=" + (nginx ? "nginx" : "other") + "\n"
+                 "_PID=" + QByteArray::number(1000 + entry % 7) + "\n"
+                 "PRIORITY=" + QByteArray::number(entry % 8) + "\n"
+                 "MESSAGE=" + (nginx ? "GET /index.html HTTP/1.1 request " : "unrelated ") + QByteArray::number(entry) + "\n\n";
+        if(chunk.size() > 1024 * 1024 || i == entries - 1) {
+            process.write(chunk);
+            process.waitForBytesWritten(-1);
+            chunk.clear();
+        }
+    }
+    process.closeWriteChannel();
+    return process.waitForFinished(-1) && process.exitCode() == 0;
+}
+
+/*
+ * Runs the event loop until the reader caught up with the journal.
+ */
+bool waitForReader(JournalReader& reader)
+{
+    QEventLoop loop;
+    bool caughtUp = false;
+    QObject::connect(&reader, &JournalReader::caughtUp, &loop, [&loop, &caughtUp]() -> void {
+        caughtUp = true;
+        loop.quit();
+    });
+    QObject::connect(&reader, &JournalReader::failed, &loop, [&loop](int error) -> void {
+        qDebug() << "Reading the journal failed with error" << error;
+        loop.quit();
+    });
+    QTimer::singleShot(60000, &loop, SLOT(quit()));
+    loop.exec();
+    reader.stop();
+    return caughtUp;
+}
+
+QByteArray expectedMessage(int entry)
+{
+    return "GET /index.html HTTP/1.1 request " + QByteArray::number(entry);
+}
+
+/*
+ * The number of the last entry logged by nginx.service before end.
+ */
+int lastNginxEntry(int end)
+{
+    return (end - 1) % 3 == 2 ? end - 2 : end - 1;
+}
+
+int runBenchmark(int entries)
+{
+    QTemporaryDir tmp;
+    const QString remote = QStandardPaths::findExecutable(QStringLiteral("systemd-journal-remote"),
+                                                          QStringList() << QStringLiteral("/usr/lib/systemd") << QStringLiteral("/lib/systemd"));
+    qDebug() << "Generating" << entries << "journal entries ...";
+    if(!tmp.isValid() || remote.isEmpty() || !generate(remote, tmp.path() + QStringLiteral("/history.journal"), 0, entries)) {
+        qDebug() << "Failed to generate the journal files! systemd-journal-remote is needed to do so.";
+        return 2;
+    }
+    int result = 0;
+    JournalRing ring(ringCapacity);
+    JournalReader reader(&ring);
+    reader.setDirectory(tmp.path());
+    reader.setUnit(QStringLiteral("nginx.service"));
+    reader.setFollow(false);
+
+    QElapsedTimer timer;
+    timer.start();
+    AllocationCounter::start();
+    reader.start(ringCapacity);
+    const bool caughtUp = waitForReader(reader);
+    const qint64 allocations = AllocationCounter::stop();
+    const qint64 elapsed = qMax(Q_INT64_C(1), timer.nsecsElapsed() / 1000);
+    qDebug() << "journal: entries:" << ring.size() << "time (ms):" << elapsed / 1000 << "entries/s:" << (qint64) ring.size() * 1000000 / elapsed
+             << "allocations per entry:" << (double) allocations / qMax(1, ring.size()) << "ring footprint (MB):" << ring.footprint() / (1024 * 1024);
+    const int last = lastNginxEntry(entries);
+    if(!caughtUp || ring.size() != ringCapacity || ring.message(ring.end() - 1).toUtf8() != expectedMessage(last) ||
+        ring.identifier(ring.first()) != QStringLiteral("nginx")) {
+        qDebug() << "Expected the last" << ringCapacity << "entries of nginx.service, ending with" << expectedMessage(last) << "\t[failed]";
+        result |= 1;
+    }
+    for(qint64 entry = ring.first() + 1; entry < ring.end(); ++entry) {
+        if(ring.record(entry).realtime <= ring.record(entry - 1).realtime) {
+            qDebug() << "Entries are out of order at" << entry << "\t[failed]";
+            result |= 1;
+            break;
+        }
+    }
+    if((double) allocations / qMax(1, ring.size()) > allocationBudget) {
+        qDebug() << "Reading allocated more than" << allocationBudget << "times per entry" << "\t[failed]";
+        result |= 1;
+    }
+
+    // more entries are logged (to a new file): reading on from the cursor should yield just those
+    const QByteArray cursor = reader.cursor();
+    const qint64 end = ring.end();
+    const int more = 3000;
+    if(!generate(remote, tmp.path() + QStringLiteral("/more.journal"), entries, more)) {
+        qDebug() << "Failed to generate the journal files! systemd-journal-remote is needed to do so.";
+        return 2;
+    }
+    reader.start(cursor);
+    if(!waitForReader(reader) || ring.end() - end != 2 * more / 3 || ring.message(ring.end() - 1).toUtf8() != expectedMessage(lastNginxEntry(entries + more))) {
+        qDebug() << "Expected" << 2 * more / 3 << "new entries after the cursor but found" << ring.end() - end << "\t[failed]";
+        result |= 1;
+    }
+    qDebug() << (result ? "Test failed." : "Test succeeded.");
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    const QStringList args = app.arguments();
+    int entries = args.size() > 1 ? args.at(1).toInt() : defaultEntries;
+    if(entries < 3 * ringCapacity / 2) {
+        entries = defaultEntries;
+    }
+    QTimer::singleShot(0, [entries]() {
+        QCoreApplication::exit(runBenchmark(entries));
+    });
+    return app.exec();
+}
@@ -0,0 +1,342 @@
+#include "../../src/utf8/utf8_reader.h"
+#include "../../src/unit-file/parser/tokeniser.h"
+#include "../common/allocation_counter.h"
+#include <functional>
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QtDebug>
+#include <QTimer>
+#include <QCoreApplication>
+
+/*
+ * Measures throughput and allocations of the UTF-8 reader and the tokeniser, separately and end-to-end, over generated corpora.
+ * Usage: pipeline_bench [scale]
+ *
+ * Apart from reporting numbers, this checks the paths which are meant to be allocation free against a budget:
+ * the exit code is non-zero if they allocate more than allowed. The budget only applies to corpora of large files,
+ * where the cost of setting up a reader or tokeniser per file does not dominate.
+ */
+
+static const qint64 minimumTime = 500 * 1000 * 1000; // ns spent per measurement, at least
+static const int minimumRuns = 3;
+static const double allocationBudget = 0.1; // per token
+
+struct Corpus
+{
+    QString name;
+    QList<QByteArray> files;
+    qint64 bytes;
+};
+
+struct Result
+{
+    qint64 nsecs;
+    qint64 tokens;
+    qint64 allocations;
+};
+
+typedef std::function<qint64(const QByteArray&)> Stage;
+
+/*
+ * A simple deterministic generator, so every run uses the same corpora.
+ */
+class Random
+{
+public:
+    Random(quint32 seed) : m_state(seed) {}
+    quint32 next(void)
+    {
+        m_state = m_state * 1103515245u + 12345u;
+        return m_state >> 8;
+    }
+private:
+    quint32 m_state;
+};
+
+static const char * const unitTemplate =
+    "# Generated unit %1\n"
+    "[Unit]\n"
+    "Description=Synthetic service number %1\n"
+    "After=network.target remote-fs.target\n"
+    "Wants=network.target\n"
+    "\n"
+    "[Service]\n"
+    "Type=simple\n"
+    "ExecStart=/usr/bin/synthetic --instance=%1 --verbose\n"
+    "Restart=on-failure\n"
+    "Environment=LANG=C.UTF-8\n"
+    "\n"
+    "[Install]\n"
+    "WantedBy=multi-user.target\n";
+
+Corpus smallFiles(int scale)
+{
+    Corpus c;
+    c.name = QStringLiteral("small files");
+    for(int i = 0; i < 4000 * scale; ++i) {
+        c.files << QString::fromLatin1(unitTemplate).arg(i).toUtf8();
+    }
+    return c;
+}
+
+Corpus longContinuations(int scale)
+{
+    Corpus c;
+    c.name = QStringLiteral("long continuations");
+    QByteArray text("[Service]\n");
+    for(int i = 0; i < 400 * scale; ++i) {
+        text.append("ExecStart=/usr/bin/synthetic \\\n");
+        for(int k = 0; k < 200; ++k) {
+            text.append("    --option-number-").append(QByteArray::number(k)).append("=some-value \\\n");
+        }
+        text.append("    --last\n");
+    }
+    c.files << text;
+    return c;
+}
+
+Corpus nonAscii(int scale)
+{
+    Corpus c;
+    c.name = QStringLiteral("non-ASCII");
+    QString text;
+    for(int i = 0; i < 20000 * scale; ++i) {
+        text.append(QStringLiteral("# Комментарий номер %1, ελληνικά και 日本語のテキスト\n").arg(i));
+        text.append(QStringLiteral("[Unit]\nDescription=Dienst für Übersetzungen — 服务 %1 \U0001F680\U0001F30D\n").arg(i));
+        text.append(QStringLiteral("Documentation=https://例え.jp/ドキュメント\n"));
+    }
+    c.files << text.toUtf8();
+    return c;
+}
+
+Corpus malformed(int scale)
+{
+    static const char invalid[] = { '\xFF', '\xC0', '\x80', '\xE2', '\xF4', '\xED' };
+    Corpus c;
+    c.name = QStringLiteral("malformed");
+    Random rnd(42);
+    for(int i = 0; i < 4000 * scale; ++i) {
+        QByteArray file = QString::fromLatin1(unitTemplate).arg(i).toUtf8();
+        // corrupt roughly 5% of the bytes
+        for(int k = 0; k < file.size(); ++k) {
+            if(rnd.next() % 20 == 0) {
+                file[k] = invalid[rnd.next() % sizeof(invalid)];
+            }
+        }
+        c.files << file;
+    }
+    return c;
+}
+
+void finishCorpus(Corpus& c)
+{
+    c.bytes = 0;
+    for(const QByteArray& f: c.files) {
+        c.bytes += f.size();
+    }
+}
+
+qint64 runOnce(const Corpus& c, const Stage& stage)
+{
+    qint64 tokens = 0;
+    for(const QByteArray& f: c.files) {
+        tokens += stage(f);
+    }
+    return tokens;
+}
+
+Result measure(const Corpus& c, const Stage& stage)
+{
+    Result r;
+    // warm up, and count allocations for a single pass
+    AllocationCounter::start();
+    r.tokens = runOnce(c, stage);
+    r.allocations = AllocationCounter::stop();
+
+    r.nsecs = -1;
+    qint64 total = 0;
+    for(int runs = 0; runs < minimumRuns || total < minimumTime; ++runs) {
+        QElapsedTimer timer;
+        timer.start();
+        runOnce(c, stage);
+        const qint64 elapsed = timer.nsecsElapsed();
+        total += elapsed;
+        if(r.nsecs < 0 || elapsed < r.nsecs) {
+            r.nsecs = elapsed;
+        }
+    }
+    r.nsecs = qMax(Q_INT64_C(1), r.nsecs);
+    return r;
+}
+
+/*
+ * Reader stages count the UTF-16 code units they decode in place of tokens, so their per-token columns are per code unit.
+ */
+qint64 readerStage(const QByteArray& file, const UTF8Reader::Mode& mode)
+{
+    qint64 units = 0;
+    QBuffer buf;
+    buf.setData(file);
+    buf.open(QIODevice::ReadOnly);
+    UTF8Reader reader(mode);
+    if(mode == UTF8Reader::TextStream) {
+        QObject::connect(&reader, &UTF8Reader::push, [&units](QChar) -> void { ++units; });
+        QObject::connect(&reader, &UTF8Reader::pushPair, [&units](QChar, QChar) -> void { units += 2; });
+    }
+    else {
+        QObject::connect(&reader, &UTF8Reader::pushChunk, [&units](QString chunk) -> void { units += chunk.size(); });
+    }
+    reader.consume(buf);
+    return units;
+}
+
+qint64 tokeniserStage(const QString& text)
+{
+    qint64 tokens = 0;
+    Tokeniser tk(Tokeniser::LF);
+    QObject::connect(&tk, &Tokeniser::token, [&tokens](const Token&) -> void { ++tokens; });
+    tk.receiveChunk(text);
+    tk.end();
+    return tokens;
+}
+
+/*
+ * The way the tokeniser has been used all along: one character at a time, with all string based signals connected.
+ */
+void connectStringSignals(Tokeniser& tk, qint64& tokens)
+{
+    auto count = [&tokens](int, int, QString) -> void { ++tokens; };
+    auto countHinted = [&tokens](int, int, QString, int) -> void { ++tokens; };
+    QObject::connect(&tk, &Tokeniser::key, count);
+    QObject::connect(&tk, &Tokeniser::value, count);
+    QObject::connect(&tk, &Tokeniser::section, count);
+    QObject::connect(&tk, &Tokeniser::comment, count);
+    QObject::connect(&tk, &Tokeniser::include, count);
+    QObject::connect(&tk, &Tokeniser::space, countHinted);
+    QObject::connect(&tk, &Tokeniser::syntaxError, countHinted);
+}
+
+qint64 tokeniserSignalsStage(const QString& text)
+{
+    qint64 tokens = 0;
+    Tokeniser tk(Tokeniser::LF);
+    connectStringSignals(tk, tokens);
+    for(int i = 0; i < text.size(); ++i) {
+        if(text[i].isHighSurrogate() && i + 1 < text.size()) {
+            tk.receivePair(text[i], text[i + 1]);
+            ++i;
+        }
+        else {
+            tk.receive(text[i]);
+        }
+    }
+    tk.end();
+    return tokens;
+}
+
+qint64 endToEndLegacy(const QByteArray& file)
+{
+    qint64 tokens = 0;
+    QBuffer buf;
+    buf.setData(file);
+    buf.open(QIODevice::ReadOnly);
+    UTF8Reader reader(UTF8Reader::TextStream);
+    Tokeniser tk(Tokeniser::LF);
+    connectStringSignals(tk, tokens);
+    QObject::connect(&reader, &UTF8Reader::push, &tk, &Tokeniser::receive);
+    QObject::connect(&reader, &UTF8Reader::pushPair, &tk, &Tokeniser::receivePair);
+    reader.consume(buf);
+    tk.end();
+    return tokens;
+}
+
+qint64 endToEndChunked(const QByteArray& file)
+{
+    qint64 tokens = 0;
+    QBuffer buf;
+    buf.setData(file);
+    buf.open(QIODevice::ReadOnly);
+    UTF8Reader reader(UTF8Reader::Vectorised);
+    Tokeniser tk(Tokeniser::LF);
+    QObject::connect(&tk, &Tokeniser::token, [&tokens](const Token&) -> void { ++tokens; });
+    QObject::connect(&reader, &UTF8Reader::pushChunk, &tk, &Tokeniser::receiveChunk);
+    reader.consume(buf);
+    tk.end();
+    return tokens;
+}
+
+int runBenchmarks(int scale)
+{
+    QTextStream out(stdout);
+    int result = 0;
+    QList<Corpus> corpora;
+    corpora << smallFiles(scale) << longContinuations(scale) << nonAscii(scale) << malformed(scale);
+
+    out << QStringLiteral("%1 %2 %3 %4 %5\n")
+        .arg(QStringLiteral("corpus"), -20).arg(QStringLiteral("stage"), -22).arg(QStringLiteral("MB/s"), 10)
+        .arg(QStringLiteral("Mtokens/s"), 10).arg(QStringLiteral("allocs/token"), 13);
+    out.flush();
+
+    for(Corpus& c: corpora) {
+        finishCorpus(c);
+        // the tokeniser on its own is fed text which has been decoded up front
+        QList<QString> texts;
+        for(const QByteArray& f: c.files) {
+            texts << QString::fromUtf8(f);
+        }
+        int next = 0;
+        auto decodedText = [&texts, &next](void) -> const QString& {
+            const QString& t = texts.at(next);
+            next = (next + 1) % texts.size();
+            return t;
+        };
+
+        QList<QPair<QString, Stage> > stages;
+        stages << qMakePair(QStringLiteral("reader:textstream"), Stage([](const QByteArray& f) -> qint64 { return readerStage(f, UTF8Reader::TextStream); }));
+        stages << qMakePair(QStringLiteral("reader:bulk"), Stage([](const QByteArray& f) -> qint64 { return readerStage(f, UTF8Reader::Bulk); }));
+        stages << qMakePair(QStringLiteral("reader:vectorised"), Stage([](const QByteArray& f) -> qint64 { return readerStage(f, UTF8Reader::Vectorised); }));
+        stages << qMakePair(QStringLiteral("tokeniser:signals"), Stage([&decodedText](const QByteArray&) -> qint64 { return tokeniserSignalsStage(decodedText()); }));
+        stages << qMakePair(QStringLiteral("tokeniser:views"), Stage([&decodedText](const QByteArray&) -> qint64 { return tokeniserStage(decodedText()); }));
+        stages << qMakePair(QStringLiteral("tokenise:batch"), Stage([](const QByteArray& f) -> qint64 { return Tokeniser::tokenise(f).size(); }));
+        // the tokeniser state machine on its own, without UTF-8 validation
+        stages << qMakePair(QStringLiteral("tokenise:utf16"), Stage([&decodedText](const QByteArray&) -> qint64 { return Tokeniser::tokenise(decodedText()).size(); }));
+        stages << qMakePair(QStringLiteral("end-to-end:legacy"), Stage(endToEndLegacy));
+        stages << qMakePair(QStringLiteral("end-to-end:chunked"), Stage(endToEndChunked));
+
+        for(const QPair<QString, Stage>& s: stages) {
+            next = 0;
+            const Result r = measure(c, s.second);
+            const double seconds = r.nsecs / 1e9;
+            const double mbs = c.bytes / seconds / (1024 * 1024);
+            const QString tokensPerSec = r.tokens ? QString::number(r.tokens / seconds / 1e6, 'f', 2) : QStringLiteral("-");
+            const double perToken = r.tokens ? (double) r.allocations / r.tokens : 0;
+            const QString allocs = r.tokens ? QString::number(perToken, 'f', 3) : QStringLiteral("-");
+            out << QStringLiteral("%1 %2 %3 %4 %5\n")
+                .arg(c.name, -20).arg(s.first, -22).arg(QString::number(mbs, 'f', 1), 10).arg(tokensPerSec, 10).arg(allocs, 13);
+            out.flush();
+
+            const bool budgeted = s.first == QLatin1String("reader:bulk") || s.first == QLatin1String("reader:vectorised") ||
+                                  s.first == QLatin1String("tokeniser:views") || s.first == QLatin1String("tokenise:batch") ||
+                                  s.first == QLatin1String("tokenise:utf16") ||
+                                  s.first == QLatin1String("end-to-end:chunked");
+            const bool largeFiles = r.tokens / c.files.size() >= 1000;
+            if(budgeted && largeFiles && perToken > allocationBudget) {
+                qDebug() << s.first << "on" << c.name << "exceeds the allocation budget of" << allocationBudget << "per token" << "\t[failed]";
+                result |= 1;
+            }
+        }
+    }
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    const QStringList args = app.arguments();
+    const int scale = args.size() > 1 ? qMax(1, args.at(1).toInt()) : 1;
+    QTimer::singleShot(0, [scale]() {
+        QCoreApplication::exit(runBenchmarks(scale));
+    });
+    return app.exec();
+}
@@ -0,0 +1,250 @@
+#include "../../src/utf8/utf8_reader.h"
+#include "../../src/unit-file/parser/tokeniser.h"
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QIODevice>
+#include <QThread>
+#include <QtDebug>
+#include <QTimer>
+#include <QCoreApplication>
+
+/*
+ * Streams generated unit file text from a slow sequential device through a UTF8Reader into a Tokeniser which runs on a worker thread,
+ * the way reading the output of e.g. `systemctl cat` over a remote connection would.
+ * Usage: streaming_tokeniser_bench [size in MB]
+ *
+ * Apart from reporting numbers, this checks that every token arrives intact although input is delivered in arbitrarily sized pieces
+ * (which split UTF-8 sequences and lines), that the event loop stays responsive and that backpressure bounds the text in flight.
+ */
+
+static const int defaultSize = 16; // MB
+static const qint64 maximumPending = 256 * 1024; // QChar
+static const qint64 deviceBuffer = 64 * 1024; // bytes
+static const qint64 maximumStall = 100; // ms the event loop may be kept busy
+
+static const char * const unitTemplate =
+    "# Generated unit, voilà\n"
+    "[Unit]\n"
+    "Description=Prüfdienst für Übertragungen ✓ 𝄞\n"
+    "After=network.target remote-fs.target\n"
+    "\n"
+    "[Service]\n"
+    "ExecStart=/usr/bin/synthetic --instance=%i \\\n"
+    "    --verbose\n"
+    "Environment=LANG=C.UTF-8\n"
+    "Bad Key=value\n"
+    "\n"
+    "[Install]\n"
+    "WantedBy=multi-user.target\n";
+
+/*
+ * A sequential device which repeats a pattern up to a given size. Data "arrives" in pieces of varying size whenever #deliver() is called,
+ * but only as long as no more than a fixed amount is waiting to be read: like a socket with a limited read buffer, it stops taking data
+ * from the (simulated) network when its reader does not keep up.
+ */
+class Producer: public QIODevice
+{
+public:
+    Producer(const QByteArray& pattern, qint64 size) : m_pattern(pattern), m_size(size), m_arrived(0), m_read(0), m_seed(1u), m_finished(false) {}
+
+    bool isSequential(void) const Q_DECL_OVERRIDE
+    {
+        return true;
+    }
+
+    qint64 bytesAvailable(void) const Q_DECL_OVERRIDE
+    {
+        return m_arrived - m_read + QIODevice::bytesAvailable();
+    }
+
+    void deliver(void)
+    {
+        if(m_arrived < m_size && m_arrived - m_read < deviceBuffer) {
+            m_seed = m_seed * 1103515245u + 12345u;
+            const qint64 piece = 1 + (qint64) ((m_seed >> 8) % 16384);
+            m_arrived = qMin(m_size, m_arrived + qMin(piece, deviceBuffer - (m_arrived - m_read)));
+            Q_EMIT readyRead();
+        }
+        if(m_arrived == m_size && !m_finished) {
+            m_finished = true;
+            Q_EMIT readChannelFinished();
+        }
+    }
+
+    bool isFinished(void) const
+    {
+        return m_finished;
+    }
+protected:
+    qint64 readData(char * data, qint64 maxSize) Q_DECL_OVERRIDE
+    {
+        const qint64 size = qMin(maxSize, m_arrived - m_read);
+        for(qint64 i = 0; i < size; ++i) {
+            data[i] = m_pattern.at((int) ((m_read + i) % m_pattern.size()));
+        }
+        m_read += size;
+        return size;
+    }
+
+    qint64 writeData(const char *, qint64) Q_DECL_OVERRIDE
+    {
+        return -1;
+    }
+private:
+    const QByteArray m_pattern;
+    const qint64 m_size;
+    qint64 m_arrived, m_read;
+    quint32 m_seed;
+    bool m_finished;
+};
+
+/*
+ * Checks the tokens streamed against those of a single copy of the pattern: since the pattern ends with a line break, copy n yields
+ * the same tokens shifted by n times its length and line count.
+ */
+class Expectation
+{
+public:
+    Expectation(const QString& pattern) : m_pattern(pattern), m_tokens(Tokeniser::tokenise(pattern)), m_lines(pattern.count(QLatin1Char('\n'))),
+        m_count(0), m_wrong(0)
+    {
+        for(const TokenSpan& t: m_tokens) {
+            m_texts << Tokeniser::text(pattern, t);
+        }
+    }
+
+    void check(const Token& token)
+    {
+        const qint64 copy = m_count / m_tokens.size();
+        const TokenSpan& expected = m_tokens.at((int) (m_count % m_tokens.size()));
+        const TokenSpan& actual = token.span();
+        if(actual.kind != expected.kind || actual.hint != expected.hint || actual.flags != expected.flags ||
+            actual.length != expected.length || (qint64) actual.offset != expected.offset + copy * m_pattern.size() ||
+            (qint64) actual.line != expected.line + copy * m_lines || actual.column != expected.column ||
+            token != m_texts.at((int) (m_count % m_tokens.size()))) {
+            if(m_wrong++ == 0) {
+                qDebug() << "Token" << m_count << "is not as expected:" << token.toString() << "at" << actual.line << ":" << actual.column;
+            }
+        }
+        ++m_count;
+    }
+
+    bool isComplete(qint64 copies) const
+    {
+        return m_wrong == 0 && m_count == copies * m_tokens.size();
+    }
+
+    qint64 count(void) const
+    {
+        return m_count;
+    }
+private:
+    const QString m_pattern;
+    const QVector<TokenSpan> m_tokens;
+    QStringList m_texts;
+    const int m_lines;
+    qint64 m_count, m_wrong;
+};
+
+struct Result
+{
+    bool done;
+    qint64 nsecs;
+    qint64 maximumPending;
+    qint64 maximumStall;
+};
+
+Result stream(const QByteArray& pattern, qint64 copies, qint64 pending, Expectation& expectation)
+{
+    Result r = { false, 0, 0, 0 };
+    Producer producer(pattern, copies * pattern.size());
+    producer.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    QThread worker;
+    Tokeniser * tk = new Tokeniser(Tokeniser::LF);
+    tk->moveToThread(&worker);
+    QObject::connect(&worker, &QThread::finished, tk, &QObject::deleteLater);
+    worker.start();
+
+    UTF8Reader reader(UTF8Reader::Vectorised);
+    reader.setMaximumPending(pending);
+    QEventLoop loop;
+    // text is queued to the worker thread, and acknowledged back once tokenised
+    QObject::connect(&reader, &UTF8Reader::pushChunk, tk, &Tokeniser::receiveChunk);
+    QObject::connect(tk, &Tokeniser::consumed, &reader, &UTF8Reader::acknowledge);
+    QObject::connect(&reader, &UTF8Reader::pushChunk, &loop, [&r, &reader](QString) -> void {
+        r.maximumPending = qMax(r.maximumPending, reader.pending());
+    });
+    QObject::connect(&reader, &UTF8Reader::done, tk, &Tokeniser::end);
+    QObject::connect(&reader, &UTF8Reader::doneWithInvalidBytes, tk, &Tokeniser::end);
+    QObject::connect(&reader, &UTF8Reader::failed, &loop, &QEventLoop::quit);
+    // tokens are checked on the worker thread, as they are emitted
+    QObject::connect(tk, &Tokeniser::token, [&expectation](const Token& token) -> void {
+        expectation.check(token);
+    });
+    QObject::connect(tk, &Tokeniser::done, &loop, [&r, &loop]() -> void {
+        r.done = true;
+        loop.quit();
+    });
+
+    // the network delivers another piece on every pass of the event loop, and a ticker measures how long passes take
+    QTimer network, ticker;
+    QElapsedTimer timer, tick;
+    QObject::connect(&network, &QTimer::timeout, &producer, &Producer::deliver);
+    QObject::connect(&ticker, &QTimer::timeout, &loop, [&r, &tick]() -> void {
+        r.maximumStall = qMax(r.maximumStall, tick.restart());
+    });
+    network.start(0);
+    ticker.start(1);
+    timer.start();
+    tick.start();
+    reader.start(&producer);
+    loop.exec();
+    r.nsecs = qMax(Q_INT64_C(1), timer.nsecsElapsed());
+    worker.quit();
+    worker.wait();
+    return r;
+}
+
+int runBenchmark(int size)
+{
+    const QByteArray pattern(unitTemplate);
+    const qint64 copies = (qint64) size * 1024 * 1024 / pattern.size();
+    int result = 0;
+    for(const qint64 pending: { Q_INT64_C(0), maximumPending }) {
+        Expectation expectation(QString::fromUtf8(pattern));
+        const Result r = stream(pattern, copies, pending, expectation);
+        const qint64 bytes = copies * pattern.size();
+        qDebug() << (pending ? "with backpressure:" : "without backpressure:") << "MB/s:" << (bytes * 1000) / r.nsecs
+                 << "tokens:" << expectation.count() << "most text in flight (KB):" << r.maximumPending * 2 / 1024
+                 << "longest pass of the event loop (ms):" << r.maximumStall;
+        if(!r.done || !expectation.isComplete(copies)) {
+            qDebug() << "Expected" << copies << "copies of the pattern to be tokenised as a whole" << "\t[failed]";
+            result |= 1;
+        }
+        if(r.maximumStall > maximumStall) {
+            qDebug() << "The event loop was kept busy for longer than" << maximumStall << "ms" << "\t[failed]";
+            result |= 1;
+        }
+        // the reader may overshoot by at most the block it was reading when the limit was reached
+        if(pending && r.maximumPending > pending + 16384) {
+            qDebug() << "More than" << pending << "characters were in flight" << "\t[failed]";
+            result |= 1;
+        }
+    }
+    qDebug() << (result ? "Test failed." : "Test succeeded.");
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    const QStringList args = app.arguments();
+    int size = args.size() > 1 ? args.at(1).toInt() : defaultSize;
+    if(size < 1) {
+        size = defaultSize;
+    }
+    QTimer::singleShot(0, [size]() {
+        QCoreApplication::exit(runBenchmark(size));
+    });
+    return app.exec();
+}
@@ -0,0 +1,91 @@
+#include "../../src/unit-file/parser/tokeniser.h"
+#include "../common/allocation_counter.h"
+#include <QtDebug>
+#include <QTimer>
+#include <QCoreApplication>
+
+static const QString sampleText(QStringLiteral(
+    "# A unit file with a bit of everything\n"
+    "[Unit]\n"
+    "Description=Some service ünicode\n"
+    "After=network.target \\\n"
+    "    remote-fs.target\n"
+    "\n"
+    "[Service]\n"
+    "ExecStart=/usr/bin/true --some-option\n"
+    "; another comment\n"
+    "Bad Key=value\n"
+    "[Install]\n"
+    "WantedBy=multi-user.target\n"
+));
+
+static const int rounds = 2000;
+/*
+ * The text window is trimmed once more than 1024 characters of it are obsolete: after a few trims it has grown to its working size.
+ */
+static const int warmUpSize = 4 * 1024; // characters
+
+void feed(Tokeniser& tk)
+{
+    for(int i = 0; i < sampleText.size(); ++i) {
+        tk.receive(sampleText[i]);
+    }
+}
+
+int runTest(void)
+{
+    int result = 0;
+    qint64 tokens = 0, keys = 0;
+    Tokeniser tk(Tokeniser::LF);
+    QObject::connect(&tk, &Tokeniser::token, [&tokens, &keys](const Token& t) -> void {
+        ++tokens;
+        if(t.kind() == TokenSpan::Key && t == QLatin1String("ExecStart")) {
+            ++keys;
+        }
+    });
+
+    // warm up: let the tokeniser grow its text window to its working size
+    for(int fed = 0; fed < warmUpSize; fed += sampleText.size()) {
+        feed(tk);
+    }
+    tokens = keys = 0;
+
+    AllocationCounter::start();
+    for(int i = 0; i < rounds; ++i) {
+        feed(tk);
+    }
+    const qint64 allocations = AllocationCounter::stop();
+    tk.end();
+
+    qDebug() << "Tokens seen:" << tokens << "heap allocations:" << allocations;
+    if(keys != rounds) {
+        qDebug() << "Expected" << rounds << "ExecStart keys but found" << keys << "\t[failed]";
+        result |= 1;
+    }
+    /*
+     * Once the text window is warmed up, trimming it moves text in place: nothing is allocated at all.
+     */
+    if(allocations > 0) {
+        qDebug() << "Token views should not allocate" << "\t[failed]";
+        result |= 1;
+    }
+    else {
+        qDebug() << "Token views do not allocate" << "\t[passed]";
+    }
+
+    // for comparison: connecting a string based signal materialises text for every token of that kind
+    QObject::connect(&tk, &Tokeniser::value, [](int, int, QString) -> void {});
+    AllocationCounter::start();
+    feed(tk);
+    qDebug() << "Heap allocations with a string based signal connected, for one round:" << AllocationCounter::stop();
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QTimer::singleShot(0, []() {
+        QCoreApplication::exit(runTest());
+    });
+    return app.exec();
+}
@@ -1,7 +1,10 @@
 #include "../../src/utf8/utf8_reader.h"
 #include "../../src/unit-file/parser/tokeniser.h"
+#include "../../src/unit-file/parser/incremental_tokeniser.h"
+#include "../../src/unit-file/parser/mapped_unit_file.h"
 #include <functional>
 #include <QBuffer>
+#include <QTemporaryFile>
 #include <QtDebug>
 #include <QTimer>
 #include <QCoreApplication>
@@ -96,11 +99,12 @@ TestFunc createRejectFunc(int& result, const char* id)
     });
 }
 
-int runTests(void)
+int runTests(bool chunked)
 {
     int result = 0;
     Tokeniser tk(lineEnding());
     QString sampleText(createSampleText());
+    qDebug() << (chunked ? "Feeding text to the tokeniser in chunks." : "Feeding text to the tokeniser one character at a time.");
     qDebug() << "Will test this sample:";
     qDebug() << sampleText<< "\n";
     QBuffer buf;
@@ -109,7 +113,7 @@ int runTests(void)
         qDebug() << "Failed to open the buffer QIODevice!";
         return 2;
     }
-    UTF8Reader reader;
+    UTF8Reader reader(chunked ? UTF8Reader::Vectorised : UTF8Reader::TextStream);
     QList<QMetaObject::Connection> cs;
     auto recoveryErrorHandler=[&result](qint64 at) -> void {
         qDebug() << "Error recovery should not even have been necessary, at:" << at;
@@ -155,8 +159,10 @@ int runTests(void)
         }
     };
     
-    bool validConn = verifyConnection(cs, QObject::connect(&reader, &UTF8Reader::push, &tk, &Tokeniser::receive)) &&
-        verifyConnection(cs, QObject::connect(&reader, &UTF8Reader::pushPair, &tk, &Tokeniser::receivePair)) &&
+    bool validConn = (chunked ?
+            verifyConnection(cs, QObject::connect(&reader, &UTF8Reader::pushChunk, &tk, &Tokeniser::receiveChunk)) :
+            verifyConnection(cs, QObject::connect(&reader, &UTF8Reader::push, &tk, &Tokeniser::receive)) &&
+            verifyConnection(cs, QObject::connect(&reader, &UTF8Reader::pushPair, &tk, &Tokeniser::receivePair))) &&
         verifyConnection(cs, QObject::connect(&reader, &UTF8Reader::done, &tk, &Tokeniser::end)) &&
         verifyConnection(cs, QObject::connect(&reader, &UTF8Reader::doneWithInvalidBytes, &tk, &Tokeniser::end)) &&
         verifyConnection(cs, QObject::connect(&reader, &UTF8Reader::reportBytes, invalidBytesHandler)) &&
@@ -180,11 +186,128 @@ int runTests(void)
     return result;
 }
 
+typedef std::function<QString(const TokenSpan&)> TextFunc;
+
+int checkTokens(const QVector<TokenSpan>& tokens, const TextFunc& textOf)
+{
+    int result = 0;
+    auto checkComment = createTest(result, 1, 2, expComment, "Comment");
+    auto checkSection = createTest(result, 2, 2, expSection, "Section");
+    auto checkKey = createTest(result, 3, 1, expKey, "Key");
+    auto checkValue = createTest(result, 3, 5, expValue, "Value");
+    auto checkError = createTest(result, 2, 6, expError, "Syntax error");
+    auto rejectOther = createRejectFunc(result, "other");
+    for(const TokenSpan& t: tokens) {
+        const QString text = textOf(t);
+        switch(t.kind) {
+            case TokenSpan::Comment:
+                checkComment(t.line, t.column, text);
+                break;
+            case TokenSpan::Section:
+                checkSection(t.line, t.column, text);
+                break;
+            case TokenSpan::Key:
+                checkKey(t.line, t.column, text);
+                break;
+            case TokenSpan::Value:
+                checkValue(t.line, t.column, text);
+                break;
+            case TokenSpan::SyntaxError:
+                checkError(t.line, t.column, text);
+                break;
+            default:
+                rejectOther(t.line, t.column, text);
+                break;
+        }
+    }
+    qDebug() << (result ? "Test failed." : "Test succeeded.");
+    return result;
+}
+
+int runBatchTests(void)
+{
+    const QString sampleText(createSampleText());
+    const QByteArray sampleBytes(sampleText.toUtf8());
+    QVector<ByteRange> invalid;
+    int result = 0;
+
+    qDebug() << "Tokenising the sample text in one go.";
+    result |= checkTokens(Tokeniser::tokenise(sampleText, lineEnding()), [&sampleText](const TokenSpan& t) -> QString {
+        return Tokeniser::text(sampleText, t);
+    });
+
+    qDebug() << "Tokenising the sample text as UTF-8 in one go.";
+    result |= checkTokens(Tokeniser::tokenise(sampleBytes, lineEnding(), &invalid), [&sampleBytes](const TokenSpan& t) -> QString {
+        return Tokeniser::text(sampleBytes, t);
+    });
+    if(!invalid.isEmpty()) {
+        qDebug() << "Found unexpected invalid bytes at:" << invalid.first().offset;
+        result |= 2;
+    }
+    return result;
+}
+
+int runMappedTest(void)
+{
+    int result = 0;
+    qDebug() << "Tokenising a memory mapped file.";
+    QTemporaryFile file;
+    if(!file.open() || file.write(createSampleText().toUtf8()) < 0 || !file.flush()) {
+        qDebug() << "Failed to write the sample text to a temporary file!";
+        return 2;
+    }
+    MappedUnitFile mapped(file.fileName(), lineEnding());
+    if(!mapped.open()) {
+        qDebug() << "Failed to map the temporary file:" << mapped.errorString();
+        return 2;
+    }
+    if(!mapped.invalidBytes().isEmpty()) {
+        qDebug() << "Found unexpected invalid bytes at:" << mapped.invalidBytes().first().offset;
+        result |= 2;
+    }
+    int bytesMatch = 0;
+    int tokensMatch = checkTokens(mapped.tokens(), [&mapped, &bytesMatch](const TokenSpan& t) -> QString {
+        const QString text = mapped.text(t);
+        if(!(t.flags & TokenSpan::Synthetic) && mapped.bytes(t) != text.toUtf8()) {
+            qDebug() << "Mapped bytes do not match token text at:" << t.line << ":" << t.column;
+            bytesMatch |= 1;
+        }
+        return text;
+    });
+    return result | tokensMatch | bytesMatch;
+}
+
+/*
+ * Arrives at the sample text through a series of edits, including one which continues the value onto a new line and one which undoes that again.
+ */
+int runIncrementalTest(void)
+{
+    qDebug() << "Tokenising the sample text incrementally, as it is edited.";
+    const QByteArray comment = QString(QStringLiteral("#")).append(expComment).append(NL).toUtf8();
+    const QByteArray section = QString(QStringLiteral("[")).append(expSection).append(QStringLiteral("]")).append(expError).append(NL).toUtf8();
+    IncrementalTokeniser document(lineEnding());
+    document.setText(comment + QByteArray("bar=b"));
+    document.edit(comment.size(), 0, section);
+    document.edit(document.size(), 0, QByteArray("\\\n"));
+    const IncrementalTokeniser::Change change = document.edit(document.size() - 2, 2, QByteArray("az"));
+    if(change.firstLine != 2 || change.removedLines != 1 || change.insertedLines != 1) {
+        qDebug() << "Unexpected lines tokenised again:" << change.firstLine << change.removedLines << change.insertedLines;
+        return 2;
+    }
+    if(document.text() != createSampleText().toUtf8()) {
+        qDebug() << "Edited text does not match the sample text!";
+        return 2;
+    }
+    return checkTokens(document.tokens(), [&document](const TokenSpan& t) -> QString {
+        return document.tokenText(t);
+    });
+}
+
 int main(int argc, char** argv) 
 {
     QCoreApplication app(argc, argv);
     QTimer::singleShot(0, []() {
-        QCoreApplication::exit(runTests());
+        QCoreApplication::exit(runTests(false) | runTests(true) | runBatchTests() | runMappedTest() | runIncrementalTest());
     });
     return app.exec();
 }
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "../common/synthetic_tree.h"
+#include "../../src/unit-file/loader/unit_file_loader.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QtDebug>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTimer>
+
+/*
+ * Generates a synthetic tree of unit files, then loads it through the on-disk parse cache.
+ * Usage: unit_file_cache_bench [number of files]
+ */
+
+/*
+ * Loads the tree without a cache, then with a cache which is written by the first load and read by the second.
+ * A file is then changed, so the third load has to tokenise it again.
+ */
+int measureCache(const QString& root, UnitFileLoader& loader)
+{
+    int result = 0;
+    const UnitFileIndex reference = loader.load();
+    loader.setCacheFile(root + QStringLiteral("/cache/unit-files.cache"));
+    const char * const labels[] = { "cache: cold (writes the cache)", "cache: warm", "cache: after a change" };
+    for(int run = 0; run < 3; ++run) {
+        if(run == 2) {
+            // a different size makes sure the change is seen even if the modification time does not change
+            SyntheticTree::writeFile(root + QStringLiteral("/usr/synthetic-1.service"), QStringLiteral("[Unit]\nDescription=Changed\n"));
+        }
+        QElapsedTimer timer;
+        timer.start();
+        const UnitFileIndex index = loader.load();
+        const qint64 elapsed = qMax(Q_INT64_C(1), timer.nsecsElapsed() / 1000);
+        qDebug() << labels[run] << "time (ms):" << elapsed / 1000 << "files/s:" << (qint64) index.size() * 1000000 / elapsed;
+        if(run < 2 && !SyntheticTree::sameEntries(reference, index)) {
+            qDebug() << "Cached results differ from tokenising the files" << "\t[failed]";
+            result |= 1;
+        }
+        const int changed = index.unit(QStringLiteral("synthetic-1.service"));
+        if(run == 2 && (changed < 0 || index.at(changed).content != QByteArray("[Unit]\nDescription=Changed\n"))) {
+            qDebug() << "A changed file was not read again" << "\t[failed]";
+            result |= 1;
+        }
+    }
+    loader.setCacheFile(QString());
+    return result;
+}
+
+int runBenchmark(int files)
+{
+    QTemporaryDir tmp;
+    SyntheticTree::Expected expected;
+    qDebug() << "Generating" << files << "files ...";
+    if(!tmp.isValid() || !SyntheticTree::create(tmp.path(), files, expected)) {
+        qDebug() << "Failed to generate the synthetic tree!";
+        return 2;
+    }
+    UnitFileLoader loader(SyntheticTree::searchPaths(tmp.path()));
+    loader.setThreadCount(QThread::idealThreadCount());
+    const int result = measureCache(tmp.path(), loader);
+    qDebug() << (result ? "Test failed." : "Test succeeded.");
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    const int files = SyntheticTree::files(app.arguments());
+    QTimer::singleShot(0, [files]() {
+        QCoreApplication::exit(runBenchmark(files));
+    });
+    return app.exec();
+}
@@ -0,0 +1,115 @@
+#include "../common/synthetic_tree.h"
+#include "../../src/unit-file/graph/unit_graph.h"
+#include "../../src/unit-file/loader/unit_file_loader.h"
+#include "../../src/unit-file/merge/unit_file_merger.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QtDebug>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTimer>
+
+/*
+ * Generates a synthetic tree of unit files, then builds and queries the dependency graph of all units.
+ * Usage: unit_file_graph_bench [number of files]
+ */
+
+/*
+ * Builds the dependency graph of all units and times reverse and transitive queries on it.
+ * Then two drop-ins which order units after each other are added, which should be found as a cycle by updating just those units.
+ */
+int measureGraph(const QString& root, const UnitFileLoader& loader)
+{
+    int result = 0;
+    UnitFileMerger merger(loader.load());
+    merger.precompute();
+    UnitGraph graph;
+    QElapsedTimer timer;
+    timer.start();
+    graph.build(merger);
+    const qint64 elapsed = qMax(Q_INT64_C(1), timer.nsecsElapsed() / 1000);
+
+    const int queries = 10000;
+    const int network = graph.node(QStringLiteral("network.target"));
+    const int multiUser = graph.node(QStringLiteral("multi-user.target"));
+    if(network < 0 || multiUser < 0 || graph.isLoaded(network)) {
+        qDebug() << "network.target and multi-user.target should be in the graph, without a unit file" << "\t[failed]";
+        return 1;
+    }
+    qint64 found = 0;
+    timer.restart();
+    for(int i = 0; i < queries; ++i) {
+        found += graph.edges(network, UnitGraph::Reverse).size();
+    }
+    const qint64 reverse = timer.nsecsElapsed();
+    timer.restart();
+    const QVector<int> closure = graph.closure(network, UnitGraph::After, UnitGraph::Reverse);
+    const qint64 transitive = timer.nsecsElapsed();
+    qDebug() << "graph: nodes:" << graph.size() << "edges:" << graph.edgeCount() << "build (ms):" << elapsed / 1000
+             << "reverse query (ns):" << reverse / queries << "closure of" << closure.size() << "nodes (us):" << transitive / 1000;
+
+    // all units generated from the template want network.target, are ordered after it, and are wanted by multi-user.target
+    int templated = 0;
+    for(const QString& unit: merger.index().units()) {
+        templated += merger.unit(unit).settings.values(QStringLiteral("Unit"), QStringLiteral("Wants")).contains(QStringLiteral("network.target")) ? 1 : 0;
+    }
+    const int wanting = graph.neighbours(network, UnitGraph::Wants, UnitGraph::Reverse).size();
+    const int installed = graph.neighbours(multiUser, UnitGraph::WantedBy, UnitGraph::Reverse).size();
+    if(found != (qint64) queries * graph.edges(network, UnitGraph::Reverse).size() || wanting != installed || wanting != closure.size() || wanting != templated) {
+        qDebug() << "Unexpected relations with network.target or multi-user.target" << "\t[failed]";
+        result |= 1;
+    }
+    if(!graph.cycles().isEmpty()) {
+        qDebug() << "The synthetic tree should not have ordering cycles" << "\t[failed]";
+        result |= 1;
+    }
+
+    const QStringList units = QStringList() << QStringLiteral("synthetic-4.service") << QStringLiteral("synthetic-6.service");
+    QDir(root).mkpath(QStringLiteral("run/synthetic-4.service.d"));
+    QDir(root).mkpath(QStringLiteral("run/synthetic-6.service.d"));
+    SyntheticTree::writeFile(root + QStringLiteral("/run/synthetic-4.service.d/cycle.conf"), QStringLiteral("[Unit]\nAfter=synthetic-6.service\n"));
+    SyntheticTree::writeFile(root + QStringLiteral("/run/synthetic-6.service.d/cycle.conf"), QStringLiteral("[Unit]\nAfter=synthetic-4.service\n"));
+    merger.update(loader.load(), units);
+    graph.update(merger, units);
+    if(graph.cycles().size() != 1 || graph.cycles().first().size() != 2 || !graph.cycles().first().contains(graph.node(units.first()))) {
+        qDebug() << "The ordering cycle between synthetic-4.service and synthetic-6.service was not found" << "\t[failed]";
+        result |= 1;
+    }
+    QFile::remove(root + QStringLiteral("/run/synthetic-4.service.d/cycle.conf"));
+    QFile::remove(root + QStringLiteral("/run/synthetic-6.service.d/cycle.conf"));
+    merger.update(loader.load(), units);
+    graph.update(merger, units);
+    if(!graph.cycles().isEmpty()) {
+        qDebug() << "The ordering cycle between synthetic-4.service and synthetic-6.service was not cleared" << "\t[failed]";
+        result |= 1;
+    }
+    return result;
+}
+
+int runBenchmark(int files)
+{
+    QTemporaryDir tmp;
+    SyntheticTree::Expected expected;
+    qDebug() << "Generating" << files << "files ...";
+    if(!tmp.isValid() || !SyntheticTree::create(tmp.path(), files, expected)) {
+        qDebug() << "Failed to generate the synthetic tree!";
+        return 2;
+    }
+    UnitFileLoader loader(SyntheticTree::searchPaths(tmp.path()));
+    loader.setThreadCount(QThread::idealThreadCount());
+    const int result = measureGraph(tmp.path(), loader);
+    qDebug() << (result ? "Test failed." : "Test succeeded.");
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    const int files = SyntheticTree::files(app.arguments());
+    QTimer::singleShot(0, [files]() {
+        QCoreApplication::exit(runBenchmark(files));
+    });
+    return app.exec();
+}
@@ -0,0 +1,107 @@
+#include "../common/synthetic_tree.h"
+#include "../../src/unit-file/itemmodel/unit_file_item_model.h"
+#include "../../src/unit-file/loader/unit_file_loader.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QtDebug>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTimer>
+
+/*
+ * Generates a synthetic tree of unit files, then scrolls a view of all units through UnitFileItemModel.
+ * Usage: unit_file_itemmodel_bench [number of files]
+ */
+
+/*
+ * Scrolls a view of all units through the item model: each frame shows a page of rows, some of which were not shown before, so the model has
+ * to fetch and describe them. The slowest frame should fit comfortably within the 16ms of a frame at 60 fps.
+ * Then a unit is added and another one overridden, which the model should pick up without being reset.
+ */
+int measureItemModel(const QString& root, const UnitFileLoader& loader)
+{
+    static const int pageRows = 50;
+    static const int scrollRows = 20;
+    int result = 0;
+    UnitFileItemModel model;
+    model.setIndex(loader.load());
+    const int units = model.unitFileIndex().units().size();
+    QElapsedTimer timer;
+    qint64 slowest = 0, total = 0;
+    int frames = 0, characters = 0;
+    for(int first = 0; first < units; first += scrollRows) {
+        timer.start();
+        // a view fetches more rows once it is scrolled near the end of those it has
+        while(model.rowCount() < first + pageRows && model.canFetchMore(QModelIndex())) {
+            model.fetchMore(QModelIndex());
+        }
+        const int last = qMin(first + pageRows, model.rowCount());
+        for(int row = first; row < last; ++row) {
+            characters += model.data(model.index(row, UnitFileItemModel::NameColumn)).toString().size();
+            characters += model.data(model.index(row, UnitFileItemModel::ValueColumn)).toString().size();
+        }
+        const qint64 elapsed = timer.nsecsElapsed() / 1000;
+        slowest = qMax(slowest, elapsed);
+        total += elapsed;
+        ++frames;
+    }
+    qDebug() << "item model: units:" << units << "frames:" << frames << "slowest frame (us):" << slowest << "average frame (us):" << total / qMax(1, frames)
+             << "characters:" << characters;
+    if(model.rowCount() != units) {
+        qDebug() << "Expected" << units << "rows once scrolled to the end but found" << model.rowCount() << "\t[failed]";
+        result |= 1;
+    }
+
+    // rows are sorted by name: the third is synthetic-10.service, which is neither masked nor overridden
+    const QModelIndex unit = model.index(2, UnitFileItemModel::NameColumn);
+    model.fetchMore(unit);
+    if(model.rowCount(unit) != 3 || model.data(model.index(1, UnitFileItemModel::NameColumn, unit)).toString() != QStringLiteral("Service")) {
+        qDebug() << "Expected the [Unit], [Service] and [Install] sections once" << model.data(unit).toString() << "was fetched" << "\t[failed]";
+        result |= 1;
+    }
+
+    const QString added = root + QStringLiteral("/usr/added.service");
+    const QString overridden = root + QStringLiteral("/etc/synthetic-1.service");
+    SyntheticTree::writeFile(added, QStringLiteral("[Unit]\nDescription=Added\n"));
+    SyntheticTree::writeFile(overridden, QStringLiteral("[Unit]\nDescription=Overridden\n"));
+    const UnitFileIndex index = loader.load();
+    timer.restart();
+    model.update(index, QStringList() << QStringLiteral("added.service") << QStringLiteral("synthetic-1.service"));
+    qDebug() << "item model: update (us):" << timer.nsecsElapsed() / 1000;
+    const QModelIndex changed = model.index(2, UnitFileItemModel::ValueColumn);
+    if(model.rowCount() != units + 1 || model.data(model.index(0, UnitFileItemModel::NameColumn)).toString() != QStringLiteral("added.service") ||
+        model.data(changed, UnitFileItemModel::UnitRole).toString() != QStringLiteral("synthetic-1.service") || model.data(changed).toString() != QStringLiteral("Overridden")) {
+        qDebug() << "The added and overridden units were not picked up by the item model" << "\t[failed]";
+        result |= 1;
+    }
+    QFile::remove(added);
+    QFile::remove(overridden);
+    return result;
+}
+
+int runBenchmark(int files)
+{
+    QTemporaryDir tmp;
+    SyntheticTree::Expected expected;
+    qDebug() << "Generating" << files << "files ...";
+    if(!tmp.isValid() || !SyntheticTree::create(tmp.path(), files, expected)) {
+        qDebug() << "Failed to generate the synthetic tree!";
+        return 2;
+    }
+    UnitFileLoader loader(SyntheticTree::searchPaths(tmp.path()));
+    loader.setThreadCount(QThread::idealThreadCount());
+    const int result = measureItemModel(tmp.path(), loader);
+    qDebug() << (result ? "Test failed." : "Test succeeded.");
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    const int files = SyntheticTree::files(app.arguments());
+    QTimer::singleShot(0, [files]() {
+        QCoreApplication::exit(runBenchmark(files));
+    });
+    return app.exec();
+}
@@ -0,0 +1,115 @@
+#include "../common/synthetic_tree.h"
+#include "../../src/unit-file/lint/unit_file_linter.h"
+#include "../../src/unit-file/loader/unit_file_loader.h"
+#include "../../src/unit-file/types/directive_schema.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QtDebug>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTimer>
+
+/*
+ * Generates a synthetic tree of unit files, then checks all of their keys against the directive schema and lints every file.
+ * Usage: unit_file_lint_bench [number of files]
+ */
+
+/*
+ * Classifies every key of every file against the directive schema. The synthetic tree only uses directives systemd knows about.
+ */
+int measureSchema(const UnitFileIndex& index)
+{
+    int result = 0;
+    int keys = 0, issues = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for(const UnitFileEntry& entry: index.entries()) {
+        issues += DirectiveSchema::check(entry.content.constData(), entry.tokens).size();
+        for(const TokenSpan& token: entry.tokens) {
+            keys += token.kind == TokenSpan::Key ? 1 : 0;
+        }
+    }
+    const qint64 elapsed = qMax(Q_INT64_C(1), timer.nsecsElapsed() / 1000);
+    qDebug() << "schema: keys:" << keys << "issues:" << issues << "time (us):" << elapsed << "keys/s:" << (qint64) keys * 1000000 / elapsed;
+    if(!keys || issues) {
+        qDebug() << "Expected all keys of the synthetic tree to be known" << "\t[failed]";
+        result |= 1;
+    }
+
+    const QByteArray text("[Unit]\nBindTo=a.service\nFoo=bar\n[Service]\nExecStart = /bin/true\nX-Custom=1\nRestrt=always\n[Bogus]\nA=b\n");
+    const QVector<TokenSpan> tokens = Tokeniser::tokenise(text);
+    const QVector<DirectiveSchema::Issue> found = DirectiveSchema::check(text.constData(), tokens);
+    const DirectiveSchema::Status expected[] = { DirectiveSchema::Deprecated, DirectiveSchema::Unknown, DirectiveSchema::Unknown, DirectiveSchema::UnknownSection };
+    bool ok = found.size() == 4;
+    for(int i = 0; ok && i < found.size(); ++i) {
+        ok = found.at(i).status == expected[i];
+    }
+    if(!ok) {
+        qDebug() << "Unexpected issues with unknown and deprecated directives" << "\t[failed]";
+        result |= 1;
+    }
+    return result;
+}
+
+/*
+ * Lints every file, reusing a single annotation store, then lints a file with known problems.
+ */
+int measureLint(const UnitFileIndex& index)
+{
+    int result = 0;
+    AnnotationStore store;
+    int annotations = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for(const UnitFileEntry& entry: index.entries()) {
+        store.clear();
+        UnitFileLinter::lint(entry.content, entry.tokens, store);
+        annotations += store.size();
+    }
+    const qint64 elapsed = qMax(Q_INT64_C(1), timer.nsecsElapsed() / 1000);
+    qDebug() << "lint: files:" << index.size() << "annotations:" << annotations << "time (ms):" << elapsed / 1000
+             << "files/s:" << (qint64) index.size() * 1000000 / elapsed;
+    if(annotations) {
+        qDebug() << "The synthetic tree should not have any problems" << "\t[failed]";
+        result |= 1;
+    }
+
+    const QByteArray text("[Service]\nRestrt=always\nRestartSec=5 mins\nPrivateTmp=\n");
+    const QVector<TokenSpan> tokens = Tokeniser::tokenise(text);
+    store.clear();
+    UnitFileLinter::lint(text, tokens, store);
+    const AnnotationStore::Range key = store.annotations(1);
+    if(store.size() != 4 || key.size() != 3 || key.begin()[0].code != Annotation::UnknownKey || store.text(key.begin()[1]) != QByteArray("Restart") ||
+        store.count(Annotation::Error) != 1 || store.annotations().end()[-1].code != Annotation::InvalidValue) {
+        qDebug() << "Unexpected annotations for a file with a misspelled key and an invalid time span" << "\t[failed]";
+        result |= 1;
+    }
+    return result;
+}
+
+int runBenchmark(int files)
+{
+    QTemporaryDir tmp;
+    SyntheticTree::Expected expected;
+    qDebug() << "Generating" << files << "files ...";
+    if(!tmp.isValid() || !SyntheticTree::create(tmp.path(), files, expected)) {
+        qDebug() << "Failed to generate the synthetic tree!";
+        return 2;
+    }
+    UnitFileLoader loader(SyntheticTree::searchPaths(tmp.path()));
+    loader.setThreadCount(QThread::idealThreadCount());
+    const UnitFileIndex index = loader.load();
+    const int result = SyntheticTree::verify(index, expected) | measureSchema(index) | measureLint(index);
+    qDebug() << (result ? "Test failed." : "Test succeeded.");
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    const int files = SyntheticTree::files(app.arguments());
+    QTimer::singleShot(0, [files]() {
+        QCoreApplication::exit(runBenchmark(files));
+    });
+    return app.exec();
+}
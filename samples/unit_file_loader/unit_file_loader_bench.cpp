@@ -0,0 +1,63 @@
+#include "../common/synthetic_tree.h"
+#include "../../src/unit-file/loader/unit_file_loader.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QtDebug>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTimer>
+
+/*
+ * Generates a synthetic tree of unit files resembling a (very) large system, then loads it using 1 up to N threads.
+ * Usage: unit_file_loader_bench [number of files]
+ */
+
+int runBenchmark(int files)
+{
+    QTemporaryDir tmp;
+    SyntheticTree::Expected expected;
+    qDebug() << "Generating" << files << "files ...";
+    if(!tmp.isValid() || !SyntheticTree::create(tmp.path(), files, expected)) {
+        qDebug() << "Failed to generate the synthetic tree!";
+        return 2;
+    }
+    UnitFileLoader loader(SyntheticTree::searchPaths(tmp.path()));
+
+    // warm up the page cache so the first timed run is not penalised
+    loader.setThreadCount(QThread::idealThreadCount());
+    const UnitFileIndex warm = loader.load();
+    int result = SyntheticTree::verify(warm, expected);
+
+    QList<int> threadCounts;
+    for(int t = 1; t < QThread::idealThreadCount(); t *= 2) {
+        threadCounts << t;
+    }
+    threadCounts << qMax(1, QThread::idealThreadCount());
+
+    qint64 baseline = 0;
+    for(int threads: threadCounts) {
+        loader.setThreadCount(threads);
+        QElapsedTimer timer;
+        timer.start();
+        const UnitFileIndex index = loader.load();
+        const qint64 elapsed = qMax(Q_INT64_C(1), timer.nsecsElapsed() / 1000);
+        if(!baseline) {
+            baseline = elapsed;
+        }
+        qDebug() << "threads:" << threads << "time (ms):" << elapsed / 1000 << "files/s:" << (qint64) index.size() * 1000000 / elapsed
+                 << "speed-up:" << (double) baseline / elapsed;
+        result |= SyntheticTree::verify(index, expected);
+    }
+    qDebug() << (result ? "Test failed." : "Test succeeded.");
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    const int files = SyntheticTree::files(app.arguments());
+    QTimer::singleShot(0, [files]() {
+        QCoreApplication::exit(runBenchmark(files));
+    });
+    return app.exec();
+}
@@ -0,0 +1,91 @@
+#include "../common/synthetic_tree.h"
+#include "../../src/unit-file/loader/unit_file_loader.h"
+#include "../../src/unit-file/merge/unit_file_merger.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QtDebug>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTimer>
+
+/*
+ * Generates a synthetic tree of unit files, then merges the drop-ins of all units.
+ * Usage: unit_file_merge_bench [number of files]
+ */
+
+/*
+ * Merges all units with their drop-ins, then adds a drop-in which resets some settings and merges only the affected unit again.
+ */
+int measureMerge(const QString& root, const UnitFileLoader& loader)
+{
+    int result = 0;
+    UnitFileMerger merger(loader.load());
+    QElapsedTimer timer;
+    timer.start();
+    const int merged = merger.precompute();
+    const qint64 elapsed = qMax(Q_INT64_C(1), timer.nsecsElapsed() / 1000);
+    timer.restart();
+    const QStringList units = merger.index().units();
+    int settings = 0;
+    for(const QString& unit: units) {
+        settings += merger.unit(unit).settings.size();
+    }
+    const qint64 lookups = qMax(Q_INT64_C(1), timer.nsecsElapsed() / 1000);
+    qDebug() << "merge: units:" << merged << "settings:" << settings << "time (ms):" << elapsed / 1000 << "units/s:" << (qint64) merged * 1000000 / elapsed
+             << "cached lookups/s:" << (qint64) units.size() * 1000000 / lookups;
+
+    const QStringList environment = QStringList() << QStringLiteral("LANG=C.UTF-8") << QStringLiteral("OVERRIDE=1");
+    if(merger.unit(QStringLiteral("synthetic-2.service")).settings.values(QStringLiteral("Service"), QStringLiteral("Environment")) != environment) {
+        qDebug() << "The drop-in for synthetic-2.service was not merged" << "\t[failed]";
+        result |= 1;
+    }
+    const EffectiveUnit masked = merger.unit(QStringLiteral("synthetic-0.service"));
+    if(!masked.masked || !masked.settings.isEmpty()) {
+        qDebug() << "synthetic-0.service should be masked" << "\t[failed]";
+        result |= 1;
+    }
+
+    const QString reset = root + QStringLiteral("/run/synthetic-4.service.d/reset.conf");
+    SyntheticTree::writeFile(reset, QStringLiteral("[Service]\nExecStart=\nExecStart=/usr/bin/other\nEnvironment=\n"));
+    merger.update(loader.load(), QStringList() << QStringLiteral("synthetic-4.service"));
+    if(merger.cached() != merged - 1) {
+        qDebug() << "Units other than synthetic-4.service were dropped from the cache" << "\t[failed]";
+        result |= 1;
+    }
+    const EffectiveUnit changed = merger.unit(QStringLiteral("synthetic-4.service"));
+    if(changed.settings.values(QStringLiteral("Service"), QStringLiteral("ExecStart")) != QStringList() << QStringLiteral("/usr/bin/other") ||
+        changed.settings.find(QStringLiteral("Service"), QStringLiteral("Environment")) >= 0 || changed.sources.size() != 3 ||
+        changed.source(changed.settings.find(QStringLiteral("Service"), QStringLiteral("ExecStart"))) != reset) {
+        qDebug() << "Empty assignments in the drop-in for synthetic-4.service did not reset the settings" << "\t[failed]";
+        result |= 1;
+    }
+    QFile::remove(reset);
+    return result;
+}
+
+int runBenchmark(int files)
+{
+    QTemporaryDir tmp;
+    SyntheticTree::Expected expected;
+    qDebug() << "Generating" << files << "files ...";
+    if(!tmp.isValid() || !SyntheticTree::create(tmp.path(), files, expected)) {
+        qDebug() << "Failed to generate the synthetic tree!";
+        return 2;
+    }
+    UnitFileLoader loader(SyntheticTree::searchPaths(tmp.path()));
+    loader.setThreadCount(QThread::idealThreadCount());
+    const int result = measureMerge(tmp.path(), loader);
+    qDebug() << (result ? "Test failed." : "Test succeeded.");
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    const int files = SyntheticTree::files(app.arguments());
+    QTimer::singleShot(0, [files]() {
+        QCoreApplication::exit(runBenchmark(files));
+    });
+    return app.exec();
+}
@@ -0,0 +1,75 @@
+#include "../common/synthetic_tree.h"
+#include "../../src/unit-file/loader/unit_file_loader.h"
+#include "../../src/unit-file/model/unit_file.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QtDebug>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTimer>
+
+/*
+ * Generates a synthetic tree of unit files, then builds the unit file model of every file in it and reports how much memory that takes.
+ * Usage: unit_file_model_bench [number of files]
+ */
+
+/*
+ * Builds the unit file model for every entry, and reports how much memory that takes.
+ */
+int measureModel(const UnitFileIndex& index)
+{
+    int result = 0;
+    qint64 footprint = 0, source = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QVector<UnitFile> models;
+    models.reserve(index.size());
+    for(const UnitFileEntry& entry: index.entries()) {
+        models.append(UnitFile::fromTokens(entry.content, entry.tokens, !entry.invalidBytes.isEmpty()));
+        footprint += models.last().footprint();
+        source += entry.content.size();
+    }
+    const qint64 elapsed = qMax(Q_INT64_C(1), timer.nsecsElapsed() / 1000);
+    qDebug() << "model: files:" << models.size() << "time (ms):" << elapsed / 1000 << "source (KiB):" << source / 1024
+             << "model (KiB):" << footprint / 1024 << "bytes/file:" << footprint / qMax(1, models.size()) << "names:" << NameTable::global()->size();
+
+    const int unit = index.unit(QStringLiteral("synthetic-4.service"));
+    if(unit < 0 || models.at(unit).value(QStringLiteral("Service"), QStringLiteral("Restart")) != QStringLiteral("on-failure") ||
+        models.at(unit).value(QStringLiteral("Unit"), QStringLiteral("After")) != QStringLiteral("network.target remote-fs.target      nss-lookup.target")) {
+        qDebug() << "Unexpected settings in the model of synthetic-4.service" << "\t[failed]";
+        result |= 1;
+    }
+    const QVector<int> dropIns = index.dropIns(QStringLiteral("synthetic-2.service"));
+    if(dropIns.size() != 1 || models.at(dropIns.first()).value(QStringLiteral("Service"), QStringLiteral("Environment")) != QStringLiteral("OVERRIDE=1")) {
+        qDebug() << "Unexpected settings in the model of the drop-in for synthetic-2.service" << "\t[failed]";
+        result |= 1;
+    }
+    return result;
+}
+
+int runBenchmark(int files)
+{
+    QTemporaryDir tmp;
+    SyntheticTree::Expected expected;
+    qDebug() << "Generating" << files << "files ...";
+    if(!tmp.isValid() || !SyntheticTree::create(tmp.path(), files, expected)) {
+        qDebug() << "Failed to generate the synthetic tree!";
+        return 2;
+    }
+    UnitFileLoader loader(SyntheticTree::searchPaths(tmp.path()));
+    loader.setThreadCount(QThread::idealThreadCount());
+    const UnitFileIndex index = loader.load();
+    const int result = SyntheticTree::verify(index, expected) | measureModel(index);
+    qDebug() << (result ? "Test failed." : "Test succeeded.");
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    const int files = SyntheticTree::files(app.arguments());
+    QTimer::singleShot(0, [files]() {
+        QCoreApplication::exit(runBenchmark(files));
+    });
+    return app.exec();
+}
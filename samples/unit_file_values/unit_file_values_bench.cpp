@@ -0,0 +1,108 @@
+#include "../common/synthetic_tree.h"
+#include "../../src/unit-file/loader/unit_file_loader.h"
+#include "../../src/unit-file/merge/unit_file_merger.h"
+#include "../../src/unit-file/model/unit_file.h"
+#include "../../src/unit-file/types/value_parser.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QtDebug>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTimer>
+
+/*
+ * Generates a synthetic tree of unit files, then validates the typed settings of all units.
+ * Usage: unit_file_values_bench [number of files]
+ */
+
+/*
+ * Validates the typed settings of every merged unit (Type=, Restart= and RestartSec=), as a linter would, and compares the time this takes
+ * with merging them in the first place.
+ */
+int measureValues(const UnitFileLoader& loader)
+{
+    int result = 0;
+    UnitFileMerger merger(loader.load());
+    QElapsedTimer timer;
+    timer.start();
+    merger.precompute();
+    const qint64 merging = qMax(Q_INT64_C(1), timer.nsecsElapsed() / 1000);
+
+    const QStringList units = merger.index().units();
+    QVector<UnitFile> settings;
+    settings.reserve(units.size());
+    for(const QString& unit: units) {
+        settings << merger.unit(unit).settings;
+    }
+    NameTable * names = NameTable::global();
+    const int service = names->find(QByteArray("Service"));
+    const int keys[] = { names->find(QByteArray("Type")), names->find(QByteArray("Restart")), names->find(QByteArray("RestartSec")) };
+    int checked = 0, wrong = 0;
+    timer.restart();
+    for(const UnitFile& file: settings) {
+        for(int k = 0; k < 3; ++k) {
+            for(int entry = file.find(service, keys[k]); entry >= 0; entry = file.at(entry).next) {
+                const UnitFile::Entry& e = file.at(entry);
+                const char * text = file.rawValue(entry).constData();
+                const int size = (int) e.valueLength;
+                int value = -1;
+                quint64 usec = 0;
+                bool ok;
+                switch(k) {
+                case 0:
+                    ok = ValueParser::parseEnum(text, size, ValueParser::serviceTypes, value) && value == ValueParser::Simple;
+                    break;
+                case 1:
+                    ok = ValueParser::parseEnum(text, size, ValueParser::restartModes, value) && value == ValueParser::RestartOnFailure;
+                    break;
+                default:
+                    ok = ValueParser::parseTimeSpan(text, size, usec) && usec == 5 * ValueParser::usecPerSecond;
+                    break;
+                }
+                wrong += ok ? 0 : 1;
+                ++checked;
+            }
+        }
+    }
+    const qint64 elapsed = qMax(Q_INT64_C(1), timer.nsecsElapsed() / 1000);
+    qDebug() << "values: settings:" << checked << "time (us):" << elapsed << "settings/s:" << (qint64) checked * 1000000 / elapsed
+             << "share of merging (%):" << (double) elapsed * 100 / merging;
+    if(!checked || wrong) {
+        qDebug() << wrong << "of" << checked << "settings were invalid or had unexpected values" << "\t[failed]";
+        result |= 1;
+    }
+    quint64 usec = 0;
+    quint64 bytes = 0;
+    if(!ValueParser::parseTimeSpan(QByteArray("5min 20s"), usec) || usec != Q_UINT64_C(320000000) ||
+        !ValueParser::parseSize(QByteArray("1G 512M"), ValueParser::IEC, bytes) || bytes != Q_UINT64_C(1610612736)) {
+        qDebug() << "Unexpected results parsing a time span or size with several terms" << "\t[failed]";
+        result |= 1;
+    }
+    return result;
+}
+
+int runBenchmark(int files)
+{
+    QTemporaryDir tmp;
+    SyntheticTree::Expected expected;
+    qDebug() << "Generating" << files << "files ...";
+    if(!tmp.isValid() || !SyntheticTree::create(tmp.path(), files, expected)) {
+        qDebug() << "Failed to generate the synthetic tree!";
+        return 2;
+    }
+    UnitFileLoader loader(SyntheticTree::searchPaths(tmp.path()));
+    loader.setThreadCount(QThread::idealThreadCount());
+    const int result = measureValues(loader);
+    qDebug() << (result ? "Test failed." : "Test succeeded.");
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    const int files = SyntheticTree::files(app.arguments());
+    QTimer::singleShot(0, [files]() {
+        QCoreApplication::exit(runBenchmark(files));
+    });
+    return app.exec();
+}
@@ -0,0 +1,92 @@
+#include "../common/synthetic_tree.h"
+#include "../../src/unit-file/loader/unit_file_loader.h"
+#include "../../src/unit-file/loader/unit_file_watcher.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QtDebug>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTimer>
+
+/*
+ * Generates a synthetic tree of unit files, then changes a burst of them while a UnitFileWatcher is active.
+ * Usage: unit_file_watcher_bench [number of files]
+ */
+
+/*
+ * Changes, adds and removes a burst of files while a UnitFileWatcher is active, as a package upgrade would.
+ * The burst should be reported as a single batch, after which the index of the watcher should match a full load.
+ */
+int measureWatcher(const QString& root, const UnitFileLoader& loader, int files)
+{
+    UnitFileWatcher watcher(loader);
+    if(!watcher.start()) {
+        qDebug() << "watcher: inotify is not available, skipped";
+        return 0;
+    }
+    QEventLoop loop;
+    QElapsedTimer timer;
+    QList<UnitFileDelta> deltas;
+    qint64 reported = 0;
+    QObject::connect(&watcher, &UnitFileWatcher::changed, [&deltas, &loop, &timer, &reported](const UnitFileDelta& delta) -> void {
+        deltas << delta;
+        reported = timer.elapsed();
+        loop.quit();
+    });
+
+    const int changes = qMin(100, files * 8 / 10 - 2);
+    const int additions = 10;
+    timer.start();
+    for(int i = 0; i < changes; ++i) {
+        SyntheticTree::writeFile(QStringLiteral("%1/usr/synthetic-%2.service").arg(root).arg(i + 2), QStringLiteral("[Unit]\nDescription=Upgraded %1\n").arg(i));
+    }
+    for(int i = 0; i < additions; ++i) {
+        SyntheticTree::writeFile(QStringLiteral("%1/usr/added-%2.service").arg(root).arg(i), QString::fromLatin1(SyntheticTree::serviceTemplate).arg(i));
+    }
+    QFile::remove(root + QStringLiteral("/usr/synthetic-1.service"));
+    const qint64 written = timer.elapsed();
+    QTimer::singleShot(10000, &loop, SLOT(quit()));
+    loop.exec();
+    // give a second batch (which there should not be) a chance to arrive
+    QTimer::singleShot(watcher.maximumDelay(), &loop, SLOT(quit()));
+    loop.exec();
+    qDebug() << "watcher: burst written in (ms):" << written << "batches:" << deltas.size() << "reported after (ms):" << reported;
+
+    if(deltas.size() != 1 || deltas.first().changed.size() != changes || deltas.first().added.size() != additions || deltas.first().removed.size() != 1) {
+        qDebug() << "The burst was not reported as a single batch with all changes" << "\t[failed]";
+        return 1;
+    }
+    if(!SyntheticTree::sameEntries(watcher.index(), loader.load())) {
+        qDebug() << "The index of the watcher differs from loading all files" << "\t[failed]";
+        return 1;
+    }
+    return 0;
+}
+
+int runBenchmark(int files)
+{
+    QTemporaryDir tmp;
+    SyntheticTree::Expected expected;
+    qDebug() << "Generating" << files << "files ...";
+    if(!tmp.isValid() || !SyntheticTree::create(tmp.path(), files, expected)) {
+        qDebug() << "Failed to generate the synthetic tree!";
+        return 2;
+    }
+    UnitFileLoader loader(SyntheticTree::searchPaths(tmp.path()));
+    loader.setThreadCount(QThread::idealThreadCount());
+    const int result = measureWatcher(tmp.path(), loader, files);
+    qDebug() << (result ? "Test failed." : "Test succeeded.");
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    const int files = SyntheticTree::files(app.arguments());
+    QTimer::singleShot(0, [files]() {
+        QCoreApplication::exit(runBenchmark(files));
+    });
+    return app.exec();
+}
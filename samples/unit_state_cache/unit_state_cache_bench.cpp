@@ -0,0 +1,260 @@
+#include "../../src/manager/unit_list_entry.h"
+#include "../../src/manager/unit_state_cache.h"
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusMessage>
+#include <QDBusVirtualObject>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QSet>
+#include <QtDebug>
+#include <QTimer>
+#include <QCoreApplication>
+
+/*
+ * Refreshes a UnitStateCache against a stand-in for systemd which answers every call after a delay, to mimic a busy system bus.
+ * The stand-in takes the org.freedesktop.systemd1 name on the session bus, so run this on a private bus:
+ *
+ *     dbus-run-session unit_state_cache_bench [number of units]
+ */
+
+static const int defaultUnits = 2000;
+static const int latency = 2; // ms taken by the stand-in to answer a call
+static const QString unitPrefix(QStringLiteral("/org/freedesktop/systemd1/unit/"));
+
+/*
+ * Implements just enough of org.freedesktop.systemd1 for the cache: ListUnitsByPatterns() on the manager and GetAll() on units.
+ * Replies are held back for the latency, and the number of calls waiting for their reply at any one time is recorded.
+ */
+class StandIn: public QDBusVirtualObject
+{
+public:
+    StandIn(const QDBusConnection& connection, int units) : m_connection(connection), m_units(units), m_listCalls(0), m_getAllCalls(0), m_unsubscribeCalls(0), m_inFlight(0), m_maxInFlight(0) {}
+
+    QString unit(int i) const
+    {
+        return QStringLiteral("standin-%1.service").arg(i);
+    }
+
+    QString path(int i) const
+    {
+        return unitPrefix + QStringLiteral("standin_2d%1_2eservice").arg(i);
+    }
+
+    QVariantMap properties(int i) const
+    {
+        QVariantMap result;
+        result.insert(QStringLiteral("Id"), unit(i));
+        result.insert(QStringLiteral("Description"), QStringLiteral("Stand-in service number %1").arg(i));
+        result.insert(QStringLiteral("LoadState"), QStringLiteral("loaded"));
+        result.insert(QStringLiteral("ActiveState"), i % 10 ? QStringLiteral("active") : QStringLiteral("inactive"));
+        result.insert(QStringLiteral("SubState"), i % 10 ? QStringLiteral("running") : QStringLiteral("dead"));
+        result.insert(QStringLiteral("FragmentPath"), QStringLiteral("/usr/lib/systemd/system/%1").arg(unit(i)));
+        return result;
+    }
+
+    bool handleMessage(const QDBusMessage& message, const QDBusConnection&) Q_DECL_OVERRIDE
+    {
+        QDBusMessage reply;
+        if(message.member() == QStringLiteral("ListUnitsByPatterns")) {
+            ++m_listCalls;
+            QList<UnitListEntry> entries;
+            for(int i = 0; i < m_units; ++i) {
+                const QVariantMap p = properties(i);
+                const UnitListEntry entry = { unit(i), p.value(QStringLiteral("Description")).toString(), p.value(QStringLiteral("LoadState")).toString(),
+                                              p.value(QStringLiteral("ActiveState")).toString(), p.value(QStringLiteral("SubState")).toString(), QString(),
+                                              QDBusObjectPath(path(i)), 0, QString(), QDBusObjectPath(QStringLiteral("/")) };
+                entries << entry;
+            }
+            reply = message.createReply(QVariant::fromValue(entries));
+        }
+        else if(message.member() == QStringLiteral("GetAll") && message.path().startsWith(unitPrefix)) {
+            ++m_getAllCalls;
+            const int i = message.path().mid(unitPrefix.size() + 10).section(QLatin1Char('_'), 0, 0).toInt();
+            reply = message.createReply(properties(i));
+        }
+        else if(message.member() == QStringLiteral("Subscribe")) {
+            // like systemd, keep track of subscriptions by bus client
+            if(m_subscribers.contains(message.service())) {
+                reply = message.createErrorReply(QStringLiteral("org.freedesktop.systemd1.AlreadySubscribed"), QStringLiteral("Client is already subscribed."));
+            }
+            else {
+                m_subscribers.insert(message.service());
+                reply = message.createReply();
+            }
+        }
+        else if(message.member() == QStringLiteral("Unsubscribe")) {
+            ++m_unsubscribeCalls;
+            if(m_subscribers.remove(message.service())) {
+                reply = message.createReply();
+            }
+            else {
+                reply = message.createErrorReply(QStringLiteral("org.freedesktop.systemd1.NotSubscribed"), QStringLiteral("Client is not subscribed."));
+            }
+        }
+        else {
+            return false;
+        }
+        message.setDelayedReply(true);
+        m_maxInFlight = qMax(m_maxInFlight, ++m_inFlight);
+        QTimer::singleShot(latency, [this, reply]() -> void {
+            --m_inFlight;
+            m_connection.send(reply);
+        });
+        return true;
+    }
+
+    QString introspect(const QString&) const Q_DECL_OVERRIDE
+    {
+        return QString();
+    }
+
+    void emitPropertiesChanged(int i, const QVariantMap& changed, const QStringList& invalidated)
+    {
+        QDBusMessage signal = QDBusMessage::createSignal(path(i), QStringLiteral("org.freedesktop.DBus.Properties"), QStringLiteral("PropertiesChanged"));
+        signal << QStringLiteral("org.freedesktop.systemd1.Unit") << changed << invalidated;
+        m_connection.send(signal);
+    }
+
+    void emitUnitRemoved(int i)
+    {
+        QDBusMessage signal = QDBusMessage::createSignal(QStringLiteral("/org/freedesktop/systemd1"), QStringLiteral("org.freedesktop.systemd1.Manager"), QStringLiteral("UnitRemoved"));
+        signal << unit(i) << QVariant::fromValue(QDBusObjectPath(path(i)));
+        m_connection.send(signal);
+    }
+public:
+    QDBusConnection m_connection;
+    int m_units;
+    int m_listCalls;
+    int m_getAllCalls;
+    int m_unsubscribeCalls;
+    int m_inFlight;
+    QSet<QString> m_subscribers;
+    int m_maxInFlight;
+};
+
+/*
+ * Runs the event loop until the signal is emitted, or the timeout expires.
+ * \return whether the signal was emitted in time.
+ */
+template<typename Signal>
+bool waitFor(UnitStateCache& cache, Signal signal, int msec = 30000)
+{
+    QEventLoop loop;
+    bool emitted = false;
+    QObject::connect(&cache, signal, &loop, [&loop, &emitted]() -> void {
+        emitted = true;
+        loop.quit();
+    });
+    QTimer::singleShot(msec, &loop, SLOT(quit()));
+    loop.exec();
+    return emitted;
+}
+
+int runBenchmark(int units)
+{
+    int result = 0;
+    QDBusConnection standInConnection = QDBusConnection::connectToBus(QDBusConnection::SessionBus, QStringLiteral("stand-in"));
+    StandIn standIn(standInConnection, units);
+    if(!standInConnection.isConnected() || !standInConnection.registerVirtualObject(QStringLiteral("/org/freedesktop/systemd1"), &standIn, QDBusConnection::SubPath) ||
+        !standInConnection.registerService(QStringLiteral("org.freedesktop.systemd1"))) {
+        qDebug() << "Failed to set up the stand-in on the session bus. Run this through dbus-run-session.";
+        return 2;
+    }
+
+    UnitStateCache cache(QDBusConnection::sessionBus());
+    cache.setPatterns(QStringList() << QStringLiteral("standin-*.service"));
+    QObject::connect(&cache, &UnitStateCache::error, [&result](const QString& name, const QString& message) -> void {
+        qDebug() << "Unexpected error:" << name << message << "\t[failed]";
+        result |= 1;
+    });
+    int batches = 0;
+    QObject::connect(&cache, &UnitStateCache::unitsChanged, [&batches](const QStringList&) -> void {
+        ++batches;
+    });
+
+    // the event loop should keep running while the cache refreshes: find the longest gap between the ticks of a 60 fps timer
+    QElapsedTimer frameTimer;
+    qint64 longestFrame = 0;
+    QTimer frames;
+    frames.setInterval(16);
+    QObject::connect(&frames, &QTimer::timeout, [&frameTimer, &longestFrame]() -> void {
+        longestFrame = qMax(longestFrame, frameTimer.restart());
+    });
+
+    QElapsedTimer timer;
+    timer.start();
+    frameTimer.start();
+    frames.start();
+    const bool started = cache.start();
+    const bool refreshed = started && waitFor(cache, &UnitStateCache::refreshed);
+    frames.stop();
+    const qint64 elapsed = timer.elapsed();
+    qDebug() << "refresh: units:" << cache.units().size() << "time (ms):" << elapsed << "serial estimate (ms):" << (qint64) (units + 1) * latency
+             << "calls: list:" << standIn.m_listCalls << "get all:" << standIn.m_getAllCalls << "most calls in flight:" << standIn.m_maxInFlight
+             << "change batches:" << batches << "longest frame (ms):" << longestFrame;
+    if(!refreshed || cache.units().size() != units || standIn.m_listCalls != 1 || standIn.m_getAllCalls != units) {
+        qDebug() << "Expected a single listing and one GetAll() call per unit" << "\t[failed]";
+        result |= 1;
+    }
+    if(standIn.m_maxInFlight < 2 || standIn.m_maxInFlight > cache.maximumPendingCalls()) {
+        qDebug() << "Expected up to" << cache.maximumPendingCalls() << "pipelined calls" << "\t[failed]";
+        result |= 1;
+    }
+    const UnitState state = cache.state(QStringLiteral("standin-3.service"));
+    if(state.activeState != QStringLiteral("active") || state.properties.value(QStringLiteral("FragmentPath")).toString() != QStringLiteral("/usr/lib/systemd/system/standin-3.service")) {
+        qDebug() << "Unexpected state of standin-3.service:" << state.activeState << state.properties << "\t[failed]";
+        result |= 1;
+    }
+
+    // a unit fails, and another is unloaded
+    QVariantMap changed;
+    changed.insert(QStringLiteral("ActiveState"), QStringLiteral("failed"));
+    changed.insert(QStringLiteral("SubState"), QStringLiteral("failed"));
+    standIn.emitPropertiesChanged(3, changed, QStringList());
+    standIn.emitUnitRemoved(4);
+    const bool signalled = waitFor(cache, &UnitStateCache::unitsChanged, 5000);
+    if(!signalled || cache.state(QStringLiteral("standin-3.service")).activeState != QStringLiteral("failed")) {
+        qDebug() << "The failure of standin-3.service was not picked up" << "\t[failed]";
+        result |= 1;
+    }
+    // the signals may be handled in separate passes of the event loop, and reported in separate batches
+    if(cache.contains(QStringLiteral("standin-4.service"))) {
+        waitFor(cache, &UnitStateCache::unitsRemoved, 5000);
+    }
+    if(cache.contains(QStringLiteral("standin-4.service"))) {
+        qDebug() << "The removal of standin-4.service was not picked up" << "\t[failed]";
+        result |= 1;
+    }
+
+    // another cache on the same connection finds it subscribed already, and must leave the subscription alone when it stops
+    UnitStateCache other(QDBusConnection::sessionBus());
+    other.setPatterns(cache.patterns());
+    const bool otherRefreshed = other.start() && waitFor(other, &UnitStateCache::refreshed);
+    other.stop();
+    cache.stop();
+    QEventLoop loop;
+    QTimer::singleShot(100 + 2 * latency, &loop, SLOT(quit()));
+    loop.exec();
+    if(!otherRefreshed || standIn.m_unsubscribeCalls != 1 || !standIn.m_subscribers.isEmpty()) {
+        qDebug() << "Expected a single Unsubscribe() call, by the cache which subscribed" << "\t[failed]";
+        result |= 1;
+    }
+    qDebug() << (result ? "Test failed." : "Test succeeded.");
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    UnitListEntry::registerMetaTypes();
+    const QStringList args = app.arguments();
+    int units = args.size() > 1 ? args.at(1).toInt() : defaultUnits;
+    if(units < 10) {
+        units = defaultUnits;
+    }
+    QTimer::singleShot(0, [units]() {
+        QCoreApplication::exit(runBenchmark(units));
+    });
+    return app.exec();
+}
@@ -1,6 +1,8 @@
 /*
  * This is a simple test application to demonstrate the use of UTF8Reader and give that code a bit of light exercise.
  * It tests four different, well understood malformed UTF8 sequences.
+ * It also checks that the vectorised mode reports exactly the same as the (reference) text stream mode when the sequences are embedded in longer runs of ASCII,
+ * and that text stream mode recovers in the same way when reading from a device which cannot seek (like a pipe).
  */
 #include <QBuffer>
 #include <QByteArray>
@@ -9,6 +11,7 @@
 #include <QChar>
 #include <QString>
 #include <QCoreApplication>
+#include <cstring>
 
 #include "../../src/utf8/utf8_reader.h"
 
@@ -31,9 +34,9 @@ bool check_char(int count, QChar got, QChar expect)
     }
 }
 
-int test(const char* data, quint32 len, QChar lead, QByteArray invalid, QChar next, const char* msg)
+int test(UTF8Reader::Mode mode, const char* data, quint32 len, QChar lead, QByteArray invalid, QChar next, const char* msg)
 {
-    qDebug() << "\nStarting test case:" << msg;
+    qDebug() << "\nStarting test case:" << msg << "mode:" << mode;
     QBuffer buf;
     const QByteArray charData(data, len);
     buf.setData(charData);
@@ -41,7 +44,7 @@ int test(const char* data, quint32 len, QChar lead, QByteArray invalid, QChar ne
         qDebug() << "Failed to open the buffer QIODevice!";
         return 2;
     }
-    UTF8Reader reader;
+    UTF8Reader reader(mode);
     int count = 0, result = 0;
     auto sig1 = QObject::connect(&reader, &UTF8Reader::reportBytes, [&result,&invalid](QByteArray seq, qint64 off, qint64 absOff) -> void {
         bool offsetsCheck= off == 1 && absOff == 1;
@@ -81,13 +84,127 @@ int test(const char* data, quint32 len, QChar lead, QByteArray invalid, QChar ne
 }
 
 
-#define INVOKE_TEST(a,msg) (test(a, 4, QLatin1Char(a[0]), QByteArray(&a[1], 2), QLatin1Char(a[3]), msg))
+/*
+ * A read-only device which behaves like a pipe: it is sequential and cannot seek.
+ */
+class PipeDevice: public QIODevice
+{
+public:
+    PipeDevice(const QByteArray& data) : m_data(data), m_pos(0) {}
+    bool isSequential() const Q_DECL_OVERRIDE { return true; }
+    qint64 bytesAvailable() const Q_DECL_OVERRIDE { return m_data.size() - m_pos + QIODevice::bytesAvailable(); }
+protected:
+    qint64 readData(char* data, qint64 maxSize) Q_DECL_OVERRIDE
+    {
+        qint64 size = qMin(maxSize, m_data.size() - m_pos);
+        memcpy(data, m_data.constData() + m_pos, size);
+        m_pos += size;
+        return size;
+    }
+    qint64 writeData(const char*, qint64) Q_DECL_OVERRIDE { return -1; }
+private:
+    const QByteArray m_data;
+    qint64 m_pos;
+};
+
+/*
+ * Records everything the UTF8Reader reports as a single string, so the results of different modes can be compared.
+ */
+QString transcript(UTF8Reader::Mode mode, QIODevice& input)
+{
+    QString result;
+    UTF8Reader reader(mode);
+    QList<QMetaObject::Connection> cs;
+    cs.append(QObject::connect(&reader, &UTF8Reader::push, [&result](QChar c) -> void {
+        result.append(c);
+    }));
+    cs.append(QObject::connect(&reader, &UTF8Reader::pushPair, [&result](QChar fst, QChar snd) -> void {
+        result.append(fst).append(snd);
+    }));
+    cs.append(QObject::connect(&reader, &UTF8Reader::reportBytes, [&result](QByteArray seq, qint64 off, qint64 absOff) -> void {
+        result.append(QStringLiteral("<invalid:%1@%2/%3>").arg(QString::fromLatin1(seq.toHex())).arg(off).arg(absOff));
+    }));
+    cs.append(QObject::connect(&reader, &UTF8Reader::recoveryError, [&result](qint64 at) -> void {
+        result.append(QStringLiteral("<recovery error@%1>").arg(at));
+    }));
+    cs.append(QObject::connect(&reader, &UTF8Reader::done, [&result](void) -> void {
+        result.append(QStringLiteral("<done>"));
+    }));
+    cs.append(QObject::connect(&reader, &UTF8Reader::doneWithInvalidBytes, [&result](void) -> void {
+        result.append(QStringLiteral("<done with invalid bytes>"));
+    }));
+    cs.append(QObject::connect(&reader, &UTF8Reader::failed, [&result](void) -> void {
+        result.append(QStringLiteral("<failed>"));
+    }));
+    reader.consume(input);
+    for(auto c: cs) {
+        QObject::disconnect(c);
+    }
+    return result;
+}
+
+QString transcript(UTF8Reader::Mode mode, const QByteArray& data, bool sequential)
+{
+    if(sequential) {
+        PipeDevice pipe(data);
+        if(!pipe.open(QIODevice::ReadOnly)) {
+            return QStringLiteral("<unable to open pipe>");
+        }
+        return transcript(mode, pipe);
+    }
+    else {
+        QBuffer buf;
+        buf.setData(data);
+        if(!buf.open(QIODevice::ReadOnly)) {
+            return QStringLiteral("<unable to open buffer>");
+        }
+        return transcript(mode, buf);
+    }
+}
+
+int compareWithTextStream(UTF8Reader::Mode mode, bool sequential, const char* data, quint32 len, const char* msg)
+{
+    qDebug() << "\nComparing mode:" << mode << (sequential ? "reading from a pipe" : "") << "against text stream mode:" << msg;
+    // Pad the malformed sequence with enough ASCII to span several 16/32 byte steps of the vectorised scanner on either side.
+    const QByteArray padding(67, 'x');
+    const QByteArray sequence(data, len);
+    const QByteArray input = padding + sequence + padding + sequence + sequence + padding;
+    const QString expect = transcript(UTF8Reader::TextStream, input, false), got = transcript(mode, input, sequential);
+    if(expect == got) {
+        qDebug() << "Comparison of reported characters and invalid byte sequences [passed]";
+        return 0;
+    }
+    else {
+        qDebug() << "Comparison of reported characters and invalid byte sequences [failed]";
+        qDebug() << "Expected:" << expect;
+        qDebug() << "Got:" << got;
+        return 1;
+    }
+}
+
+#define INVOKE_TEST(m,a,msg) (test(m, a, 4, QLatin1Char(a[0]), QByteArray(&a[1], 2), QLatin1Char(a[3]), msg))
+
+int runTests(UTF8Reader::Mode mode)
+{
+    return INVOKE_TEST(mode, overLongSpace,"Testing detection of over long encoded ASCII") | 
+        INVOKE_TEST(mode, missingMultiByte, "Testing missing trailing byte of multi-byte sequence") |
+        INVOKE_TEST(mode, invalidMultiByte, "Testing invalid leading byte of multi-byte sequence");
+}
+
+#define INVOKE_COMPARE(m,s,a,msg) (compareWithTextStream(m, s, a, 4, msg))
+
+int compareModes(UTF8Reader::Mode mode, bool sequential)
+{
+    return INVOKE_COMPARE(mode, sequential, overLongSpace, "over long encoded ASCII") |
+        INVOKE_COMPARE(mode, sequential, missingMultiByte, "missing trailing byte of multi-byte sequence") |
+        INVOKE_COMPARE(mode, sequential, invalidMultiByte, "invalid leading byte of multi-byte sequence");
+}
 
 int runTests(void)
 {
-    return INVOKE_TEST(overLongSpace,"Testing detection of over long encoded ASCII") | 
-        INVOKE_TEST(missingMultiByte, "Testing missing trailing byte of multi-byte sequence") |
-        INVOKE_TEST(invalidMultiByte, "Testing invalid leading byte of multi-byte sequence");
+    return runTests(UTF8Reader::TextStream) | runTests(UTF8Reader::Bulk) | runTests(UTF8Reader::Vectorised) |
+        compareModes(UTF8Reader::Bulk, false) | compareModes(UTF8Reader::Vectorised, false) |
+        compareModes(UTF8Reader::TextStream, true) | compareModes(UTF8Reader::Vectorised, true);
 }
 
 int main(int argc, char** argv) 
@@ -0,0 +1,319 @@
+#include "journal_reader.h"
+
+#include <QAtomicInt>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <cstdlib>
+#include <cstring>
+
+#include <systemd/sd-journal.h>
+
+/*
+ * How long the worker waits for new entries (in microseconds) before it checks whether it should stop.
+ */
+static const quint64 waitTimeout = 100 * 1000;
+
+/*
+ * Looks up a field of the current entry. The value points into the journal file, and is only valid until the next field is looked up.
+ */
+static bool field(sd_journal * journal, const char * name, const char *& value, int& size)
+{
+    const void * data = 0;
+    size_t length = 0;
+    if(sd_journal_get_data(journal, name, &data, &length) < 0) {
+        return false;
+    }
+    // data is name=value
+    const size_t prefix = strlen(name) + 1;
+    value = static_cast<const char *>(data) + prefix;
+    size = (int) (length - prefix);
+    return true;
+}
+
+static int number(const char * text, int size)
+{
+    int result = 0;
+    for(int i = 0; i < size && text[i] >= '0' && text[i] <= '9'; ++i) {
+        result = result * 10 + (text[i] - '0');
+    }
+    return result;
+}
+
+class JournalReaderPrivate;
+
+class JournalThread: public QThread
+{
+public:
+    JournalThread(JournalReaderPrivate * reader) : m_reader(reader) {}
+protected:
+    void run(void) Q_DECL_OVERRIDE;
+private:
+    JournalReaderPrivate * const m_reader;
+};
+
+class JournalReaderPrivate
+{
+public:
+    JournalReaderPrivate(JournalRing * ring, JournalReader * q) : q_ptr(q), m_ring(ring), m_batchSize(512), m_follow(true), m_lines(0), m_thread(0) {}
+
+    void start(void)
+    {
+        m_stop.store(0);
+        m_thread = new JournalThread(this);
+        m_thread->start();
+    }
+
+    void stop(void)
+    {
+        if(m_thread) {
+            m_stop.store(1);
+            m_thread->wait();
+            delete m_thread;
+            m_thread = 0;
+        }
+    }
+
+    int addMatches(sd_journal * journal) const
+    {
+        const QByteArray unit = m_unit.toUtf8();
+        const QByteArray process = QByteArray("_SYSTEMD_UNIT=") + unit;
+        const QByteArray manager = QByteArray("UNIT=") + unit;
+        // entries logged by the processes of the unit, or by systemd (PID 1) about the unit
+        int r = sd_journal_add_match(journal, process.constData(), (size_t) process.size());
+        if(r >= 0) {
+            r = sd_journal_add_disjunction(journal);
+        }
+        if(r >= 0) {
+            r = sd_journal_add_match(journal, manager.constData(), (size_t) manager.size());
+        }
+        if(r >= 0) {
+            r = sd_journal_add_match(journal, "_PID=1", 0);
+        }
+        return r;
+    }
+
+    /*
+     * Moves to where reading starts. If positioned is set, the current entry is the first one to read; otherwise it is the one after it.
+     */
+    int seek(sd_journal * journal, bool& positioned) const
+    {
+        int r;
+        if(!m_startCursor.isEmpty()) {
+            r = sd_journal_seek_cursor(journal, m_startCursor.constData());
+            if(r >= 0) {
+                r = sd_journal_next(journal);
+            }
+            // the entry at the cursor was read before. Should it be gone, the entry which took its place is the first one to read
+            positioned = r > 0 && sd_journal_test_cursor(journal, m_startCursor.constData()) <= 0;
+            return r;
+        }
+        r = sd_journal_seek_tail(journal);
+        if(r >= 0) {
+            r = sd_journal_previous_skip(journal, (uint64_t) qMax(1, m_lines));
+        }
+        positioned = r > 0 && m_lines > 0;
+        return r;
+    }
+
+    /*
+     * Adds the current entry to the ring, unpublished. The identifier and message are copied from the journal file straight into the ring, other
+     * fields are parsed in place.
+     */
+    void read(sd_journal * journal) const
+    {
+        uint64_t usec = 0;
+        sd_journal_get_realtime_usec(journal, &usec);
+        const char * value = 0;
+        int size = 0;
+        const int priority = field(journal, "PRIORITY", value, size) ? number(value, size) : -1;
+        const int pid = field(journal, "_PID", value, size) ? number(value, size) : 0;
+        m_ring->add((qint64) usec, pid, priority);
+        if(field(journal, "SYSLOG_IDENTIFIER", value, size) || field(journal, "_COMM", value, size)) {
+            m_ring->setIdentifier(value, size);
+        }
+        if(field(journal, "MESSAGE", value, size)) {
+            m_ring->setMessage(value, size);
+        }
+    }
+
+    void updateCursor(sd_journal * journal)
+    {
+        char * cursor = 0;
+        if(sd_journal_get_cursor(journal, &cursor) >= 0) {
+            QMutexLocker lock(&m_lock);
+            m_cursor = QByteArray(cursor);
+            free(cursor);
+        }
+    }
+
+    void run(void)
+    {
+        Q_Q(JournalReader);
+        sd_journal * journal = 0;
+        int r = m_directory.isEmpty() ? sd_journal_open(&journal, SD_JOURNAL_LOCAL_ONLY) :
+            sd_journal_open_directory(&journal, QFile::encodeName(m_directory).constData(), 0);
+        if(r < 0) {
+            Q_EMIT q->failed(r);
+            return;
+        }
+        // fields are never kept beyond this size, so there is no point in decompressing more of them
+        sd_journal_set_data_threshold(journal, JournalRing::maximumEntrySize);
+        if(!m_unit.isEmpty()) {
+            r = addMatches(journal);
+        }
+        bool positioned = false;
+        if(r >= 0) {
+            r = seek(journal, positioned);
+        }
+        bool caughtUp = false;
+        while(r >= 0 && !m_stop.load()) {
+            int added = 0;
+            while(added < m_batchSize) {
+                r = positioned ? 1 : sd_journal_next(journal);
+                positioned = false;
+                if(r <= 0) {
+                    break;
+                }
+                read(journal);
+                ++added;
+            }
+            if(added > 0) {
+                updateCursor(journal);
+                m_ring->publish();
+                Q_EMIT q->appended(m_ring->end());
+            }
+            if(r == 0) {
+                if(!caughtUp) {
+                    caughtUp = true;
+                    Q_EMIT q->caughtUp();
+                }
+                if(!m_follow) {
+                    break;
+                }
+                r = sd_journal_wait(journal, waitTimeout);
+            }
+        }
+        if(r < 0) {
+            Q_EMIT q->failed(r);
+        }
+        sd_journal_close(journal);
+    }
+private:
+    JournalReader * const q_ptr;
+    Q_DECLARE_PUBLIC(JournalReader)
+public:
+    JournalRing * const m_ring;
+    QString m_unit;
+    QString m_directory;
+    int m_batchSize;
+    bool m_follow;
+    int m_lines;
+    QByteArray m_startCursor;
+    JournalThread * m_thread;
+    QAtomicInt m_stop;
+    mutable QMutex m_lock;
+    /**
+     * \brief the cursor of the last entry appended, guarded by m_lock.
+     */
+    QByteArray m_cursor;
+};
+
+void JournalThread::run(void)
+{
+    m_reader->run();
+}
+
+JournalReader::JournalReader(JournalRing * ring, QObject * parent) : QObject(parent), d_ptr(new JournalReaderPrivate(ring, this)) {}
+
+JournalReader::~JournalReader()
+{
+    stop();
+    delete d_ptr;
+}
+
+void JournalReader::setUnit(const QString& unit)
+{
+    Q_D(JournalReader);
+    d->m_unit = unit;
+}
+
+QString JournalReader::unit(void) const
+{
+    Q_D(const JournalReader);
+    return d->m_unit;
+}
+
+void JournalReader::setDirectory(const QString& directory)
+{
+    Q_D(JournalReader);
+    d->m_directory = directory;
+}
+
+QString JournalReader::directory(void) const
+{
+    Q_D(const JournalReader);
+    return d->m_directory;
+}
+
+void JournalReader::setBatchSize(int size)
+{
+    Q_D(JournalReader);
+    d->m_batchSize = qMax(1, size);
+}
+
+int JournalReader::batchSize(void) const
+{
+    Q_D(const JournalReader);
+    return d->m_batchSize;
+}
+
+void JournalReader::setFollow(bool follow)
+{
+    Q_D(JournalReader);
+    d->m_follow = follow;
+}
+
+bool JournalReader::follow(void) const
+{
+    Q_D(const JournalReader);
+    return d->m_follow;
+}
+
+void JournalReader::start(int lines)
+{
+    Q_D(JournalReader);
+    d->stop();
+    d->m_lines = qMax(0, lines);
+    d->m_startCursor.clear();
+    d->start();
+}
+
+void JournalReader::start(const QByteArray& cursor)
+{
+    Q_D(JournalReader);
+    d->stop();
+    d->m_startCursor = cursor;
+    d->start();
+}
+
+void JournalReader::stop(void)
+{
+    Q_D(JournalReader);
+    d->stop();
+}
+
+bool JournalReader::isRunning(void) const
+{
+    Q_D(const JournalReader);
+    return d->m_thread && d->m_thread->isRunning();
+}
+
+QByteArray JournalReader::cursor(void) const
+{
+    Q_D(const JournalReader);
+    QMutexLocker lock(&d->m_lock);
+    return d->m_cursor;
+}
@@ -0,0 +1,91 @@
+#ifndef SD_UIKIT_JOURNAL_READER
+#define SD_UIKIT_JOURNAL_READER
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+
+#include "journal_ring.h"
+
+class JournalReaderPrivate;
+
+/**
+ * \brief Reads the journal entries of a unit through sd_journal on a worker thread, and appends them to a JournalRing in batches.
+ *
+ * Reading starts either with the last so many entries (#start(int)) or right after the entry with a given cursor (#start(const QByteArray&)),
+ * and by default carries on with entries as they are logged. Entries are read one batch at a time; the cursor of the last entry of each batch
+ * is kept, so reading may be picked up where it left off, e.g. after the reader was stopped.
+ *
+ * Fields are copied straight from the memory mapped journal files into the ring, and published one batch at a time. The ring holds a fixed
+ * number of entries: memory use does not depend on how much of the history is read, and reading does not allocate per entry.
+ *
+ * Signals are emitted from the worker thread, and are therefore queued to receivers in other threads.
+ */
+class JournalReader: public QObject
+{
+    Q_OBJECT
+public:
+    JournalReader(JournalRing * ring, QObject * parent = 0);
+    virtual ~JournalReader();
+    /**
+     * \brief sets the unit of which to read entries: those logged by its processes, and those logged by systemd about it.
+     * The default is an empty string, which reads all entries.
+     */
+    void setUnit(const QString& unit);
+    QString unit(void) const;
+    /**
+     * \brief sets the directory to read journal files from (like journalctl --directory). The default is an empty string, which reads the
+     * journal of the local system.
+     */
+    void setDirectory(const QString& directory);
+    QString directory(void) const;
+    /**
+     * \brief sets the number of entries read before they are appended to the ring. The default is 512.
+     */
+    void setBatchSize(int size);
+    int batchSize(void) const;
+    /**
+     * \brief sets whether to wait for new entries once all entries logged so far are read. The default is true.
+     */
+    void setFollow(bool follow);
+    bool follow(void) const;
+    /**
+     * \brief starts reading with the last entries, stopping reading first if need be. If lines is 0, only entries logged from now on are read.
+     */
+    void start(int lines);
+    /**
+     * \brief starts reading with the entry after the one with the given cursor, stopping reading first if need be.
+     */
+    void start(const QByteArray& cursor);
+    /**
+     * \brief stops reading, waiting for the worker thread to finish.
+     */
+    void stop(void);
+    bool isRunning(void) const;
+    /**
+     * \brief the cursor of the last entry appended to the ring, or an empty array if none was appended yet.
+     */
+    QByteArray cursor(void) const;
+Q_SIGNALS:
+    /**
+     * \brief emitted after a batch of entries was appended to the ring.
+     * \param end JournalRing::end() after the batch was appended.
+     */
+    void appended(qint64 end);
+    /**
+     * \brief emitted once all entries logged when reading started were read.
+     */
+    void caughtUp(void);
+    /**
+     * \brief emitted when the journal cannot be opened or read.
+     * \param error a negative errno-style error code, as returned by sd_journal.
+     */
+    void failed(int error);
+private:
+    Q_DISABLE_COPY(JournalReader)
+
+    Q_DECLARE_PRIVATE(JournalReader)
+    JournalReaderPrivate *const d_ptr;
+};
+
+#endif
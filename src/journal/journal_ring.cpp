@@ -0,0 +1,151 @@
+#include "journal_ring.h"
+
+#include <QMutexLocker>
+
+#include <cstring>
+
+JournalRing::JournalRing(int capacity, int textCapacity) :
+    m_records(qMax(1, capacity)), m_text(qMax(2 * (int) maximumEntrySize, textCapacity), Qt::Uninitialized), m_recordData(m_records.data()),
+    m_textData(m_text.data()), m_first(0), m_end(0), m_textBegin(0), m_textEnd(0), m_addedEnd(0), m_addedTextEnd(0)
+{
+}
+
+int JournalRing::capacity(void) const
+{
+    return m_records.size();
+}
+
+qint64 JournalRing::first(void) const
+{
+    QMutexLocker lock(&m_lock);
+    return m_first;
+}
+
+qint64 JournalRing::end(void) const
+{
+    QMutexLocker lock(&m_lock);
+    return m_end;
+}
+
+int JournalRing::size(void) const
+{
+    QMutexLocker lock(&m_lock);
+    return (int) (m_end - m_first);
+}
+
+bool JournalRing::contains(qint64 entry) const
+{
+    QMutexLocker lock(&m_lock);
+    return entry >= m_first && entry < m_end;
+}
+
+void JournalRing::add(qint64 realtime, qint32 pid, int priority)
+{
+    QMutexLocker lock(&m_lock);
+    const qint64 textCapacity = m_text.size();
+    // the text of an entry is kept in one piece, so room is made for the longest one: if it does not fit in the rest of the buffer, it goes at
+    // the start
+    qint64 position = m_addedTextEnd;
+    const qint64 offset = position % textCapacity;
+    if(offset + maximumEntrySize > textCapacity) {
+        position += textCapacity - offset;
+    }
+    // entries which are not published yet are never evicted: should the ring be full of them, they are published first
+    if(m_addedEnd - m_end == m_records.size() || position + maximumEntrySize - m_textEnd > textCapacity) {
+        publishAdded();
+    }
+    while(m_end > m_first && (m_addedEnd - m_first == m_records.size() || position + maximumEntrySize - m_textBegin > textCapacity)) {
+        evict();
+    }
+    const JournalRecord record = { realtime, position, pid, (qint16) priority, 0, 0, 0 };
+    m_recordData[m_addedEnd % m_records.size()] = record;
+    m_addedTextEnd = position;
+    ++m_addedEnd;
+}
+
+void JournalRing::setIdentifier(const char * identifier, int size)
+{
+    JournalRecord& record = m_recordData[(m_addedEnd - 1) % m_records.size()];
+    appendText(record, identifier, size, record.identifierLength);
+}
+
+void JournalRing::setMessage(const char * message, int size)
+{
+    JournalRecord& record = m_recordData[(m_addedEnd - 1) % m_records.size()];
+    appendText(record, message, size, record.messageLength);
+}
+
+void JournalRing::publish(void)
+{
+    QMutexLocker lock(&m_lock);
+    publishAdded();
+}
+
+void JournalRing::clear(void)
+{
+    QMutexLocker lock(&m_lock);
+    m_first = m_end;
+    m_textBegin = m_textEnd;
+}
+
+JournalRecord JournalRing::record(qint64 entry) const
+{
+    QMutexLocker lock(&m_lock);
+    return at(entry);
+}
+
+QString JournalRing::identifier(qint64 entry) const
+{
+    QMutexLocker lock(&m_lock);
+    const JournalRecord& record = at(entry);
+    return QString::fromUtf8(text(record), (int) record.identifierLength);
+}
+
+QString JournalRing::message(qint64 entry) const
+{
+    QMutexLocker lock(&m_lock);
+    const JournalRecord& record = at(entry);
+    return QString::fromUtf8(text(record) + record.identifierLength, (int) record.messageLength);
+}
+
+qint64 JournalRing::footprint(void) const
+{
+    return (qint64) m_records.capacity() * sizeof(JournalRecord) + m_text.capacity();
+}
+
+void JournalRing::publishAdded(void)
+{
+    m_end = m_addedEnd;
+    m_textEnd = m_addedTextEnd;
+}
+
+/*
+ * Copies text straight into the space set aside for the entry last added. No entry which may be read uses that space, so this needs no lock.
+ */
+void JournalRing::appendText(JournalRecord& record, const char * text, int size, quint32& length)
+{
+    const qint64 used = record.identifierLength + record.messageLength;
+    if(size > maximumEntrySize - used) {
+        size = (int) (maximumEntrySize - used);
+        record.flags |= JournalRecord::Truncated;
+    }
+    memcpy(m_textData + (record.text + used) % m_text.size(), text, (size_t) size);
+    length += (quint32) size;
+    m_addedTextEnd = record.text + used + size;
+}
+
+void JournalRing::evict(void)
+{
+    ++m_first;
+    m_textBegin = m_first < m_end ? at(m_first).text : m_textEnd;
+}
+
+const JournalRecord& JournalRing::at(qint64 entry) const
+{
+    return m_records.at((int) (entry % m_records.size()));
+}
+
+const char * JournalRing::text(const JournalRecord& record) const
+{
+    return m_text.constData() + record.text % m_text.size();
+}
@@ -0,0 +1,136 @@
+#ifndef SD_UIKIT_JOURNAL_RING
+#define SD_UIKIT_JOURNAL_RING
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+/**
+ * \brief A journal entry, as kept by JournalRing. The text of the entry (its identifier followed by its message) is kept separately by the ring.
+ */
+struct JournalRecord
+{
+    enum Flags {
+        /**
+         * \brief the identifier and message were cut short at JournalRing::maximumEntrySize bytes.
+         */
+        Truncated = 0x1
+    };
+    /**
+     * \brief the time the entry was logged, in microseconds since the epoch.
+     */
+    qint64 realtime;
+    /**
+     * \brief the position of the text of the entry in the ring.
+     */
+    qint64 text;
+    qint32 pid;
+    /**
+     * \brief the syslog priority, from 0 (emerg) to 7 (debug), or -1 if the entry has none.
+     */
+    qint16 priority;
+    quint16 flags;
+    quint32 identifierLength;
+    quint32 messageLength;
+};
+
+Q_DECLARE_TYPEINFO(JournalRecord, Q_PRIMITIVE_TYPE);
+
+/**
+ * \brief Keeps the most recent journal entries read, up to a fixed number of entries and a fixed number of bytes of text.
+ * All memory is taken up front: entries are kept in a circular array of records, and their text in a circular buffer in which the text of each
+ * entry is kept in one piece. Adding entries evicts the oldest ones once either is full, so memory use does not depend on the number of
+ * entries read.
+ *
+ * Entries are addressed by sequence number: the first entry ever added is 0, and numbers are never reused. Entries #first() up to (but not
+ * including) #end() are available.
+ *
+ * Entries are added in batches: #add(), #setIdentifier() and #setMessage() write an entry straight into space set aside for it in the ring,
+ * and #publish() makes the entries added so far available at once. Entries may be added from one thread while the ring is read from others.
+ */
+class JournalRing
+{
+public:
+    enum {
+        /**
+         * \brief the number of bytes kept of the identifier and message of an entry together.
+         */
+        maximumEntrySize = 8192
+    };
+    /**
+     * \param capacity the number of entries kept.
+     * \param textCapacity the number of bytes of text kept. At least twice #maximumEntrySize is used.
+     */
+    JournalRing(int capacity = 100000, int textCapacity = 16 * 1024 * 1024);
+    int capacity(void) const;
+    /**
+     * \brief the sequence number of the oldest entry kept.
+     */
+    qint64 first(void) const;
+    /**
+     * \brief the sequence number the next entry published will get.
+     */
+    qint64 end(void) const;
+    int size(void) const;
+    bool contains(qint64 entry) const;
+    /**
+     * \brief starts a new entry, evicting old entries as needed. Its identifier, then its message, are set by #setIdentifier() and
+     * #setMessage(). The entry is not available until #publish() is called, unless so many entries are added that they would not fit in the
+     * ring, in which case those added before it are published first.
+     */
+    void add(qint64 realtime, qint32 pid, int priority);
+    /**
+     * \brief copies the identifier of the entry last added into the ring.
+     */
+    void setIdentifier(const char * identifier, int size);
+    /**
+     * \brief copies the message of the entry last added into the ring.
+     */
+    void setMessage(const char * message, int size);
+    /**
+     * \brief makes the entries added since the last call available.
+     */
+    void publish(void);
+    void clear(void);
+    /**
+     * \brief the record of an entry. Its text position is of no use outside of the ring.
+     */
+    JournalRecord record(qint64 entry) const;
+    QString identifier(qint64 entry) const;
+    QString message(qint64 entry) const;
+    /**
+     * \brief the memory taken by the ring, in bytes.
+     */
+    qint64 footprint(void) const;
+private:
+    Q_DISABLE_COPY(JournalRing)
+    void evict(void);
+    void publishAdded(void);
+    void appendText(JournalRecord& record, const char * text, int size, quint32& length);
+    const JournalRecord& at(qint64 entry) const;
+    const char * text(const JournalRecord& record) const;
+private:
+    mutable QMutex m_lock;
+    QVector<JournalRecord> m_records;
+    QByteArray m_text;
+    /**
+     * \brief the data of m_records and m_text, taken once so that the adding thread never calls their non const members.
+     */
+    JournalRecord * const m_recordData;
+    char * const m_textData;
+    qint64 m_first;
+    qint64 m_end;
+    /**
+     * \brief the text of the entries kept spans from m_textBegin up to m_textEnd, counting bytes ever written (including padding).
+     */
+    qint64 m_textBegin;
+    qint64 m_textEnd;
+    /**
+     * \brief the end of the entries added and of their text, including those not published yet. Only used by the adding thread.
+     */
+    qint64 m_addedEnd;
+    qint64 m_addedTextEnd;
+};
+
+#endif
@@ -0,0 +1,27 @@
+#include "unit_list_entry.h"
+
+#include <QDBusMetaType>
+
+void UnitListEntry::registerMetaTypes(void)
+{
+    qDBusRegisterMetaType<UnitListEntry>();
+    qDBusRegisterMetaType<QList<UnitListEntry> >();
+}
+
+QDBusArgument& operator<<(QDBusArgument& argument, const UnitListEntry& entry)
+{
+    argument.beginStructure();
+    argument << entry.unit << entry.description << entry.loadState << entry.activeState << entry.subState << entry.followed << entry.path
+             << entry.jobId << entry.jobType << entry.jobPath;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument& operator>>(const QDBusArgument& argument, UnitListEntry& entry)
+{
+    argument.beginStructure();
+    argument >> entry.unit >> entry.description >> entry.loadState >> entry.activeState >> entry.subState >> entry.followed >> entry.path
+             >> entry.jobId >> entry.jobType >> entry.jobPath;
+    argument.endStructure();
+    return argument;
+}
@@ -0,0 +1,42 @@
+#ifndef SD_UIKIT_MANAGER_UNIT_LIST_ENTRY
+#define SD_UIKIT_MANAGER_UNIT_LIST_ENTRY
+
+#include <QDBusArgument>
+#include <QDBusObjectPath>
+#include <QList>
+#include <QMetaType>
+#include <QString>
+
+/**
+ * \brief A unit as listed by the ListUnits() and ListUnitsByPatterns() methods of org.freedesktop.systemd1.Manager, i.e. the D-Bus structure (ssssssouso).
+ */
+struct UnitListEntry
+{
+    QString unit;
+    QString description;
+    QString loadState;
+    QString activeState;
+    QString subState;
+    /**
+     * \brief the unit this unit follows in its state, or an empty string.
+     */
+    QString followed;
+    QDBusObjectPath path;
+    /**
+     * \brief the id of the job queued for the unit, or 0 if there is none.
+     */
+    quint32 jobId;
+    QString jobType;
+    QDBusObjectPath jobPath;
+    /**
+     * \brief registers UnitListEntry and QList<UnitListEntry> with the D-Bus type system. Must be called before either is sent or received.
+     */
+    static void registerMetaTypes(void);
+};
+
+QDBusArgument& operator<<(QDBusArgument& argument, const UnitListEntry& entry);
+const QDBusArgument& operator>>(const QDBusArgument& argument, UnitListEntry& entry);
+
+Q_DECLARE_METATYPE(UnitListEntry)
+
+#endif
@@ -0,0 +1,517 @@
+#include "unit_state_cache.h"
+#include "unit_list_entry.h"
+
+#include <QDBusError>
+#include <QDBusPendingCall>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QHash>
+#include <QQueue>
+#include <QRegExp>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+
+#include <algorithm>
+
+static const QString systemdService(QStringLiteral("org.freedesktop.systemd1"));
+static const QString managerPath(QStringLiteral("/org/freedesktop/systemd1"));
+static const QString managerInterface(QStringLiteral("org.freedesktop.systemd1.Manager"));
+static const QString unitInterface(QStringLiteral("org.freedesktop.systemd1.Unit"));
+static const QString propertiesInterface(QStringLiteral("org.freedesktop.DBus.Properties"));
+static const QString unknownMethod(QStringLiteral("org.freedesktop.DBus.Error.UnknownMethod"));
+static const QString unknownObject(QStringLiteral("org.freedesktop.DBus.Error.UnknownObject"));
+static const QString noSuchUnit(QStringLiteral("org.freedesktop.systemd1.NoSuchUnit"));
+
+bool UnitState::isValid(void) const
+{
+    return !unit.isEmpty();
+}
+
+static QStringList sorted(const QSet<QString>& units)
+{
+    QStringList result = units.values();
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+class UnitStateCachePrivate
+{
+public:
+    UnitStateCachePrivate(const QDBusConnection& connection, UnitStateCache * q) : q_ptr(q), m_connection(connection), m_maxPending(64), m_pending(0),
+        m_active(false), m_subscribed(false), m_listing(false), m_refreshing(false), m_refreshAgain(false), m_legacy(false)
+    {
+        UnitListEntry::registerMetaTypes();
+        m_flush.setSingleShot(true);
+        m_flush.setInterval(0);
+        QObject::connect(&m_flush, &QTimer::timeout, q, [this]() -> void {
+            flush();
+        });
+    }
+
+    bool matches(const QString& unit) const
+    {
+        if(m_matchers.isEmpty()) {
+            return true;
+        }
+        for(const QRegExp& matcher: m_matchers) {
+            if(matcher.exactMatch(unit)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    QDBusPendingCallWatcher * call(const QDBusMessage& message)
+    {
+        Q_Q(UnitStateCache);
+        ++m_pending;
+        return new QDBusPendingCallWatcher(m_connection.asyncCall(message), q);
+    }
+
+    /*
+     * Reports the changes collected so far, once control returns to the event loop. While refreshing, changes are held back until the
+     * units are listed and until their properties are fetched, so the replies to a refresh are reported in two batches rather than one by one.
+     */
+    void scheduleFlush(void)
+    {
+        if(!m_refreshing && !m_flush.isActive()) {
+            m_flush.start();
+        }
+    }
+
+    void flush(void)
+    {
+        Q_Q(UnitStateCache);
+        m_flush.stop();
+        if(!m_removed.isEmpty()) {
+            const QStringList removed = sorted(m_removed);
+            m_removed.clear();
+            Q_EMIT q->unitsRemoved(removed);
+        }
+        if(!m_changed.isEmpty()) {
+            const QStringList changed = sorted(m_changed);
+            m_changed.clear();
+            Q_EMIT q->unitsChanged(changed);
+        }
+    }
+
+    void markChanged(const QString& unit)
+    {
+        m_removed.remove(unit);
+        m_changed.insert(unit);
+        scheduleFlush();
+    }
+
+    void remove(const QString& unit)
+    {
+        const QHash<QString, UnitState>::iterator it = m_units.find(unit);
+        if(it == m_units.end()) {
+            return;
+        }
+        m_paths.remove(it.value().path);
+        m_units.erase(it);
+        m_changed.remove(unit);
+        m_removed.insert(unit);
+        scheduleFlush();
+    }
+
+    void enqueue(const QString& unit)
+    {
+        if(!m_queued.contains(unit)) {
+            m_queued.insert(unit);
+            m_queue.enqueue(unit);
+        }
+    }
+
+    void fail(const QDBusError& error)
+    {
+        Q_Q(UnitStateCache);
+        Q_EMIT q->error(error.name(), error.message());
+    }
+
+    void list(void)
+    {
+        Q_Q(UnitStateCache);
+        m_listing = true;
+        m_refreshing = true;
+        QDBusMessage message = QDBusMessage::createMethodCall(systemdService, managerPath, managerInterface,
+                                                              m_legacy ? QStringLiteral("ListUnits") : QStringLiteral("ListUnitsByPatterns"));
+        if(!m_legacy) {
+            // the states to list (all of them), then the patterns
+            message << QStringList() << m_patterns;
+        }
+        QObject::connect(call(message), &QDBusPendingCallWatcher::finished, q, [this](QDBusPendingCallWatcher * watcher) -> void {
+            watcher->deleteLater();
+            --m_pending;
+            const QDBusPendingReply<QList<UnitListEntry> > reply = *watcher;
+            if(reply.isError() && reply.error().name() == unknownMethod && !m_legacy) {
+                m_legacy = true;
+                list();
+                return;
+            }
+            m_listing = false;
+            if(reply.isError()) {
+                // the refresh is given up: refreshed() is only emitted once the units are listed
+                m_refreshing = false;
+                fail(reply.error());
+            }
+            else {
+                listed(reply.value());
+            }
+            if(m_refreshAgain) {
+                m_refreshAgain = false;
+                list();
+                return;
+            }
+            flush();
+            pump();
+        });
+    }
+
+    /*
+     * Brings the cache in line with the units listed: units which are no longer loaded are removed, the state of the others is updated and
+     * their properties are queued to be fetched.
+     */
+    void listed(const QList<UnitListEntry>& entries)
+    {
+        QSet<QString> units;
+        units.reserve(entries.size());
+        for(const UnitListEntry& entry: entries) {
+            // ListUnits() lists all units, ListUnitsByPatterns() only those which match
+            if(m_legacy && !matches(entry.unit)) {
+                continue;
+            }
+            units.insert(entry.unit);
+            UnitState& state = m_units[entry.unit];
+            if(state.unit.isEmpty()) {
+                state.unit = entry.unit;
+                state.path = entry.path.path();
+                m_paths.insert(state.path, state.unit);
+            }
+            if(state.description != entry.description || state.loadState != entry.loadState || state.activeState != entry.activeState ||
+                state.subState != entry.subState) {
+                state.description = entry.description;
+                state.loadState = entry.loadState;
+                state.activeState = entry.activeState;
+                state.subState = entry.subState;
+                markChanged(entry.unit);
+            }
+            enqueue(entry.unit);
+        }
+        QStringList gone;
+        for(QHash<QString, UnitState>::const_iterator it = m_units.constBegin(); it != m_units.constEnd(); ++it) {
+            if(!units.contains(it.key())) {
+                gone << it.key();
+            }
+        }
+        for(const QString& unit: gone) {
+            remove(unit);
+        }
+    }
+
+    /*
+     * Sends off queued GetAll() calls until the maximum number of calls are pending. Each reply calls this again, which keeps the pipeline full.
+     */
+    void pump(void)
+    {
+        Q_Q(UnitStateCache);
+        while(m_pending < m_maxPending && !m_queue.isEmpty()) {
+            const QString unit = m_queue.dequeue();
+            m_queued.remove(unit);
+            const QHash<QString, UnitState>::const_iterator it = m_units.constFind(unit);
+            if(it == m_units.constEnd()) {
+                continue;
+            }
+            QDBusMessage message = QDBusMessage::createMethodCall(systemdService, it.value().path, propertiesInterface, QStringLiteral("GetAll"));
+            message << unitInterface;
+            QObject::connect(call(message), &QDBusPendingCallWatcher::finished, q, [this, unit](QDBusPendingCallWatcher * watcher) -> void {
+                watcher->deleteLater();
+                --m_pending;
+                const QDBusPendingReply<QVariantMap> reply = *watcher;
+                if(!reply.isError()) {
+                    apply(unit, reply.value(), true);
+                }
+                else if(reply.error().name() == unknownObject || reply.error().name() == noSuchUnit) {
+                    // the unit was unloaded since it was listed
+                    remove(unit);
+                }
+                else {
+                    fail(reply.error());
+                }
+                pump();
+            });
+        }
+        if(m_refreshing && !m_listing && !m_pending && m_queue.isEmpty()) {
+            m_refreshing = false;
+            flush();
+            Q_EMIT q->refreshed();
+        }
+    }
+
+    /*
+     * Applies the properties from a GetAll() reply (all) or a PropertiesChanged signal to a unit.
+     */
+    void apply(const QString& unit, const QVariantMap& properties, bool all)
+    {
+        const QHash<QString, UnitState>::iterator it = m_units.find(unit);
+        if(it == m_units.end()) {
+            return;
+        }
+        UnitState& state = it.value();
+        if(all) {
+            state.properties = properties;
+        }
+        else {
+            for(QVariantMap::const_iterator property = properties.constBegin(); property != properties.constEnd(); ++property) {
+                state.properties.insert(property.key(), property.value());
+            }
+        }
+        state.description = state.properties.value(QStringLiteral("Description"), state.description).toString();
+        state.loadState = state.properties.value(QStringLiteral("LoadState"), state.loadState).toString();
+        state.activeState = state.properties.value(QStringLiteral("ActiveState"), state.activeState).toString();
+        state.subState = state.properties.value(QStringLiteral("SubState"), state.subState).toString();
+        markChanged(unit);
+    }
+
+    void propertiesChanged(const QDBusMessage& message)
+    {
+        const QList<QVariant> arguments = message.arguments();
+        if(arguments.size() < 3 || arguments.at(0).toString() != unitInterface) {
+            return;
+        }
+        // units which are not cached (e.g. because they do not match the patterns) are of no interest
+        const QString unit = m_paths.value(message.path());
+        if(unit.isEmpty()) {
+            return;
+        }
+        apply(unit, qdbus_cast<QVariantMap>(arguments.at(1)), false);
+        // invalidated properties are announced without their values, which have to be fetched
+        if(!arguments.at(2).toStringList().isEmpty()) {
+            enqueue(unit);
+            pump();
+        }
+    }
+
+    void unitNew(const QString& unit, const QDBusObjectPath& path)
+    {
+        if(m_units.contains(unit) || !matches(unit)) {
+            return;
+        }
+        UnitState& state = m_units[unit];
+        state.unit = unit;
+        state.path = path.path();
+        m_paths.insert(state.path, unit);
+        markChanged(unit);
+        enqueue(unit);
+        pump();
+    }
+
+    /*
+     * Subscribes to (or unsubscribes from) the signals of systemd. Systemd keeps track of subscriptions by bus client, not by caller: if the
+     * connection is shared with others who already subscribed, Subscribe() fails with AlreadySubscribed and this cache must not unsubscribe
+     * when it stops, or the others would no longer receive signals.
+     */
+    bool subscribe(bool on)
+    {
+        Q_Q(UnitStateCache);
+        bool ok;
+        if(on) {
+            ok = m_connection.connect(systemdService, QString(), propertiesInterface, QStringLiteral("PropertiesChanged"), q, SLOT(propertiesChanged(QDBusMessage))) &&
+                m_connection.connect(systemdService, managerPath, managerInterface, QStringLiteral("UnitNew"), q, SLOT(unitNew(QString,QDBusObjectPath))) &&
+                m_connection.connect(systemdService, managerPath, managerInterface, QStringLiteral("UnitRemoved"), q, SLOT(unitRemoved(QString,QDBusObjectPath)));
+        }
+        else {
+            ok = m_connection.disconnect(systemdService, QString(), propertiesInterface, QStringLiteral("PropertiesChanged"), q, SLOT(propertiesChanged(QDBusMessage))) &&
+                m_connection.disconnect(systemdService, managerPath, managerInterface, QStringLiteral("UnitNew"), q, SLOT(unitNew(QString,QDBusObjectPath))) &&
+                m_connection.disconnect(systemdService, managerPath, managerInterface, QStringLiteral("UnitRemoved"), q, SLOT(unitRemoved(QString,QDBusObjectPath)));
+        }
+        if(on) {
+            // systemd only sends signals to clients which subscribed
+            const QDBusMessage message = QDBusMessage::createMethodCall(systemdService, managerPath, managerInterface, QStringLiteral("Subscribe"));
+            QDBusPendingCallWatcher * watcher = new QDBusPendingCallWatcher(m_connection.asyncCall(message), q);
+            QObject::connect(watcher, &QDBusPendingCallWatcher::finished, q, [this](QDBusPendingCallWatcher * watcher) -> void {
+                watcher->deleteLater();
+                if(watcher->isError()) {
+                    return;
+                }
+                m_subscribed = true;
+                // stopped while the call was pending
+                if(!m_active) {
+                    unsubscribe();
+                }
+            });
+        }
+        else if(m_subscribed) {
+            unsubscribe();
+        }
+        return ok;
+    }
+
+    void unsubscribe(void)
+    {
+        m_subscribed = false;
+        // the reply is of no interest
+        m_connection.send(QDBusMessage::createMethodCall(systemdService, managerPath, managerInterface, QStringLiteral("Unsubscribe")));
+    }
+private:
+    UnitStateCache * const q_ptr;
+    Q_DECLARE_PUBLIC(UnitStateCache)
+public:
+    QDBusConnection m_connection;
+    QStringList m_patterns;
+    QVector<QRegExp> m_matchers;
+    int m_maxPending;
+    int m_pending;
+    bool m_active;
+    /**
+     * \brief whether Subscribe() succeeded, i.e. the subscription was made by this cache rather than by others sharing the connection.
+     */
+    bool m_subscribed;
+    bool m_listing;
+    bool m_refreshing;
+    bool m_refreshAgain;
+    /**
+     * \brief whether systemd lacks ListUnitsByPatterns().
+     */
+    bool m_legacy;
+    QHash<QString, UnitState> m_units;
+    /**
+     * \brief the units by object path, to map signals to units.
+     */
+    QHash<QString, QString> m_paths;
+    /**
+     * \brief the units of which the properties are to be fetched, in order, and the same as a set so units are queued only once.
+     */
+    QQueue<QString> m_queue;
+    QSet<QString> m_queued;
+    QSet<QString> m_changed;
+    QSet<QString> m_removed;
+    QTimer m_flush;
+};
+
+UnitStateCache::UnitStateCache(const QDBusConnection& connection, QObject * parent) : QObject(parent), d_ptr(new UnitStateCachePrivate(connection, this)) {}
+
+UnitStateCache::~UnitStateCache()
+{
+    stop();
+    delete d_ptr;
+}
+
+void UnitStateCache::setPatterns(const QStringList& patterns)
+{
+    Q_D(UnitStateCache);
+    d->m_patterns = patterns;
+    d->m_matchers.clear();
+    for(const QString& pattern: patterns) {
+        d->m_matchers << QRegExp(pattern, Qt::CaseSensitive, QRegExp::Wildcard);
+    }
+}
+
+QStringList UnitStateCache::patterns(void) const
+{
+    Q_D(const UnitStateCache);
+    return d->m_patterns;
+}
+
+void UnitStateCache::setMaximumPendingCalls(int calls)
+{
+    Q_D(UnitStateCache);
+    d->m_maxPending = qMax(1, calls);
+}
+
+int UnitStateCache::maximumPendingCalls(void) const
+{
+    Q_D(const UnitStateCache);
+    return d->m_maxPending;
+}
+
+bool UnitStateCache::start(void)
+{
+    Q_D(UnitStateCache);
+    if(d->m_active) {
+        return true;
+    }
+    if(!d->m_connection.isConnected()) {
+        return false;
+    }
+    d->subscribe(true);
+    d->m_active = true;
+    refresh();
+    return true;
+}
+
+void UnitStateCache::stop(void)
+{
+    Q_D(UnitStateCache);
+    if(d->m_active) {
+        d->subscribe(false);
+        d->m_active = false;
+    }
+}
+
+bool UnitStateCache::isActive(void) const
+{
+    Q_D(const UnitStateCache);
+    return d->m_active;
+}
+
+void UnitStateCache::refresh(void)
+{
+    Q_D(UnitStateCache);
+    if(d->m_listing) {
+        d->m_refreshAgain = true;
+        return;
+    }
+    d->list();
+}
+
+bool UnitStateCache::isRefreshing(void) const
+{
+    Q_D(const UnitStateCache);
+    return d->m_refreshing;
+}
+
+int UnitStateCache::pendingCalls(void) const
+{
+    Q_D(const UnitStateCache);
+    return d->m_pending;
+}
+
+QStringList UnitStateCache::units(void) const
+{
+    Q_D(const UnitStateCache);
+    QStringList result = d->m_units.keys();
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+bool UnitStateCache::contains(const QString& unit) const
+{
+    Q_D(const UnitStateCache);
+    return d->m_units.contains(unit);
+}
+
+UnitState UnitStateCache::state(const QString& unit) const
+{
+    Q_D(const UnitStateCache);
+    return d->m_units.value(unit);
+}
+
+void UnitStateCache::propertiesChanged(const QDBusMessage& message)
+{
+    Q_D(UnitStateCache);
+    d->propertiesChanged(message);
+}
+
+void UnitStateCache::unitNew(const QString& unit, const QDBusObjectPath& path)
+{
+    Q_D(UnitStateCache);
+    d->unitNew(unit, path);
+}
+
+void UnitStateCache::unitRemoved(const QString& unit, const QDBusObjectPath&)
+{
+    Q_D(UnitStateCache);
+    d->remove(unit);
+}
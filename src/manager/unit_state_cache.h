@@ -0,0 +1,128 @@
+#ifndef SD_UIKIT_MANAGER_UNIT_STATE_CACHE
+#define SD_UIKIT_MANAGER_UNIT_STATE_CACHE
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusObjectPath>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+class UnitStateCachePrivate;
+
+/**
+ * \brief The runtime state of a unit, as last reported by systemd.
+ */
+struct UnitState
+{
+    QString unit;
+    QString description;
+    QString loadState;
+    QString activeState;
+    QString subState;
+    /**
+     * \brief the D-Bus object of the unit, e.g. /org/freedesktop/systemd1/unit/foo_2eservice
+     */
+    QString path;
+    /**
+     * \brief all properties of the org.freedesktop.systemd1.Unit interface of the unit, once they were fetched.
+     */
+    QVariantMap properties;
+    bool isValid(void) const;
+};
+
+/**
+ * \brief Keeps the state of the units loaded by systemd, as seen through org.freedesktop.systemd1 on D-Bus, and keeps it up to date.
+ *
+ * No call ever blocks: all D-Bus calls are made asynchronously and their replies are handled by the event loop. A #refresh() takes a single
+ * ListUnitsByPatterns() call to list the units matching #patterns() along with their state, followed by a GetAll() call for the properties of
+ * each unit. The GetAll() calls are pipelined: up to #maximumPendingCalls() of them are on the bus at any one time, and each reply sends off
+ * the next call, so refreshing a few thousand units takes a few round trips worth of time rather than one per unit.
+ *
+ * After #start() the cache subscribes to the PropertiesChanged signals of all units and to the UnitNew and UnitRemoved signals of the manager,
+ * and applies the changes they carry to the cached state as they come in. Properties which are invalidated (rather than changed) are fetched
+ * anew. Observers are told which units changed through #unitsChanged(const QStringList&) and #unitsRemoved(const QStringList&). Those signals
+ * are batched: all changes handled in one pass of the event loop are reported by a single emission.
+ *
+ * Systemd versions which predate ListUnitsByPatterns() (before 230) are listed through ListUnits(), in which case the patterns are matched here.
+ */
+class UnitStateCache: public QObject
+{
+    Q_OBJECT
+public:
+    UnitStateCache(const QDBusConnection& connection = QDBusConnection::systemBus(), QObject * parent = 0);
+    virtual ~UnitStateCache();
+    /**
+     * \brief sets the glob patterns (e.g. *.service) of the units to keep. The default is an empty list, which keeps all units.
+     */
+    void setPatterns(const QStringList& patterns);
+    QStringList patterns(void) const;
+    /**
+     * \brief sets the number of GetAll() calls which may be pending at any one time. The default is 64.
+     */
+    void setMaximumPendingCalls(int calls);
+    int maximumPendingCalls(void) const;
+    /**
+     * \brief subscribes to changes and starts a #refresh().
+     * \return false if the connection is not connected, in which case nothing is started.
+     */
+    bool start(void);
+    /**
+     * \brief stops following changes. The cached state is kept, as are pending calls.
+     *
+     * Systemd is only asked to stop sending signals if the subscription was made by this cache, as the connection may be shared with others
+     * who subscribed as well.
+     */
+    void stop(void);
+    bool isActive(void) const;
+    /**
+     * \brief lists the units and fetches their properties anew. A refresh requested while another is listing units is carried out once that one completes.
+     */
+    void refresh(void);
+    /**
+     * \brief whether a refresh is in progress, i.e. units are being listed or their properties are being fetched.
+     */
+    bool isRefreshing(void) const;
+    /**
+     * \brief the number of D-Bus calls which were sent but not answered yet.
+     */
+    int pendingCalls(void) const;
+    /**
+     * \brief the names of the units in the cache, sorted.
+     */
+    QStringList units(void) const;
+    bool contains(const QString& unit) const;
+    /**
+     * \brief the cached state of the unit. An invalid state is returned if the unit is not in the cache.
+     */
+    UnitState state(const QString& unit) const;
+Q_SIGNALS:
+    /**
+     * \brief emitted once all units are listed and all their properties are fetched. If listing the units fails, #error() is emitted instead.
+     */
+    void refreshed(void);
+    /**
+     * \brief emitted for units which were added to the cache, or whose state changed.
+     */
+    void unitsChanged(const QStringList& units);
+    /**
+     * \brief emitted for units which are no longer in the cache.
+     */
+    void unitsRemoved(const QStringList& units);
+    /**
+     * \brief emitted when a call fails for reasons other than the unit going away, with the D-Bus error name and message.
+     */
+    void error(const QString& name, const QString& message);
+private Q_SLOTS:
+    void propertiesChanged(const QDBusMessage& message);
+    void unitNew(const QString& unit, const QDBusObjectPath& path);
+    void unitRemoved(const QString& unit, const QDBusObjectPath& path);
+private:
+    Q_DISABLE_COPY(UnitStateCache)
+
+    Q_DECLARE_PRIVATE(UnitStateCache)
+    UnitStateCachePrivate *const d_ptr;
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef SD_UIKIT_TRACING_H
+#define SD_UIKIT_TRACING_H
+
+/*
+ * Trace points for hot code paths.
+ *
+ * Trace points are only compiled in if the SDUIKIT_TRACING CMake option is enabled, otherwise SDUIKIT_TRACE() expands to dead code
+ * which the compiler removes entirely. When compiled in, trace points are still disabled at runtime by default.
+ * Enable them through their logging category, for example: QT_LOGGING_RULES="sduikit.*.trace=true"
+ *
+ * Usage: SDUIKIT_TRACE(someCategory) << "something happened at:" << offset;
+ * Where someCategory is defined using Q_LOGGING_CATEGORY(someCategory, "sduikit.something.trace", QtWarningMsg) inside #ifdef SDUIKIT_TRACING.
+ */
+#include <QtDebug>
+
+#ifdef SDUIKIT_TRACING
+#include <QLoggingCategory>
+#define SDUIKIT_TRACE(category) qCDebug(category)
+#else
+#define SDUIKIT_TRACE(category) while(false) QNoDebug()
+#endif
+
+#endif
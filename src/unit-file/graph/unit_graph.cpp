@@ -0,0 +1,378 @@
+#include "unit_graph.h"
+
+#include <algorithm>
+
+/*
+ * The settings which relate a unit to a list of other units.
+ */
+static const struct {
+    const char * section;
+    const char * key;
+    UnitGraph::Relation relation;
+} relationSettings[] = {
+    { "Unit", "Wants", UnitGraph::Wants },
+    { "Unit", "Requires", UnitGraph::Requires },
+    { "Unit", "After", UnitGraph::After },
+    { "Unit", "Before", UnitGraph::Before },
+    { "Install", "WantedBy", UnitGraph::WantedBy },
+    { "Install", "RequiredBy", UnitGraph::RequiredBy },
+    { "Install", "Also", UnitGraph::Also }
+};
+
+/*
+ * Units which activate another unit, and the setting which names it. By default it is the service of the same name.
+ */
+static const struct {
+    const char * suffix;
+    const char * section;
+    const char * key;
+} triggerSettings[] = {
+    { ".socket", "Socket", "Service" },
+    { ".timer", "Timer", "Unit" },
+    { ".path", "Path", "Unit" }
+};
+
+static bool isTrue(const QString& value)
+{
+    const QString v = value.trimmed().toLower();
+    return v == QLatin1String("yes") || v == QLatin1String("true") || v == QLatin1String("on") || v == QLatin1String("1");
+}
+
+static bool edgeLessThan(const UnitGraph::Edge& a, const UnitGraph::Edge& b)
+{
+    return a.node < b.node || (a.node == b.node && a.relation < b.relation);
+}
+
+static bool edgeEquals(const UnitGraph::Edge& a, const UnitGraph::Edge& b)
+{
+    return a.node == b.node && a.relation == b.relation;
+}
+
+UnitGraph::Edges::Edges(const Edge * begin, const Edge * end) : m_begin(begin), m_end(end) {}
+
+const UnitGraph::Edge * UnitGraph::Edges::begin(void) const
+{
+    return m_begin;
+}
+
+const UnitGraph::Edge * UnitGraph::Edges::end(void) const
+{
+    return m_end;
+}
+
+int UnitGraph::Edges::size(void) const
+{
+    return (int) (m_end - m_begin);
+}
+
+bool UnitGraph::Edges::isEmpty(void) const
+{
+    return m_begin == m_end;
+}
+
+UnitGraph::UnitGraph()
+{
+    compact();
+}
+
+void UnitGraph::build(const UnitFileMerger& merger)
+{
+    m_nodes.clear();
+    m_units.clear();
+    m_loaded.clear();
+    m_declared.clear();
+    m_cycles.clear();
+    const QStringList units = merger.index().units();
+    for(const QString& name: units) {
+        declare(intern(name), merger.unit(name));
+    }
+    compact();
+    QVector<int> all(m_units.size());
+    for(int i = 0; i < all.size(); ++i) {
+        all[i] = i;
+    }
+    findCycles(all);
+}
+
+void UnitGraph::update(const UnitFileMerger& merger, const QStringList& units)
+{
+    QVector<int> changed;
+    for(const QString& name: units) {
+        const int node = intern(name);
+        declare(node, merger.unit(name));
+        changed << node;
+    }
+    compact();
+    findCycles(changed);
+}
+
+int UnitGraph::size(void) const
+{
+    return m_units.size();
+}
+
+int UnitGraph::edgeCount(void) const
+{
+    return m_edges[Forward].size();
+}
+
+int UnitGraph::node(const QString& unit) const
+{
+    return m_nodes.value(unit, -1);
+}
+
+QString UnitGraph::unit(int node) const
+{
+    return m_units.at(node);
+}
+
+bool UnitGraph::isLoaded(int node) const
+{
+    return m_loaded.testBit(node);
+}
+
+UnitGraph::Edges UnitGraph::edges(int node, Direction direction) const
+{
+    const Edge * edges = m_edges[direction].constData();
+    return Edges(edges + m_offsets[direction].at(node), edges + m_offsets[direction].at(node + 1));
+}
+
+QVector<int> UnitGraph::neighbours(int node, Relations relations, Direction direction) const
+{
+    QVector<int> result;
+    for(const Edge& edge: edges(node, direction)) {
+        if(relations & edge.relation) {
+            result << edge.node;
+        }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+QVector<int> UnitGraph::closure(int node, Relations relations, Direction direction) const
+{
+    QBitArray seen(m_units.size());
+    seen.setBit(node);
+    // the result doubles as the queue of nodes still to visit
+    QVector<int> result;
+    result << node;
+    for(int i = 0; i < result.size(); ++i) {
+        for(const Edge& edge: edges(result.at(i), direction)) {
+            if((relations & edge.relation) && !seen.testBit(edge.node)) {
+                seen.setBit(edge.node);
+                result << edge.node;
+            }
+        }
+    }
+    result.removeFirst();
+    return result;
+}
+
+const QVector<QVector<int> >& UnitGraph::cycles(void) const
+{
+    return m_cycles;
+}
+
+int UnitGraph::intern(const QString& unit)
+{
+    const QHash<QString, int>::const_iterator it = m_nodes.constFind(unit);
+    if(it != m_nodes.constEnd()) {
+        return it.value();
+    }
+    const int node = m_units.size();
+    m_nodes.insert(unit, node);
+    m_units << unit;
+    m_loaded.resize(node + 1);
+    m_declared.resize(node + 1);
+    return node;
+}
+
+/*
+ * Replaces the edges declared by a node with those found in the effective configuration of its unit.
+ */
+void UnitGraph::declare(int node, const EffectiveUnit& unit)
+{
+    m_declared[node].clear();
+    m_loaded.setBit(node, unit.isValid() && !unit.masked);
+    if(!m_loaded.testBit(node)) {
+        return;
+    }
+    // interning other units grows m_declared, so collect the edges first
+    QVector<Edge> edges;
+    const UnitFile& settings = unit.settings;
+    for(const auto& setting: relationSettings) {
+        const QStringList values = settings.values(QLatin1String(setting.section), QLatin1String(setting.key));
+        for(const QString& value: values) {
+            // simplified() leaves no runs of spaces, but an empty value still splits into a single empty part
+            for(const QString& other: value.simplified().split(QLatin1Char(' '))) {
+                if(other.isEmpty()) {
+                    continue;
+                }
+                const Edge edge = { intern(other), setting.relation };
+                edges << edge;
+            }
+        }
+    }
+    for(const auto& trigger: triggerSettings) {
+        if(!unit.unit.endsWith(QLatin1String(trigger.suffix))) {
+            continue;
+        }
+        QString target = settings.value(QLatin1String(trigger.section), QLatin1String(trigger.key)).trimmed();
+        if(target.isEmpty()) {
+            const QString stem = unit.unit.left(unit.unit.size() - (int) qstrlen(trigger.suffix));
+            // a socket which accepts connections spawns an instance of a template service per connection
+            const bool accept = qstrcmp(trigger.section, "Socket") == 0 && isTrue(settings.value(QStringLiteral("Socket"), QStringLiteral("Accept")));
+            target = stem + (accept ? QStringLiteral("@.service") : QStringLiteral(".service"));
+        }
+        const Edge edge = { intern(target), Triggers };
+        edges << edge;
+    }
+    std::sort(edges.begin(), edges.end(), edgeLessThan);
+    edges.erase(std::unique(edges.begin(), edges.end(), edgeEquals), edges.end());
+    m_declared[node] = edges;
+}
+
+/*
+ * Builds the compressed forward and reverse edges from the declared edges: count the edges of each node, turn the counts into offsets,
+ * then put every edge in place.
+ */
+void UnitGraph::compact(void)
+{
+    const int nodes = m_units.size();
+    for(int d = Forward; d <= Reverse; ++d) {
+        m_offsets[d].fill(0, nodes + 1);
+    }
+    for(int node = 0; node < nodes; ++node) {
+        m_offsets[Forward][node + 1] += m_declared.at(node).size();
+        for(const Edge& edge: m_declared.at(node)) {
+            m_offsets[Reverse][edge.node + 1] ++;
+        }
+    }
+    for(int d = Forward; d <= Reverse; ++d) {
+        for(int node = 0; node < nodes; ++node) {
+            m_offsets[d][node + 1] += m_offsets[d].at(node);
+        }
+        m_edges[d].resize(m_offsets[d].at(nodes));
+    }
+    QVector<qint32> next = m_offsets[Reverse];
+    Edge * forward = m_edges[Forward].data();
+    Edge * reverse = m_edges[Reverse].data();
+    for(int node = 0; node < nodes; ++node) {
+        int position = m_offsets[Forward].at(node);
+        for(const Edge& edge: m_declared.at(node)) {
+            forward[position++] = edge;
+            const Edge back = { node, edge.relation };
+            reverse[next[edge.node]++] = back;
+        }
+    }
+}
+
+/*
+ * A frame of the depth first search of Tarjan's algorithm, which is done iteratively as the graph may well be deeper than the stack allows.
+ */
+struct SearchFrame
+{
+    int node;
+    int next;
+    QVector<int> successors;
+};
+
+/*
+ * Finds the strongly connected components of the ordering graph which contain any of the changed nodes.
+ * In the ordering graph there is an edge from a node to every node it must be started after: those it declares After= for, and those which
+ * declare Before= for it. A cycle can only appear or disappear if one of its edges does, which means one of its nodes must have changed:
+ * cycles without any changed nodes are kept as they are, unless they turn out to be part of a larger cycle now.
+ * The other nodes of a cycle through a changed node may still form a smaller cycle of their own, so these are searched from as well.
+ */
+void UnitGraph::findCycles(const QVector<int>& changed)
+{
+    const int nodes = m_units.size();
+    QBitArray isChanged(nodes);
+    for(int node: changed) {
+        isChanged.setBit(node);
+    }
+    QVector<int> seeds = changed;
+    QVector<QVector<int> > cycles;
+    for(const QVector<int>& cycle: m_cycles) {
+        bool affected = false;
+        for(int node: cycle) {
+            affected = affected || isChanged.testBit(node);
+        }
+        if(affected) {
+            seeds += cycle;
+        }
+        else {
+            cycles << cycle;
+        }
+    }
+
+    QVector<int> index(nodes, -1), low(nodes, 0), stack;
+    QBitArray onStack(nodes);
+    QVector<SearchFrame> frames;
+    QVector<QVector<int> > found;
+    int counter = 0;
+    for(int seed: seeds) {
+        if(index.at(seed) >= 0) {
+            continue;
+        }
+        frames.append(SearchFrame { seed, 0, QVector<int>() });
+        while(!frames.isEmpty()) {
+            SearchFrame& frame = frames.last();
+            const int node = frame.node;
+            if(frame.next == 0 && index.at(node) < 0) {
+                index[node] = low[node] = counter++;
+                stack << node;
+                onStack.setBit(node);
+                for(const Edge& edge: edges(node, Forward)) {
+                    if(edge.relation == After) {
+                        frame.successors << edge.node;
+                    }
+                }
+                for(const Edge& edge: edges(node, Reverse)) {
+                    if(edge.relation == Before) {
+                        frame.successors << edge.node;
+                    }
+                }
+            }
+            if(frame.next < frame.successors.size()) {
+                const int successor = frame.successors.at(frame.next++);
+                if(index.at(successor) < 0) {
+                    // invalidates frame
+                    frames.append(SearchFrame { successor, 0, QVector<int>() });
+                }
+                else if(onStack.testBit(successor)) {
+                    low[node] = qMin(low.at(node), index.at(successor));
+                }
+                continue;
+            }
+            if(low.at(node) == index.at(node)) {
+                QVector<int> component;
+                int member;
+                do {
+                    member = stack.takeLast();
+                    onStack.clearBit(member);
+                    component << member;
+                } while(member != node);
+                if(component.size() > 1 || frame.successors.contains(node)) {
+                    std::sort(component.begin(), component.end());
+                    found << component;
+                }
+            }
+            frames.removeLast();
+            if(!frames.isEmpty()) {
+                const int parent = frames.last().node;
+                low[parent] = qMin(low.at(parent), low.at(node));
+            }
+        }
+    }
+
+    // the search visits every node of a component or none of them: a cycle which was reached is among the components found
+    m_cycles.clear();
+    for(const QVector<int>& cycle: cycles) {
+        if(index.at(cycle.first()) < 0) {
+            m_cycles << cycle;
+        }
+    }
+    m_cycles += found;
+}
@@ -0,0 +1,126 @@
+#ifndef SD_UIKIT_UNITFILE_GRAPH
+#define SD_UIKIT_UNITFILE_GRAPH
+
+#include <QBitArray>
+#include <QFlags>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "../merge/unit_file_merger.h"
+
+/**
+ * \brief The relations between units, as found in the effective configuration of all units known to a UnitFileMerger.
+ * Every unit mentioned in a relation is a node of the graph, whether a unit file was found for it or not (see #isLoaded()).
+ * Relations are kept as edges from the unit which declares them, e.g. foo.service After=bar.service is an After edge from foo.service
+ * to bar.service. Socket, timer and path units additionally have a Triggers edge to the unit they activate.
+ *
+ * Edges are stored in compressed sparse row form, in both directions: the edges of a node are a contiguous range of one array, so both
+ * "what does X depend on" (#edges() forward) and "what depends on X" (#edges() in reverse) are answered without any searching or copying.
+ *
+ * The graph also keeps track of ordering cycles (After= and Before= relations which contradict each other), which systemd breaks up
+ * arbitrarily at boot. When units change, #update() only searches for cycles through the units which changed.
+ */
+class UnitGraph
+{
+public:
+    enum Relation {
+        Wants = 0x1,
+        Requires = 0x2,
+        After = 0x4,
+        Before = 0x8,
+        WantedBy = 0x10,
+        RequiredBy = 0x20,
+        Also = 0x40,
+        Triggers = 0x80, /* a socket, timer or path unit activates the unit */
+        AllRelations = 0xFF
+    };
+    Q_DECLARE_FLAGS(Relations, Relation)
+    enum Direction {
+        Forward = 0, /* edges from a node, i.e. the relations it declares */
+        Reverse /* edges to a node, i.e. the relations other units declare with it */
+    };
+    struct Edge {
+        /**
+         * \brief the node at the other end of the edge.
+         */
+        qint32 node;
+        qint32 relation;
+    };
+    /**
+     * \brief a range of edges, which is only valid for as long as the graph is not changed.
+     */
+    class Edges
+    {
+    public:
+        Edges(const Edge * begin, const Edge * end);
+        const Edge * begin(void) const;
+        const Edge * end(void) const;
+        int size(void) const;
+        bool isEmpty(void) const;
+    private:
+        const Edge * m_begin;
+        const Edge * m_end;
+    };
+
+    UnitGraph();
+    /**
+     * \brief builds the graph for all units known to the merger.
+     */
+    void build(const UnitFileMerger& merger);
+    /**
+     * \brief updates the relations declared by the given units, e.g. after UnitFileMerger::update() was called with the same units.
+     */
+    void update(const UnitFileMerger& merger, const QStringList& units);
+    /**
+     * \brief the number of nodes. Nodes are never removed: a unit which is gone keeps its node, without edges of its own.
+     */
+    int size(void) const;
+    int edgeCount(void) const;
+    /**
+     * \brief the node of a unit.
+     * \return the node, or -1 if the unit is not part of the graph.
+     */
+    int node(const QString& unit) const;
+    QString unit(int node) const;
+    /**
+     * \brief whether a unit file was found for the unit of a node, as opposed to the unit only being mentioned by other units.
+     */
+    bool isLoaded(int node) const;
+    Edges edges(int node, Direction direction = Forward) const;
+    /**
+     * \brief the nodes related to a node by any of the given relations, sorted and without duplicates.
+     */
+    QVector<int> neighbours(int node, Relations relations, Direction direction = Forward) const;
+    /**
+     * \brief all nodes reachable from a node by following edges of the given relations, in breadth first order and not including the node itself.
+     * For instance, all units which directly or indirectly pull in a unit: closure(node, Wants | Requires, Reverse).
+     */
+    QVector<int> closure(int node, Relations relations, Direction direction = Forward) const;
+    /**
+     * \brief the ordering cycles, each as the (sorted) nodes of a strongly connected component of the ordering graph.
+     */
+    const QVector<QVector<int> >& cycles(void) const;
+private:
+    int intern(const QString& unit);
+    void declare(int node, const EffectiveUnit& unit);
+    void compact(void);
+    void findCycles(const QVector<int>& changed);
+private:
+    QHash<QString, int> m_nodes;
+    QStringList m_units;
+    QBitArray m_loaded;
+    /*
+     * The edges declared by each node, from which the compressed form is built.
+     */
+    QVector<QVector<Edge> > m_declared;
+    QVector<qint32> m_offsets[2];
+    QVector<Edge> m_edges[2];
+    QVector<QVector<int> > m_cycles;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(UnitGraph::Relations)
+Q_DECLARE_TYPEINFO(UnitGraph::Edge, Q_PRIMITIVE_TYPE);
+
+#endif
@@ -0,0 +1,581 @@
+#include "unit_file_item_model.h"
+
+#include "../merge/unit_file_merger.h"
+#include "../types/directive_schema.h"
+
+#include <algorithm>
+
+/*
+ * The model is a tree of three levels. The internal pointer of a QModelIndex is the node of its parent, which tells the level of the index:
+ * the root for units, a UnitItem for sections and a SectionItem for settings.
+ */
+struct ItemNode
+{
+    enum Level {
+        UnitLevel = 0,
+        SectionLevel,
+        SettingLevel
+    };
+    ItemNode(Level level) : childLevel(level) {}
+    /**
+     * \brief the level of the children of this node.
+     */
+    Level childLevel;
+};
+
+struct UnitItem;
+
+struct SectionItem: public ItemNode
+{
+    SectionItem(UnitItem * parent, int position, qint32 id) : ItemNode(SettingLevel), unit(parent), row(position), section(id) {}
+    UnitItem * unit;
+    int row;
+    qint32 section;
+    /**
+     * \brief the entries of the settings of the unit in this section, in order.
+     */
+    QVector<qint32> entries;
+};
+
+struct UnitItem: public ItemNode
+{
+    UnitItem(const QString& unit) : ItemNode(SectionLevel), name(unit), row(0), described(false), fetched(false) {}
+    ~UnitItem()
+    {
+        qDeleteAll(sections);
+    }
+    QString name;
+    int row;
+    /**
+     * \brief whether the description was looked up yet.
+     */
+    bool described;
+    /**
+     * \brief whether the sections were fetched, in which case #effective holds the configuration of the unit.
+     */
+    bool fetched;
+    QString description;
+    EffectiveUnit effective;
+    QVector<SectionItem *> sections;
+};
+
+static bool unitLessThan(const UnitItem * item, const QString& name)
+{
+    return item->name < name;
+}
+
+class UnitFileItemModelPrivate
+{
+public:
+    UnitFileItemModelPrivate(UnitFileItemModel * q) : q_ptr(q), m_root(ItemNode::UnitLevel), m_fetched(0), m_batchSize(256) {}
+    ~UnitFileItemModelPrivate()
+    {
+        qDeleteAll(m_units);
+    }
+
+    /*
+     * The node whose children are the rows below the given index, or 0 for settings (which have no children).
+     */
+    ItemNode * node(const QModelIndex& index) const
+    {
+        if(!index.isValid()) {
+            return const_cast<ItemNode *>(&m_root);
+        }
+        const ItemNode * parent = static_cast<const ItemNode *>(index.internalPointer());
+        switch(parent->childLevel) {
+            case ItemNode::UnitLevel:
+                return m_units.at(index.row());
+            case ItemNode::SectionLevel:
+                return static_cast<const UnitItem *>(parent)->sections.at(index.row());
+            default:
+                return 0;
+        }
+    }
+
+    QModelIndex unitIndex(const UnitItem * item, int column = UnitFileItemModel::NameColumn) const
+    {
+        Q_Q(const UnitFileItemModel);
+        return q->createIndex(item->row, column, const_cast<ItemNode *>(&m_root));
+    }
+
+    /*
+     * The position of the unit in m_units, or the position at which it would be inserted.
+     */
+    int position(const QString& name) const
+    {
+        return (int) (std::lower_bound(m_units.constBegin(), m_units.constEnd(), name, unitLessThan) - m_units.constBegin());
+    }
+
+    bool contains(int position, const QString& name) const
+    {
+        return position < m_units.size() && m_units.at(position)->name == name;
+    }
+
+    void renumber(int from)
+    {
+        for(int i = from; i < m_units.size(); ++i) {
+            m_units.at(i)->row = i;
+        }
+    }
+
+    void describe(UnitItem * item) const
+    {
+        if(!item->described) {
+            const EffectiveUnit unit = item->fetched ? item->effective : m_merger.unit(item->name);
+            item->description = unit.settings.value(QStringLiteral("Unit"), QStringLiteral("Description"));
+            item->described = true;
+        }
+    }
+
+    /*
+     * Merges the unit and lays out its sections and settings, without reporting the rows.
+     */
+    void populate(UnitItem * item)
+    {
+        item->effective = m_merger.unit(item->name);
+        item->fetched = true;
+        const UnitFile& settings = item->effective.settings;
+        const QVector<qint32>& sections = settings.sections();
+        item->sections.reserve(sections.size());
+        for(int i = 0; i < sections.size(); ++i) {
+            item->sections.append(new SectionItem(item, i, sections.at(i)));
+        }
+        for(int entry = 0; entry < settings.size(); ++entry) {
+            // units have only a handful of sections, so a linear search beats a hash
+            const int section = sections.indexOf(settings.at(entry).section);
+            item->sections.at(section)->entries.append(entry);
+        }
+    }
+
+    void fetch(UnitItem * item)
+    {
+        Q_Q(UnitFileItemModel);
+        const EffectiveUnit unit = m_merger.unit(item->name);
+        if(unit.settings.sections().isEmpty()) {
+            item->effective = unit;
+            item->fetched = true;
+            return;
+        }
+        q->beginInsertRows(unitIndex(item), 0, unit.settings.sections().size() - 1);
+        populate(item);
+        q->endInsertRows();
+    }
+
+    /*
+     * Drops the merged configuration of a unit whose files changed. If its sections were fetched, they are replaced by the new ones.
+     */
+    void refresh(UnitItem * item)
+    {
+        Q_Q(UnitFileItemModel);
+        item->described = false;
+        item->description.clear();
+        if(!item->fetched) {
+            return;
+        }
+        if(!item->sections.isEmpty()) {
+            q->beginRemoveRows(unitIndex(item), 0, item->sections.size() - 1);
+            qDeleteAll(item->sections);
+            item->sections.clear();
+            q->endRemoveRows();
+        }
+        item->effective = EffectiveUnit();
+        item->fetched = false;
+        fetch(item);
+    }
+
+    /*
+     * Removes the units at the given (ascending) positions, one range of adjacent rows at a time. Working back to front keeps the positions
+     * of the ranges still to be removed valid.
+     */
+    void remove(const QVector<int>& positions)
+    {
+        Q_Q(UnitFileItemModel);
+        int last = positions.size() - 1;
+        while(last >= 0) {
+            int first = last;
+            while(first > 0 && positions.at(first - 1) == positions.at(first) - 1) {
+                --first;
+            }
+            const int from = positions.at(first), to = positions.at(last);
+            const int visible = qMin(to, m_fetched - 1);
+            if(from <= visible) {
+                q->beginRemoveRows(QModelIndex(), from, visible);
+            }
+            qDeleteAll(m_units.constBegin() + from, m_units.constBegin() + to + 1);
+            m_units.remove(from, to - from + 1);
+            renumber(from);
+            if(from <= visible) {
+                m_fetched -= visible - from + 1;
+                q->endRemoveRows();
+            }
+            last = first - 1;
+        }
+    }
+
+    /*
+     * Inserts units for the given (sorted) names, one range of adjacent rows at a time. Units which end up past the rows fetched so far are
+     * not reported: they are reported once they are fetched.
+     */
+    void insert(const QStringList& names)
+    {
+        Q_Q(UnitFileItemModel);
+        int first = 0;
+        while(first < names.size()) {
+            const int at = position(names.at(first));
+            int last = first;
+            while(last + 1 < names.size() && (at == m_units.size() || names.at(last + 1) < m_units.at(at)->name)) {
+                ++last;
+            }
+            const int count = last - first + 1;
+            const bool visible = at < m_fetched || m_fetched == m_units.size();
+            if(visible) {
+                q->beginInsertRows(QModelIndex(), at, at + count - 1);
+            }
+            m_units.insert(at, count, 0);
+            for(int i = 0; i < count; ++i) {
+                m_units[at + i] = new UnitItem(names.at(first + i));
+            }
+            renumber(at);
+            if(visible) {
+                m_fetched += count;
+                q->endInsertRows();
+            }
+            first = last + 1;
+        }
+    }
+
+    /*
+     * Refreshes the units with the given names, and reports their rows as changed, one range of adjacent rows at a time.
+     */
+    void change(const QStringList& names)
+    {
+        Q_Q(UnitFileItemModel);
+        int first = -1, last = -1;
+        for(const QString& name: names) {
+            const int at = position(name);
+            UnitItem * item = m_units.at(at);
+            refresh(item);
+            if(at >= m_fetched) {
+                continue;
+            }
+            if(first >= 0 && at != last + 1) {
+                q->dataChanged(unitIndex(m_units.at(first)), unitIndex(m_units.at(last), UnitFileItemModel::ValueColumn));
+                first = -1;
+            }
+            if(first < 0) {
+                first = at;
+            }
+            last = at;
+        }
+        if(first >= 0) {
+            q->dataChanged(unitIndex(m_units.at(first)), unitIndex(m_units.at(last), UnitFileItemModel::ValueColumn));
+        }
+    }
+
+    QVariant unitData(UnitItem * item, int column, int role) const
+    {
+        switch(role) {
+            case Qt::DisplayRole:
+            case Qt::ToolTipRole:
+                if(column == UnitFileItemModel::NameColumn) {
+                    return item->name;
+                }
+                describe(item);
+                return item->description;
+            case UnitFileItemModel::UnitRole:
+                return item->name;
+            case UnitFileItemModel::SourceRole:
+            {
+                const int entry = m_merger.index().unit(item->name);
+                return entry >= 0 ? m_merger.index().at(entry).path : QString();
+            }
+            default:
+                return QVariant();
+        }
+    }
+
+    QVariant sectionData(const SectionItem * item, int column, int role) const
+    {
+        const NameTable * names = item->unit->effective.settings.names();
+        switch(role) {
+            case Qt::DisplayRole:
+                return column == UnitFileItemModel::NameColumn ? names->name(item->section) : QString();
+            case UnitFileItemModel::UnitRole:
+                return item->unit->name;
+            case UnitFileItemModel::SectionRole:
+                return names->name(item->section);
+            default:
+                return QVariant();
+        }
+    }
+
+    QVariant settingData(const SectionItem * parent, int row, int column, int role) const
+    {
+        const EffectiveUnit& unit = parent->unit->effective;
+        const int entry = parent->entries.at(row);
+        switch(role) {
+            case Qt::DisplayRole:
+                return column == UnitFileItemModel::NameColumn ? unit.settings.key(entry) : unit.settings.value(entry);
+            case Qt::ToolTipRole:
+                return unit.source(entry) + QLatin1Char(':') + QString::number(unit.settings.at(entry).line);
+            case UnitFileItemModel::UnitRole:
+                return unit.unit;
+            case UnitFileItemModel::SectionRole:
+                return unit.settings.section(entry);
+            case UnitFileItemModel::KeyRole:
+                return unit.settings.key(entry);
+            case UnitFileItemModel::ValueTypeRole:
+                return (int) DirectiveSchema::find(unit.settings.section(entry).toUtf8(), unit.settings.key(entry).toUtf8()).type;
+            case UnitFileItemModel::SourceRole:
+                return unit.source(entry);
+            case UnitFileItemModel::LineRole:
+                return unit.settings.at(entry).line;
+            default:
+                return QVariant();
+        }
+    }
+private:
+    UnitFileItemModel * const q_ptr;
+    Q_DECLARE_PUBLIC(UnitFileItemModel)
+public:
+    UnitFileMerger m_merger;
+    ItemNode m_root;
+    /**
+     * \brief all units in the index, sorted by name. Only the first m_fetched are rows of the model.
+     */
+    QVector<UnitItem *> m_units;
+    int m_fetched;
+    int m_batchSize;
+};
+
+UnitFileItemModel::UnitFileItemModel(QObject * parent) : QAbstractItemModel(parent), d_ptr(new UnitFileItemModelPrivate(this)) {}
+
+UnitFileItemModel::~UnitFileItemModel()
+{
+    delete d_ptr;
+}
+
+void UnitFileItemModel::setIndex(const UnitFileIndex& index)
+{
+    Q_D(UnitFileItemModel);
+    beginResetModel();
+    qDeleteAll(d->m_units);
+    d->m_units.clear();
+    d->m_fetched = 0;
+    d->m_merger.setIndex(index);
+    const QStringList units = index.units();
+    d->m_units.reserve(units.size());
+    for(const QString& unit: units) {
+        d->m_units.append(new UnitItem(unit));
+    }
+    d->renumber(0);
+    endResetModel();
+}
+
+UnitFileIndex UnitFileItemModel::unitFileIndex(void) const
+{
+    Q_D(const UnitFileItemModel);
+    return d->m_merger.index();
+}
+
+void UnitFileItemModel::update(const UnitFileIndex& index, const QStringList& units)
+{
+    Q_D(UnitFileItemModel);
+    d->m_merger.update(index, units);
+    QStringList sorted = units;
+    std::sort(sorted.begin(), sorted.end());
+    QVector<int> removed;
+    QStringList added, changed;
+    for(const QString& unit: sorted) {
+        const int at = d->position(unit);
+        const bool exists = index.unit(unit) >= 0;
+        if(!d->contains(at, unit)) {
+            if(exists) {
+                added.append(unit);
+            }
+        }
+        else if(exists) {
+            changed.append(unit);
+        }
+        else {
+            removed.append(at);
+        }
+    }
+    d->remove(removed);
+    d->insert(added);
+    d->change(changed);
+}
+
+void UnitFileItemModel::setBatchSize(int size)
+{
+    Q_D(UnitFileItemModel);
+    d->m_batchSize = qMax(1, size);
+}
+
+int UnitFileItemModel::batchSize(void) const
+{
+    Q_D(const UnitFileItemModel);
+    return d->m_batchSize;
+}
+
+QModelIndex UnitFileItemModel::index(int row, int column, const QModelIndex& parent) const
+{
+    Q_D(const UnitFileItemModel);
+    if(!hasIndex(row, column, parent)) {
+        return QModelIndex();
+    }
+    return createIndex(row, column, d->node(parent));
+}
+
+QModelIndex UnitFileItemModel::parent(const QModelIndex& child) const
+{
+    Q_D(const UnitFileItemModel);
+    if(!child.isValid()) {
+        return QModelIndex();
+    }
+    const ItemNode * parent = static_cast<const ItemNode *>(child.internalPointer());
+    switch(parent->childLevel) {
+        case ItemNode::SectionLevel:
+            return d->unitIndex(static_cast<const UnitItem *>(parent));
+        case ItemNode::SettingLevel:
+        {
+            const SectionItem * section = static_cast<const SectionItem *>(parent);
+            return createIndex(section->row, NameColumn, section->unit);
+        }
+        default:
+            return QModelIndex();
+    }
+}
+
+int UnitFileItemModel::rowCount(const QModelIndex& parent) const
+{
+    Q_D(const UnitFileItemModel);
+    if(parent.column() > 0) {
+        return 0;
+    }
+    const ItemNode * node = d->node(parent);
+    if(!node) {
+        return 0;
+    }
+    switch(node->childLevel) {
+        case ItemNode::UnitLevel:
+            return d->m_fetched;
+        case ItemNode::SectionLevel:
+            return static_cast<const UnitItem *>(node)->sections.size();
+        default:
+            return static_cast<const SectionItem *>(node)->entries.size();
+    }
+}
+
+int UnitFileItemModel::columnCount(const QModelIndex&) const
+{
+    return ColumnCount;
+}
+
+bool UnitFileItemModel::hasChildren(const QModelIndex& parent) const
+{
+    Q_D(const UnitFileItemModel);
+    if(parent.column() > 0) {
+        return false;
+    }
+    const ItemNode * node = d->node(parent);
+    if(!node) {
+        return false;
+    }
+    switch(node->childLevel) {
+        case ItemNode::UnitLevel:
+            return !d->m_units.isEmpty();
+        case ItemNode::SectionLevel:
+        {
+            // a unit which was not fetched yet is assumed to have sections, so views offer to expand it
+            const UnitItem * item = static_cast<const UnitItem *>(node);
+            return !item->fetched || !item->sections.isEmpty();
+        }
+        default:
+            return !static_cast<const SectionItem *>(node)->entries.isEmpty();
+    }
+}
+
+QVariant UnitFileItemModel::data(const QModelIndex& index, int role) const
+{
+    Q_D(const UnitFileItemModel);
+    if(!index.isValid()) {
+        return QVariant();
+    }
+    const ItemNode * parent = static_cast<const ItemNode *>(index.internalPointer());
+    switch(parent->childLevel) {
+        case ItemNode::UnitLevel:
+            return d->unitData(d->m_units.at(index.row()), index.column(), role);
+        case ItemNode::SectionLevel:
+            return d->sectionData(static_cast<const UnitItem *>(parent)->sections.at(index.row()), index.column(), role);
+        default:
+            return d->settingData(static_cast<const SectionItem *>(parent), index.row(), index.column(), role);
+    }
+}
+
+QVariant UnitFileItemModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if(orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    return section == NameColumn ? tr("Name") : tr("Value");
+}
+
+Qt::ItemFlags UnitFileItemModel::flags(const QModelIndex& index) const
+{
+    if(!index.isValid()) {
+        return Qt::NoItemFlags;
+    }
+    const ItemNode * parent = static_cast<const ItemNode *>(index.internalPointer());
+    const Qt::ItemFlags flags = Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+    return parent->childLevel == ItemNode::SettingLevel ? flags | Qt::ItemNeverHasChildren : flags;
+}
+
+bool UnitFileItemModel::canFetchMore(const QModelIndex& parent) const
+{
+    Q_D(const UnitFileItemModel);
+    if(parent.column() > 0) {
+        return false;
+    }
+    const ItemNode * node = d->node(parent);
+    if(!node) {
+        return false;
+    }
+    switch(node->childLevel) {
+        case ItemNode::UnitLevel:
+            return d->m_fetched < d->m_units.size();
+        case ItemNode::SectionLevel:
+            return !static_cast<const UnitItem *>(node)->fetched;
+        default:
+            return false;
+    }
+}
+
+void UnitFileItemModel::fetchMore(const QModelIndex& parent)
+{
+    Q_D(UnitFileItemModel);
+    if(!canFetchMore(parent)) {
+        return;
+    }
+    ItemNode * node = d->node(parent);
+    if(node->childLevel == ItemNode::SectionLevel) {
+        d->fetch(static_cast<UnitItem *>(node));
+        return;
+    }
+    const int count = qMin(d->m_batchSize, d->m_units.size() - d->m_fetched);
+    beginInsertRows(QModelIndex(), d->m_fetched, d->m_fetched + count - 1);
+    d->m_fetched += count;
+    endInsertRows();
+}
+
+QHash<int, QByteArray> UnitFileItemModel::roleNames(void) const
+{
+    QHash<int, QByteArray> names = QAbstractItemModel::roleNames();
+    names.insert(UnitRole, QByteArrayLiteral("unit"));
+    names.insert(SectionRole, QByteArrayLiteral("section"));
+    names.insert(KeyRole, QByteArrayLiteral("key"));
+    names.insert(ValueTypeRole, QByteArrayLiteral("valueType"));
+    names.insert(SourceRole, QByteArrayLiteral("source"));
+    names.insert(LineRole, QByteArrayLiteral("line"));
+    return names;
+}
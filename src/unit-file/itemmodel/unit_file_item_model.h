@@ -0,0 +1,102 @@
+#ifndef SD_UIKIT_UNITFILE_ITEM_MODEL
+#define SD_UIKIT_UNITFILE_ITEM_MODEL
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QModelIndex>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+#include "../loader/unit_file_index.h"
+
+class UnitFileItemModelPrivate;
+
+/**
+ * \brief A tree model of the effective configuration of all units in a UnitFileIndex: units at the top level, the sections of each unit below it
+ * and the settings of each section below those. The NameColumn holds the name of the unit, section or key; the ValueColumn holds the description
+ * of a unit and the value of a setting.
+ *
+ * The model does the least work it can get away with, so that a view of all units on a system stays responsive:
+ *  - top level rows are made available in batches of #batchSize() units through #canFetchMore() and #fetchMore(), as the view scrolls;
+ *  - a unit is merged (see UnitFileMerger) only once its description is shown or its sections are fetched, i.e. once it is expanded.
+ *
+ * The model is kept up to date through #update(), which fits the UnitFileWatcher::changed(const UnitFileDelta&) signal:
+ *
+ *     QObject::connect(&watcher, &UnitFileWatcher::changed, [&model, &watcher](const UnitFileDelta& delta) { model.update(watcher.index(), delta.units); });
+ *
+ * The changes of a delta are reported in as few signals as possible: adjacent units which were added or removed make up a single range of rows,
+ * and adjacent units which changed a single dataChanged() range. Changes to rows which have not been fetched yet are not reported at all.
+ */
+class UnitFileItemModel: public QAbstractItemModel
+{
+    Q_OBJECT
+public:
+    enum Column {
+        NameColumn = 0,
+        ValueColumn,
+        ColumnCount
+    };
+    enum Role {
+        /**
+         * \brief the name of the unit a row belongs to.
+         */
+        UnitRole = Qt::UserRole + 1,
+        /**
+         * \brief the name of the section, for section and setting rows.
+         */
+        SectionRole,
+        /**
+         * \brief the name of the key, for setting rows.
+         */
+        KeyRole,
+        /**
+         * \brief the DirectiveSchema::ValueType of a setting, so views may pick a suitable editor.
+         */
+        ValueTypeRole,
+        /**
+         * \brief the path of the file a setting comes from; for unit rows, the path of the unit file.
+         */
+        SourceRole,
+        /**
+         * \brief the line of the key of a setting in its file.
+         */
+        LineRole
+    };
+
+    UnitFileItemModel(QObject * parent = 0);
+    virtual ~UnitFileItemModel();
+    /**
+     * \brief replaces the index, resetting the model.
+     */
+    void setIndex(const UnitFileIndex& index);
+    UnitFileIndex unitFileIndex(void) const;
+    /**
+     * \brief replaces the index with one in which only files of the given units changed, and reports the rows which were added, removed or changed.
+     */
+    void update(const UnitFileIndex& index, const QStringList& units);
+    /**
+     * \brief sets the number of top level rows made available by each call to #fetchMore(). The default is 256.
+     */
+    void setBatchSize(int size);
+    int batchSize(void) const;
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QModelIndex parent(const QModelIndex& child) const Q_DECL_OVERRIDE;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    bool hasChildren(const QModelIndex& parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+    Qt::ItemFlags flags(const QModelIndex& index) const Q_DECL_OVERRIDE;
+    bool canFetchMore(const QModelIndex& parent) const Q_DECL_OVERRIDE;
+    void fetchMore(const QModelIndex& parent) Q_DECL_OVERRIDE;
+    QHash<int, QByteArray> roleNames(void) const Q_DECL_OVERRIDE;
+private:
+    Q_DISABLE_COPY(UnitFileItemModel)
+
+    Q_DECLARE_PRIVATE(UnitFileItemModel)
+    UnitFileItemModelPrivate *const d_ptr;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#include "annotation_store.h"
+
+#include <algorithm>
+
+static bool tokenLessThan(int token, const Annotation& annotation)
+{
+    return token < annotation.token;
+}
+
+static bool annotationLessThan(const Annotation& annotation, int token)
+{
+    return annotation.token < token;
+}
+
+AnnotationStore::Range::Range(const Annotation * begin, const Annotation * end) : m_begin(begin), m_end(end) {}
+
+const Annotation * AnnotationStore::Range::begin(void) const
+{
+    return m_begin;
+}
+
+const Annotation * AnnotationStore::Range::end(void) const
+{
+    return m_end;
+}
+
+int AnnotationStore::Range::size(void) const
+{
+    return (int) (m_end - m_begin);
+}
+
+bool AnnotationStore::Range::isEmpty(void) const
+{
+    return m_begin == m_end;
+}
+
+AnnotationStore::AnnotationStore() {}
+
+void AnnotationStore::add(int token, Annotation::Severity severity, Annotation::Code code, int hint)
+{
+    const Annotation annotation = { token, (quint8) severity, (quint8) code, (quint16) hint, 0, 0 };
+    insert(annotation);
+}
+
+void AnnotationStore::add(int token, Annotation::Severity severity, Annotation::Code code, const char * text, int size, int hint)
+{
+    const Annotation annotation = { token, (quint8) severity, (quint8) code, (quint16) hint, (quint32) m_text.size(), (quint32) size };
+    m_text.append(text, size);
+    insert(annotation);
+}
+
+void AnnotationStore::clear(void)
+{
+    m_annotations.resize(0);
+    m_text.resize(0);
+}
+
+int AnnotationStore::size(void) const
+{
+    return m_annotations.size();
+}
+
+bool AnnotationStore::isEmpty(void) const
+{
+    return m_annotations.isEmpty();
+}
+
+int AnnotationStore::count(Annotation::Severity severity) const
+{
+    int result = 0;
+    for(const Annotation& annotation: m_annotations) {
+        result += annotation.severity == severity ? 1 : 0;
+    }
+    return result;
+}
+
+AnnotationStore::Range AnnotationStore::annotations(void) const
+{
+    const Annotation * begin = m_annotations.constData();
+    return Range(begin, begin + m_annotations.size());
+}
+
+AnnotationStore::Range AnnotationStore::annotations(int token) const
+{
+    const Annotation * begin = m_annotations.constData();
+    const Annotation * end = begin + m_annotations.size();
+    const Annotation * first = std::lower_bound(begin, end, token, annotationLessThan);
+    return Range(first, std::upper_bound(first, end, token, tokenLessThan));
+}
+
+bool AnnotationStore::hasAnnotations(int token) const
+{
+    return !annotations(token).isEmpty();
+}
+
+QByteArray AnnotationStore::text(const Annotation& annotation) const
+{
+    return QByteArray::fromRawData(m_text.constData() + annotation.textOffset, (int) annotation.textLength);
+}
+
+/*
+ * Keeps the annotations sorted by token, and those of the same token in the order they were added.
+ */
+void AnnotationStore::insert(const Annotation& annotation)
+{
+    if(m_annotations.isEmpty() || m_annotations.last().token <= annotation.token) {
+        m_annotations.append(annotation);
+        return;
+    }
+    const Annotation * begin = m_annotations.constData();
+    const int position = (int) (std::upper_bound(begin, begin + m_annotations.size(), annotation.token, tokenLessThan) - begin);
+    m_annotations.insert(position, annotation);
+}
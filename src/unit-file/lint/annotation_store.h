@@ -0,0 +1,102 @@
+#ifndef SD_UIKIT_UNITFILE_ANNOTATION_STORE
+#define SD_UIKIT_UNITFILE_ANNOTATION_STORE
+
+#include <QByteArray>
+#include <QVector>
+#include <QtGlobal>
+
+/**
+ * \brief A diagnostic attached to a token, such as a syntax error or a suggestion for a misspelled key.
+ */
+struct Annotation
+{
+    enum Severity {
+        Error = 0,
+        Warning,
+        Suggestion,
+        Help
+    };
+    enum Code {
+        SyntaxError = 0, /* hint holds the hint code reported by the tokeniser, see Tokeniser::getError() */
+        UnknownSection,
+        UnknownKey,
+        DeprecatedKey,
+        InvalidValue, /* hint holds the DirectiveSchema::ValueType the value should have */
+        DidYouMean, /* the text is a known key which is close to an unknown one */
+        SeeAlso /* the text is a reference to documentation, e.g. man:systemd.service(5) */
+    };
+    /**
+     * \brief the index of the token in the output of the tokeniser.
+     */
+    qint32 token;
+    quint8 severity;
+    quint8 code;
+    quint16 hint;
+    /**
+     * \brief the text of the annotation, if any, as a range in the text buffer of the store (see AnnotationStore::text()).
+     */
+    quint32 textOffset;
+    quint32 textLength;
+};
+Q_DECLARE_TYPEINFO(Annotation, Q_PRIMITIVE_TYPE);
+
+/**
+ * \brief A side table of annotations for the tokens of a file, indexed by token.
+ * Annotations are kept in a single array sorted by token, so all annotations of a token are a contiguous range of it, and their texts share a
+ * single buffer. Tokens without annotations take no space at all, and a store without any annotations does not allocate.
+ * Looking up the annotations of a token is a binary search; adding annotations in token order (as a single pass over the tokens does) is a plain
+ * append, otherwise later annotations are moved up to make room.
+ */
+class AnnotationStore
+{
+public:
+    /**
+     * \brief a range of annotations, which is only valid for as long as the store is not changed.
+     */
+    class Range
+    {
+    public:
+        Range(const Annotation * begin, const Annotation * end);
+        const Annotation * begin(void) const;
+        const Annotation * end(void) const;
+        int size(void) const;
+        bool isEmpty(void) const;
+    private:
+        const Annotation * m_begin;
+        const Annotation * m_end;
+    };
+
+    AnnotationStore();
+    void add(int token, Annotation::Severity severity, Annotation::Code code, int hint = 0);
+    /**
+     * \brief adds an annotation with a text, which is copied into the store.
+     */
+    void add(int token, Annotation::Severity severity, Annotation::Code code, const char * text, int size, int hint = 0);
+    /**
+     * \brief removes all annotations, but keeps the memory allocated for them to be reused.
+     */
+    void clear(void);
+    int size(void) const;
+    bool isEmpty(void) const;
+    /**
+     * \brief the number of annotations of the given severity.
+     */
+    int count(Annotation::Severity severity) const;
+    /**
+     * \brief all annotations, sorted by token. Annotations of the same token are in the order they were added.
+     */
+    Range annotations(void) const;
+    Range annotations(int token) const;
+    bool hasAnnotations(int token) const;
+    /**
+     * \brief the text of an annotation, which refers to the buffer of the store instead of being copied.
+     */
+    QByteArray text(const Annotation& annotation) const;
+private:
+    void insert(const Annotation& annotation);
+private:
+    QVector<Annotation> m_annotations;
+    QByteArray m_text;
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include "unit_file_linter.h"
+
+#include "../types/directive_schema.h"
+#include "../types/value_parser.h"
+
+#include <cstring>
+
+/*
+ * Values are joined (if continued over several lines) in a buffer of this size before they are parsed. Longer values of the types which are
+ * checked do not occur in practice, and are not checked.
+ */
+static const int joinedValueSize = 256;
+
+static bool startsWith(const char * text, int size, const char * prefix)
+{
+    const int length = (int) qstrlen(prefix);
+    return size >= length && strncmp(text, prefix, (size_t) length) == 0;
+}
+
+static bool isInfinity(const char * text, int size)
+{
+    while(size > 0 && *text == ' ') {
+        ++text;
+        --size;
+    }
+    while(size > 0 && text[size - 1] == ' ') {
+        --size;
+    }
+    return size == 8 && strncmp(text, "infinity", 8) == 0;
+}
+
+static bool isValid(DirectiveSchema::ValueType type, const char * text, int size, bool condition)
+{
+    for(int i = 0; i < size; ++i) {
+        if(text[i] == '%') {
+            return true;
+        }
+    }
+    bool b;
+    quint64 n;
+    switch(type) {
+        case DirectiveSchema::Boolean:
+            // conditions may be negated (!) and made triggering (|)
+            while(condition && size > 0 && (*text == '|' || *text == '!' || *text == ' ')) {
+                ++text;
+                --size;
+            }
+            return ValueParser::parseBoolean(text, size, b);
+        case DirectiveSchema::Size:
+            // limits such as MemoryMax= may also be infinity
+            return isInfinity(text, size) || ValueParser::parseSize(text, size, ValueParser::IEC, n);
+        case DirectiveSchema::TimeSpan:
+            return ValueParser::parseTimeSpan(text, size, n);
+        default:
+            return true;
+    }
+}
+
+/*
+ * Checks the value of the key at token index key, if any, against its type.
+ */
+static void lintValue(const QByteArray& utf8, const QVector<TokenSpan>& tokens, int key, DirectiveSchema::ValueType type, AnnotationStore& store)
+{
+    const TokenSpan& keyToken = tokens.at(key);
+    int first = -1, size = 0;
+    char joined[joinedValueSize];
+    for(int i = key + 1; i < tokens.size() && tokens.at(i).kind != TokenSpan::Key && tokens.at(i).kind != TokenSpan::Section; ++i) {
+        const TokenSpan& token = tokens.at(i);
+        if(token.kind != TokenSpan::Value) {
+            continue;
+        }
+        // the value is empty, which resets the setting
+        if(token.flags & TokenSpan::EmptyValue) {
+            return;
+        }
+        if(first < 0) {
+            first = i;
+        }
+        if(size + (int) token.length > joinedValueSize) {
+            return;
+        }
+        memcpy(joined + size, utf8.constData() + token.offset, token.length);
+        size += (int) token.length;
+        if(token.flags & TokenSpan::Continued) {
+            joined[size - 1] = ' ';
+        }
+    }
+    if(first < 0) {
+        return;
+    }
+    const char * name = utf8.constData() + keyToken.offset;
+    const bool condition = startsWith(name, (int) keyToken.length, "Condition") || startsWith(name, (int) keyToken.length, "Assert");
+    if(!isValid(type, joined, size, condition)) {
+        store.add(first, Annotation::Error, Annotation::InvalidValue, type);
+    }
+}
+
+void UnitFileLinter::lint(const QByteArray& utf8, const QVector<TokenSpan>& tokens, AnnotationStore& store)
+{
+    const char * section = 0;
+    int sectionSize = 0;
+    for(int i = 0; i < tokens.size(); ++i) {
+        const TokenSpan& token = tokens.at(i);
+        const char * text = utf8.constData() + token.offset;
+        int size = (int) token.length;
+        switch(token.kind) {
+            case TokenSpan::SyntaxError:
+                store.add(i, Annotation::Error, Annotation::SyntaxError, token.hint);
+                break;
+            case TokenSpan::Section:
+                section = text;
+                sectionSize = size;
+                if(DirectiveSchema::find(text, size, "", 0).status == DirectiveSchema::UnknownSection) {
+                    store.add(i, Annotation::Warning, Annotation::UnknownSection);
+                }
+                break;
+            case TokenSpan::Key:
+            {
+                if(!section) {
+                    break;
+                }
+                // whitespace between the key and the '=' is part of the Key token
+                while(size > 0 && (text[size - 1] == ' ' || text[size - 1] == '\t')) {
+                    --size;
+                }
+                const DirectiveSchema::Directive directive = DirectiveSchema::find(section, sectionSize, text, size);
+                if(directive.status == DirectiveSchema::Unknown) {
+                    store.add(i, Annotation::Warning, Annotation::UnknownKey);
+                    const char * suggestion = DirectiveSchema::suggest(section, sectionSize, text, size);
+                    if(suggestion) {
+                        store.add(i, Annotation::Suggestion, Annotation::DidYouMean, suggestion, (int) qstrlen(suggestion));
+                    }
+                    const char * page = DirectiveSchema::manualPage(section, sectionSize);
+                    store.add(i, Annotation::Help, Annotation::SeeAlso, page, (int) qstrlen(page));
+                }
+                else if(directive.status == DirectiveSchema::Deprecated) {
+                    store.add(i, Annotation::Warning, Annotation::DeprecatedKey);
+                }
+                if(directive.status == DirectiveSchema::Known || directive.status == DirectiveSchema::Deprecated) {
+                    lintValue(utf8, tokens, i, directive.type, store);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
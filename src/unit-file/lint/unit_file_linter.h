@@ -0,0 +1,29 @@
+#ifndef SD_UIKIT_UNITFILE_LINTER
+#define SD_UIKIT_UNITFILE_LINTER
+
+#include <QByteArray>
+#include <QVector>
+
+#include "../parser/token.h"
+#include "annotation_store.h"
+
+/**
+ * \brief Checks the tokens of a unit file and annotates those with problems:
+ *  - syntax errors reported by the tokeniser, as errors;
+ *  - unknown sections and keys, and deprecated keys (see DirectiveSchema), as warnings. Unknown keys additionally get the key they were most likely
+ *    meant to be as a suggestion, and the manual page of their section as help;
+ *  - values of booleans, sizes and time spans which do not parse (see ValueParser), as errors on the (first) Value token.
+ *    Values with specifiers such as %i are left alone, as they can only be checked once the specifiers are resolved.
+ *
+ * Linting is a single pass over the tokens which only allocates for the annotations it adds.
+ */
+class UnitFileLinter
+{
+public:
+    /**
+     * \brief lints the output of Tokeniser::tokenise(const QByteArray&, const Tokeniser::LineEnding&, QVector<ByteRange>*), adding to the store.
+     */
+    static void lint(const QByteArray& utf8, const QVector<TokenSpan>& tokens, AnnotationStore& store);
+};
+
+#endif
@@ -0,0 +1,221 @@
+#include "parse_cache.h"
+
+#include <QSaveFile>
+
+#include <cstring>
+
+/*
+ * The version must be bumped whenever the layout of the file changes, and also whenever the Tokeniser changes the tokens it reports for the same input.
+ */
+static const char cacheMagic[8] = { 'S', 'D', 'U', 'I', 'K', 'P', 'C', '\0' };
+static const quint32 cacheVersion = 1;
+static const quint32 cacheByteOrder = 0x01020304;
+
+/*
+ * Layout: a header, followed by one record per file, followed by the data the records refer to.
+ * All offsets are relative to the start of the file, and all data is aligned to 8 bytes.
+ */
+struct CacheHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 byteOrder;
+    quint32 tokenSize;
+    quint32 lineEnding;
+    quint32 count;
+    quint32 reserved;
+    quint64 size;
+};
+
+struct CacheRecord
+{
+    quint64 inode;
+    qint64 size;
+    qint64 mtime;
+    quint32 pathOffset;
+    quint32 pathLength;
+    quint32 contentOffset;
+    quint32 contentLength;
+    quint32 tokensOffset;
+    quint32 tokenCount;
+    quint32 invalidOffset;
+    quint32 invalidCount;
+};
+
+static inline quint64 align(quint64 offset)
+{
+    return (offset + 7) & ~Q_UINT64_C(7);
+}
+
+ParseCache::ParseCache(const QString& fileName, const Tokeniser::LineEnding& lineEnding) :
+    m_file(fileName), m_lineEnding(lineEnding), m_map(0), m_size(0) {}
+
+ParseCache::~ParseCache()
+{
+    close();
+}
+
+bool ParseCache::open(void)
+{
+    close();
+    if(!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    m_size = m_file.size();
+    if(m_size < (qint64) sizeof(CacheHeader) || m_size > Q_INT64_C(0xFFFFFFFF)) {
+        close();
+        return false;
+    }
+    m_map = m_file.map(0, m_size);
+    if(!m_map) {
+        close();
+        return false;
+    }
+    const CacheHeader * header = reinterpret_cast<const CacheHeader *>(m_map);
+    if(memcmp(header->magic, cacheMagic, sizeof(cacheMagic)) != 0 || header->version != cacheVersion || header->byteOrder != cacheByteOrder ||
+        header->tokenSize != sizeof(TokenSpan) || header->lineEnding != (quint32) m_lineEnding || header->size != (quint64) m_size ||
+        !contains(sizeof(CacheHeader), (quint64) header->count * sizeof(CacheRecord))) {
+        close();
+        return false;
+    }
+    const CacheRecord * records = reinterpret_cast<const CacheRecord *>(m_map + sizeof(CacheHeader));
+    m_records.reserve(header->count);
+    for(quint32 i = 0; i < header->count; ++i) {
+        const CacheRecord& r = records[i];
+        if(contains(r.pathOffset, r.pathLength)) {
+            m_records.insert(QByteArray::fromRawData(reinterpret_cast<const char *>(m_map + r.pathOffset), (int) r.pathLength), (int) i);
+        }
+    }
+    return true;
+}
+
+void ParseCache::close(void)
+{
+    m_records.clear();
+    if(m_map) {
+        m_file.unmap(const_cast<uchar *>(m_map));
+        m_map = 0;
+    }
+    if(m_file.isOpen()) {
+        m_file.close();
+    }
+    m_size = 0;
+}
+
+bool ParseCache::isOpen(void) const
+{
+    return m_map != 0;
+}
+
+QString ParseCache::fileName(void) const
+{
+    return m_file.fileName();
+}
+
+int ParseCache::size(void) const
+{
+    return m_records.size();
+}
+
+bool ParseCache::contains(quint32 offset, quint64 length) const
+{
+    return offset <= (quint64) m_size && length <= (quint64) m_size - offset;
+}
+
+bool ParseCache::lookup(const QString& path, const FileStamp& stamp, UnitFileEntry& entry) const
+{
+    const QHash<QByteArray, int>::const_iterator it = m_records.constFind(QFile::encodeName(path));
+    if(it == m_records.constEnd()) {
+        return false;
+    }
+    const CacheRecord& r = reinterpret_cast<const CacheRecord *>(m_map + sizeof(CacheHeader))[it.value()];
+    if(r.inode != stamp.inode || r.size != stamp.size || r.mtime != stamp.mtime || (qint64) r.contentLength != stamp.size ||
+        !contains(r.contentOffset, r.contentLength) ||
+        !contains(r.tokensOffset, (quint64) r.tokenCount * sizeof(TokenSpan)) ||
+        !contains(r.invalidOffset, (quint64) r.invalidCount * sizeof(ByteRange))) {
+        return false;
+    }
+    QVector<TokenSpan> tokens((int) r.tokenCount);
+    QVector<ByteRange> invalid((int) r.invalidCount);
+    if(r.tokenCount) {
+        memcpy(tokens.data(), m_map + r.tokensOffset, r.tokenCount * sizeof(TokenSpan));
+    }
+    if(r.invalidCount) {
+        memcpy(invalid.data(), m_map + r.invalidOffset, r.invalidCount * sizeof(ByteRange));
+    }
+    // a damaged cache must not hand out tokens which point outside of the content
+    for(const TokenSpan& token: tokens) {
+        if(token.offset > r.contentLength || token.length > r.contentLength - token.offset) {
+            return false;
+        }
+    }
+    for(const ByteRange& range: invalid) {
+        if(range.offset > r.contentLength || range.length > r.contentLength - range.offset) {
+            return false;
+        }
+    }
+    entry.stamp = stamp;
+    entry.content = QByteArray(reinterpret_cast<const char *>(m_map + r.contentOffset), (int) r.contentLength);
+    entry.tokens = tokens;
+    entry.invalidBytes = invalid;
+    return true;
+}
+
+/*
+ * Appends data at the next aligned offset, returning that offset.
+ */
+static quint32 appendAligned(QByteArray& data, const char * bytes, quint64 length)
+{
+    data.append(QByteArray((int) (align(data.size()) - data.size()), '\0'));
+    const quint32 offset = (quint32) data.size();
+    data.append(bytes, (int) length);
+    return offset;
+}
+
+bool ParseCache::write(const QString& fileName, const UnitFileIndex& index, const Tokeniser::LineEnding& lineEnding)
+{
+    QVector<CacheRecord> records;
+    QVector<QByteArray> paths;
+    for(const UnitFileEntry& entry: index.entries()) {
+        if(entry.kind != UnitFileEntry::Masked) {
+            records.append(CacheRecord());
+            paths.append(QFile::encodeName(entry.path));
+        }
+    }
+
+    // the data area starts right after the records, which can only be filled in once it is known where everything goes
+    QByteArray data(sizeof(CacheHeader) + records.size() * sizeof(CacheRecord), '\0');
+    int i = 0;
+    for(const UnitFileEntry& entry: index.entries()) {
+        if(entry.kind == UnitFileEntry::Masked) {
+            continue;
+        }
+        CacheRecord& r = records[i];
+        r.inode = entry.stamp.inode;
+        r.size = entry.stamp.size;
+        r.mtime = entry.stamp.mtime;
+        r.pathLength = (quint32) paths.at(i).size();
+        r.pathOffset = appendAligned(data, paths.at(i).constData(), r.pathLength);
+        r.contentLength = (quint32) entry.content.size();
+        r.contentOffset = appendAligned(data, entry.content.constData(), r.contentLength);
+        r.tokenCount = (quint32) entry.tokens.size();
+        r.tokensOffset = appendAligned(data, reinterpret_cast<const char *>(entry.tokens.constData()), r.tokenCount * sizeof(TokenSpan));
+        r.invalidCount = (quint32) entry.invalidBytes.size();
+        r.invalidOffset = appendAligned(data, reinterpret_cast<const char *>(entry.invalidBytes.constData()), r.invalidCount * sizeof(ByteRange));
+        ++i;
+    }
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = cacheVersion;
+    header.byteOrder = cacheByteOrder;
+    header.tokenSize = sizeof(TokenSpan);
+    header.lineEnding = (quint32) lineEnding;
+    header.count = (quint32) records.size();
+    header.size = (quint64) data.size();
+    memcpy(data.data(), &header, sizeof(header));
+    memcpy(data.data() + sizeof(CacheHeader), records.constData(), records.size() * sizeof(CacheRecord));
+
+    QSaveFile file(fileName);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size() && file.commit();
+}
@@ -0,0 +1,61 @@
+#ifndef SD_UIKIT_UNITFILE_PARSE_CACHE
+#define SD_UIKIT_UNITFILE_PARSE_CACHE
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QString>
+
+#include "unit_file_index.h"
+#include "../parser/tokeniser.h"
+
+/**
+ * \brief A binary on-disk cache of the contents and tokens of unit files, so unchanged files need not be validated and tokenised again.
+ * Results are keyed by path and checked against the FileStamp (inode, size and modification time) of the file: a result is only used if the
+ * file on disk still has the stamp it had when it was read.
+ *
+ * The cache is memory mapped when opened, and results are copied straight out of the mapping by #lookup(). It may be used from any number of threads at once.
+ * A cache which was written by a different version of the format, for a different line ending or on a different architecture is ignored as a whole.
+ * Results which do not fit inside the file (e.g. because the file is truncated) are never used.
+ *
+ * The cache is written by #write(), which replaces the file atomically: a cache which is being read is never affected by writing a new one.
+ */
+class ParseCache
+{
+public:
+    ParseCache(const QString& fileName, const Tokeniser::LineEnding& lineEnding = Tokeniser::LF);
+    ~ParseCache();
+    /**
+     * \brief opens and maps the cache file, and checks its header.
+     * \return false if there is no usable cache, in which case #lookup() finds nothing.
+     */
+    bool open(void);
+    void close(void);
+    bool isOpen(void) const;
+    QString fileName(void) const;
+    /**
+     * \brief the number of results in the cache.
+     */
+    int size(void) const;
+    /**
+     * \brief fills in the content, tokens and invalid bytes of the entry, if the cache has a result for the file at the given path with the given stamp.
+     * \return true if a result was found.
+     */
+    bool lookup(const QString& path, const FileStamp& stamp, UnitFileEntry& entry) const;
+    /**
+     * \brief writes a new cache file with the results for all unit files and drop-ins in the index.
+     * \return true on success.
+     */
+    static bool write(const QString& fileName, const UnitFileIndex& index, const Tokeniser::LineEnding& lineEnding = Tokeniser::LF);
+private:
+    Q_DISABLE_COPY(ParseCache)
+    bool contains(quint32 offset, quint64 length) const;
+private:
+    QFile m_file;
+    const Tokeniser::LineEnding m_lineEnding;
+    const uchar * m_map;
+    qint64 m_size;
+    QHash<QByteArray, int> m_records;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include "unit_file_index.h"
+
+#include <QFile>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+
+bool FileStamp::read(const QString& path, FileStamp& stamp)
+{
+    struct stat info;
+    if(::stat(QFile::encodeName(path).constData(), &info) != 0) {
+        return false;
+    }
+    stamp.inode = (quint64) info.st_ino;
+    stamp.size = (qint64) info.st_size;
+    stamp.mtime = (qint64) info.st_mtim.tv_sec * Q_INT64_C(1000000000) + info.st_mtim.tv_nsec;
+    return true;
+}
+
+QString UnitFileEntry::text(const TokenSpan& token) const
+{
+    return Tokeniser::text(content, token);
+}
+
+bool UnitFileEntry::readContent(const Tokeniser::LineEnding& lineEnding)
+{
+    content.clear();
+    tokens.clear();
+    invalidBytes.clear();
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    content = file.readAll();
+    tokens = Tokeniser::tokenise(content, lineEnding, &invalidBytes);
+    return true;
+}
+
+int UnitFileIndex::size(void) const
+{
+    return m_entries.size();
+}
+
+const UnitFileEntry& UnitFileIndex::at(int i) const
+{
+    return m_entries.at(i);
+}
+
+const QVector<UnitFileEntry>& UnitFileIndex::entries(void) const
+{
+    return m_entries;
+}
+
+QStringList UnitFileIndex::units(void) const
+{
+    QStringList result = m_units.keys();
+    result.sort();
+    return result;
+}
+
+int UnitFileIndex::unit(const QString& name) const
+{
+    return m_units.value(name, -1);
+}
+
+QVector<int> UnitFileIndex::dropIns(const QString& name) const
+{
+    return m_dropIns.value(name);
+}
+
+static QString fileName(const QString& path)
+{
+    return path.mid(path.lastIndexOf(QLatin1Char('/')) + 1);
+}
+
+static bool entryLessThan(const UnitFileEntry& a, const UnitFileEntry& b)
+{
+    return a.priority < b.priority || (a.priority == b.priority && a.path < b.path);
+}
+
+/*
+ * Sorts the entries and builds the lookup tables, once all entries have been added.
+ */
+void UnitFileIndex::build(void)
+{
+    std::sort(m_entries.begin(), m_entries.end(), entryLessThan);
+    m_units.clear();
+    m_dropIns.clear();
+    for(int i = 0; i < m_entries.size(); ++i) {
+        const UnitFileEntry& e = m_entries.at(i);
+        if(e.kind == UnitFileEntry::DropIn) {
+            m_dropIns[e.unit].append(i);
+        }
+        // entries are sorted by priority, so the first one seen wins
+        else if(!m_units.contains(e.unit)) {
+            m_units.insert(e.unit, i);
+        }
+    }
+    for(auto it = m_dropIns.begin(); it != m_dropIns.end(); ++it) {
+        std::stable_sort(it.value().begin(), it.value().end(), [this](int a, int b) -> bool {
+            return fileName(m_entries.at(a).path) < fileName(m_entries.at(b).path);
+        });
+    }
+}
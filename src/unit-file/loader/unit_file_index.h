@@ -0,0 +1,110 @@
+#ifndef SD_UIKIT_UNITFILE_INDEX
+#define SD_UIKIT_UNITFILE_INDEX
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "../parser/token.h"
+#include "../parser/tokeniser.h"
+
+/**
+ * \brief Identifies a version of a file on disk, to tell whether it changed since it was last read.
+ */
+struct FileStamp
+{
+    quint64 inode;
+    qint64 size;
+    /**
+     * \brief the last modification time, in nanoseconds since the epoch.
+     */
+    qint64 mtime;
+    bool operator==(const FileStamp& other) const
+    {
+        return inode == other.inode && size == other.size && mtime == other.mtime;
+    }
+    bool operator!=(const FileStamp& other) const
+    {
+        return !(*this == other);
+    }
+    /**
+     * \brief reads the stamp of the file at path, following symlinks.
+     * \return false if the file cannot be found.
+     */
+    static bool read(const QString& path, FileStamp& stamp);
+};
+
+/**
+ * \brief A unit file (or drop-in) found on disk, along with the tokens found in it.
+ */
+struct UnitFileEntry
+{
+    enum Kind {
+        Unit = 0, /* a unit file proper */
+        DropIn, /* a .conf file in a <unit>.d directory */
+        Masked /* a unit file which is a symlink to /dev/null */
+    };
+    Kind kind;
+    /**
+     * \brief the name of the unit this entry applies to, e.g. foo.service for foo.service.d/override.conf
+     */
+    QString unit;
+    QString path;
+    /**
+     * \brief the index of the search path the entry was found in: lower values take precedence.
+     */
+    int priority;
+    /**
+     * \brief the stamp of the file when its content was read. All zero for masked units.
+     */
+    FileStamp stamp;
+    QByteArray content;
+    QVector<TokenSpan> tokens;
+    QVector<ByteRange> invalidBytes;
+    /**
+     * \brief the text of one of the #tokens.
+     */
+    QString text(const TokenSpan& token) const;
+    /**
+     * \brief reads the file at #path and tokenises it, replacing #content, #tokens and #invalidBytes.
+     * \return false if the file could not be read, in which case the entry is left empty.
+     */
+    bool readContent(const Tokeniser::LineEnding& lineEnding);
+};
+
+/**
+ * \brief A read-only index of the unit files and drop-ins found across a set of search paths, as built by UnitFileLoader.
+ * Entries are ordered by priority and then by path. The index is implicitly shared: copies are cheap and may be read from any thread.
+ */
+class UnitFileIndex
+{
+public:
+    int size(void) const;
+    const UnitFileEntry& at(int i) const;
+    const QVector<UnitFileEntry>& entries(void) const;
+    /**
+     * \brief the names of all units for which a unit file was found, sorted.
+     */
+    QStringList units(void) const;
+    /**
+     * \brief the index of the unit file for the given unit which takes precedence, i.e. the one found in the first search path.
+     * \return the index of the entry, or -1 if there is no such unit.
+     */
+    int unit(const QString& name) const;
+    /**
+     * \brief the indices of all drop-ins for the given unit, ordered by file name and then by priority.
+     */
+    QVector<int> dropIns(const QString& name) const;
+private:
+    friend class LoadJob;
+    friend class UnitFileWatcherPrivate;
+    void build(void);
+private:
+    QVector<UnitFileEntry> m_entries;
+    QHash<QString, int> m_units;
+    QHash<QString, QVector<int> > m_dropIns;
+};
+
+#endif
@@ -0,0 +1,262 @@
+#include "unit_file_loader.h"
+#include "parse_cache.h"
+#include "work_stealing_pool.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+static const QString dropInSuffix(QStringLiteral(".d"));
+static const QString dropInFileSuffix(QStringLiteral(".conf"));
+static const QString devNull(QStringLiteral("/dev/null"));
+
+/*
+ * The state shared by all tasks of a single UnitFileLoader::load() call.
+ * Each worker appends to its own result vector and counts its own cache misses, so no locking is needed. Workers reach those through
+ * pointers taken up front, as a non-const QVector accessor may detach and is not safe to call from several threads at once.
+ */
+class LoadJob
+{
+public:
+    LoadJob(int threads, const Tokeniser::LineEnding& lineEnding, const ParseCache * cache) :
+        m_pool(threads), m_results(m_pool.threadCount()), m_misses(m_pool.threadCount(), 0), m_workerResults(m_results.data()),
+        m_workerMisses(m_misses.data()), m_lineEnding(lineEnding), m_cache(cache) {}
+    
+    void scanSearchPath(const QString& path, int priority)
+    {
+        m_pool.submit([this, path, priority](int worker) -> void {
+            scanUnits(path, priority, worker);
+        });
+    }
+    
+    UnitFileIndex finish(void)
+    {
+        m_pool.waitForDone();
+        UnitFileIndex index;
+        int size = 0;
+        for(const QVector<UnitFileEntry>& r: m_results) {
+            size += r.size();
+        }
+        index.m_entries.reserve(size);
+        for(const QVector<UnitFileEntry>& r: m_results) {
+            index.m_entries += r;
+        }
+        index.build();
+        return index;
+    }
+    
+    /*
+     * Whether the cache is out of date: some file was not found in it, or it holds results for files which no longer exist.
+     */
+    bool cacheOutdated(const UnitFileIndex& index) const
+    {
+        int loaded = 0;
+        for(const UnitFileEntry& entry: index.entries()) {
+            if(entry.kind != UnitFileEntry::Masked) {
+                loaded ++;
+            }
+        }
+        int misses = 0;
+        for(int m: m_misses) {
+            misses += m;
+        }
+        return misses > 0 || !m_cache || m_cache->size() != loaded;
+    }
+    
+private:
+    static QFileInfoList list(const QString& path)
+    {
+        // QDir::System so that units masked by a symlink to /dev/null are listed as well
+        return QDir(path).entryInfoList(QDir::Files | QDir::Dirs | QDir::System | QDir::NoDotAndDotDot, QDir::NoSort);
+    }
+    
+    void scanUnits(const QString& path, int priority, int worker)
+    {
+        for(const QFileInfo& info: list(path)) {
+            const QString name = info.fileName();
+            if(info.isDir()) {
+                if(name.endsWith(dropInSuffix)) {
+                    const QString unit = name.left(name.size() - dropInSuffix.size());
+                    if(UnitFileLoader::isUnitName(unit)) {
+                        const QString dir = info.filePath();
+                        m_pool.submit(worker, [this, dir, unit, priority](int w) -> void {
+                            scanDropIns(dir, unit, priority, w);
+                        });
+                    }
+                }
+            }
+            else if(UnitFileLoader::isUnitName(name)) {
+                const UnitFileEntry::Kind kind = UnitFileLoader::isMasked(info) ? UnitFileEntry::Masked : UnitFileEntry::Unit;
+                submitFile(info.filePath(), name, kind, priority, worker);
+            }
+        }
+    }
+    
+    void scanDropIns(const QString& path, const QString& unit, int priority, int worker)
+    {
+        for(const QFileInfo& info: list(path)) {
+            if(!info.isDir() && info.fileName().endsWith(dropInFileSuffix)) {
+                submitFile(info.filePath(), unit, UnitFileEntry::DropIn, priority, worker);
+            }
+        }
+    }
+    
+    void submitFile(const QString& path, const QString& unit, UnitFileEntry::Kind kind, int priority, int worker)
+    {
+        m_pool.submit(worker, [this, path, unit, kind, priority](int w) -> void {
+            load(path, unit, kind, priority, w);
+        });
+    }
+    
+    void load(const QString& path, const QString& unit, UnitFileEntry::Kind kind, int priority, int worker)
+    {
+        UnitFileEntry entry;
+        entry.kind = kind;
+        entry.unit = unit;
+        entry.path = path;
+        entry.priority = priority;
+        entry.stamp.inode = 0;
+        entry.stamp.size = entry.stamp.mtime = 0;
+        // the stamp is taken before reading: should the file change while it is read, the cache entry is outdated on the next run
+        if(kind != UnitFileEntry::Masked && FileStamp::read(path, entry.stamp) && !(m_cache && m_cache->lookup(path, entry.stamp, entry))) {
+            m_workerMisses[worker] ++;
+            entry.readContent(m_lineEnding);
+        }
+        m_workerResults[worker].append(entry);
+    }
+    
+private:
+    WorkStealingPool m_pool;
+    QVector<QVector<UnitFileEntry> > m_results;
+    QVector<int> m_misses;
+    QVector<UnitFileEntry> * const m_workerResults;
+    int * const m_workerMisses;
+    const Tokeniser::LineEnding m_lineEnding;
+    const ParseCache * const m_cache;
+};
+
+UnitFileLoader::UnitFileLoader(const QStringList& searchPaths, const Tokeniser::LineEnding& lineEnding) :
+    m_searchPaths(searchPaths), m_lineEnding(lineEnding), m_threads(0) {}
+
+QStringList UnitFileLoader::searchPaths(void) const
+{
+    return m_searchPaths;
+}
+
+Tokeniser::LineEnding UnitFileLoader::lineEnding(void) const
+{
+    return m_lineEnding;
+}
+
+void UnitFileLoader::setThreadCount(int threads)
+{
+    m_threads = threads;
+}
+
+int UnitFileLoader::threadCount(void) const
+{
+    return m_threads;
+}
+
+void UnitFileLoader::setCacheFile(const QString& fileName)
+{
+    m_cacheFile = fileName;
+}
+
+QString UnitFileLoader::cacheFile(void) const
+{
+    return m_cacheFile;
+}
+
+UnitFileIndex UnitFileLoader::load(void) const
+{
+    if(m_cacheFile.isEmpty()) {
+        LoadJob job(m_threads, m_lineEnding, 0);
+        for(int i = 0; i < m_searchPaths.size(); ++i) {
+            job.scanSearchPath(m_searchPaths.at(i), i);
+        }
+        return job.finish();
+    }
+
+    ParseCache cache(m_cacheFile, m_lineEnding);
+    const bool cached = cache.open();
+    LoadJob job(m_threads, m_lineEnding, cached ? &cache : 0);
+    for(int i = 0; i < m_searchPaths.size(); ++i) {
+        job.scanSearchPath(m_searchPaths.at(i), i);
+    }
+    const UnitFileIndex index = job.finish();
+    if(job.cacheOutdated(index)) {
+        // failing to write the cache only means the next run is slower
+        QDir().mkpath(QFileInfo(m_cacheFile).absolutePath());
+        ParseCache::write(m_cacheFile, index, m_lineEnding);
+    }
+    return index;
+}
+
+QString UnitFileLoader::defaultCacheFile(void)
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/sd-ui-kit/unit-files.cache");
+}
+
+QStringList UnitFileLoader::systemSearchPaths(void)
+{
+    return QStringList()
+        << QStringLiteral("/etc/systemd/system.control")
+        << QStringLiteral("/run/systemd/system.control")
+        << QStringLiteral("/run/systemd/transient")
+        << QStringLiteral("/run/systemd/generator.early")
+        << QStringLiteral("/etc/systemd/system")
+        << QStringLiteral("/etc/systemd/system.attached")
+        << QStringLiteral("/run/systemd/system")
+        << QStringLiteral("/run/systemd/system.attached")
+        << QStringLiteral("/run/systemd/generator")
+        << QStringLiteral("/usr/local/lib/systemd/system")
+        << QStringLiteral("/usr/lib/systemd/system")
+        << QStringLiteral("/lib/systemd/system")
+        << QStringLiteral("/run/systemd/generator.late");
+}
+
+QStringList UnitFileLoader::userSearchPaths(void)
+{
+    const QString config = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation);
+    const QString data = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
+    const QString runtime = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    return QStringList()
+        << config + QStringLiteral("/systemd/user.control")
+        << runtime + QStringLiteral("/systemd/user.control")
+        << runtime + QStringLiteral("/systemd/transient")
+        << runtime + QStringLiteral("/systemd/generator.early")
+        << config + QStringLiteral("/systemd/user")
+        << QStringLiteral("/etc/systemd/user")
+        << runtime + QStringLiteral("/systemd/user")
+        << QStringLiteral("/run/systemd/user")
+        << runtime + QStringLiteral("/systemd/generator")
+        << data + QStringLiteral("/systemd/user")
+        << QStringLiteral("/usr/local/lib/systemd/user")
+        << QStringLiteral("/usr/lib/systemd/user")
+        << runtime + QStringLiteral("/systemd/generator.late");
+}
+
+bool UnitFileLoader::isUnitName(const QString& fileName)
+{
+    static const char * const suffixes[] = {
+        ".service", ".socket", ".device", ".mount", ".automount", ".swap", ".target", ".path", ".timer", ".slice", ".scope"
+    };
+    const int dot = fileName.lastIndexOf(QLatin1Char('.'));
+    if(dot <= 0) {
+        return false;
+    }
+    const QStringRef suffix = fileName.midRef(dot);
+    for(const char * s: suffixes) {
+        if(suffix == QLatin1String(s)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool UnitFileLoader::isMasked(const QFileInfo& info)
+{
+    return info.isSymLink() && info.symLinkTarget() == devNull;
+}
@@ -0,0 +1,71 @@
+#ifndef SD_UIKIT_UNITFILE_LOADER
+#define SD_UIKIT_UNITFILE_LOADER
+
+#include <QFileInfo>
+#include <QString>
+#include <QStringList>
+
+#include "unit_file_index.h"
+#include "../parser/tokeniser.h"
+
+class LoadJob;
+
+/**
+ * \brief Finds and tokenises all unit files and drop-ins across a list of search paths, in parallel.
+ * Directories are listed and files are read and tokenised as tasks on a WorkStealingPool, so a few large directories
+ * (such as /usr/lib/systemd/system) are spread over all worker threads. Each worker collects its own results and these are merged
+ * into a single read-only UnitFileIndex once everything is done.
+ *
+ * Search paths are given in order of precedence: a unit file found in an earlier search path overrides one found in a later search path.
+ * Tokenised files may be cached on disk across runs, see #setCacheFile().
+ */
+class UnitFileLoader
+{
+public:
+    UnitFileLoader(const QStringList& searchPaths, const Tokeniser::LineEnding& lineEnding = Tokeniser::LF);
+    QStringList searchPaths(void) const;
+    Tokeniser::LineEnding lineEnding(void) const;
+    /**
+     * \brief sets the number of threads used. If less than 1 (the default), QThread::idealThreadCount() is used.
+     */
+    void setThreadCount(int threads);
+    int threadCount(void) const;
+    /**
+     * \brief sets the file used to cache tokenised unit files across runs (see ParseCache). By default (an empty file name) no cache is used.
+     * With a cache, files which did not change since the cache was written are not validated and tokenised again, and
+     * the cache is rewritten by #load() whenever any file was added, changed or removed.
+     */
+    void setCacheFile(const QString& fileName);
+    QString cacheFile(void) const;
+    /**
+     * \brief loads everything, blocking until done.
+     */
+    UnitFileIndex load(void) const;
+    /**
+     * \brief a suitable location for the cache file of the current user, see #setCacheFile().
+     */
+    static QString defaultCacheFile(void);
+    /**
+     * \brief the search paths of the system manager, in order of precedence. See systemd.unit(5).
+     */
+    static QStringList systemSearchPaths(void);
+    /**
+     * \brief the search paths of the user manager for the current user, in order of precedence. See systemd.unit(5).
+     */
+    static QStringList userSearchPaths(void);
+    /**
+     * \brief whether a file name has the suffix of one of the unit types.
+     */
+    static bool isUnitName(const QString& fileName);
+    /**
+     * \brief whether a unit file is masked, i.e. is a symlink to /dev/null.
+     */
+    static bool isMasked(const QFileInfo& info);
+private:
+    QStringList m_searchPaths;
+    Tokeniser::LineEnding m_lineEnding;
+    int m_threads;
+    QString m_cacheFile;
+};
+
+#endif
@@ -0,0 +1,521 @@
+#include "unit_file_watcher.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSet>
+#include <QSocketNotifier>
+#include <QTimer>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+static const uint32_t watchMask = IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+static const QString dropInSuffix(QStringLiteral(".d"));
+static const QString dropInFileSuffix(QStringLiteral(".conf"));
+
+bool UnitFileDelta::isEmpty(void) const
+{
+    return added.isEmpty() && changed.isEmpty() && removed.isEmpty();
+}
+
+/*
+ * A watched directory: a search path, a drop-in directory in a search path, and/or the parent of search paths which do not exist (yet).
+ */
+struct WatchedDirectory
+{
+    QString path;
+    /*
+     * The index of the search path, or -1 if the directory is only watched for missing search paths to appear.
+     */
+    int priority;
+    /*
+     * For drop-in directories, the unit the drop-ins apply to.
+     */
+    QString unit;
+    /*
+     * The indices of the search paths inside this directory which do not exist.
+     */
+    QVector<int> missing;
+};
+
+class UnitFileWatcherPrivate
+{
+public:
+    UnitFileWatcherPrivate(const UnitFileLoader& loader, UnitFileWatcher * q) : q_ptr(q), m_loader(loader), m_fd(-1), m_notifier(0), m_delay(200), m_maxDelay(2000), m_overflow(false)
+    {
+        for(const QString& path: loader.searchPaths()) {
+            m_paths << QDir::cleanPath(path);
+        }
+        m_timer.setSingleShot(true);
+        QObject::connect(&m_timer, &QTimer::timeout, q, [this]() -> void {
+            flush();
+        });
+    }
+
+    ~UnitFileWatcherPrivate()
+    {
+        stop();
+    }
+
+    bool start(void)
+    {
+        Q_Q(UnitFileWatcher);
+        stop();
+        m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(m_fd >= 0) {
+            m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read);
+            QObject::connect(m_notifier, &QSocketNotifier::activated, q, [this]() -> void {
+                readEvents();
+            });
+            // watch before loading, so nothing which changes in the meantime is missed
+            for(int i = 0; i < m_paths.size(); ++i) {
+                watchSearchPath(i, false);
+            }
+        }
+        m_index = m_loader.load();
+        return m_fd >= 0;
+    }
+
+    void stop(void)
+    {
+        m_timer.stop();
+        m_pending.invalidate();
+        m_dirty.clear();
+        m_overflow = false;
+        m_watches.clear();
+        m_dirs.clear();
+        delete m_notifier;
+        m_notifier = 0;
+        if(m_fd >= 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    void readEvents(void)
+    {
+        alignas(struct inotify_event) char buffer[4096];
+        bool any = false;
+        forever {
+            const ssize_t size = ::read(m_fd, buffer, sizeof(buffer));
+            if(size <= 0) {
+                break;
+            }
+            for(ssize_t i = 0; i < size; ) {
+                const struct inotify_event * event = reinterpret_cast<const struct inotify_event *>(buffer + i);
+                handle(event);
+                i += sizeof(struct inotify_event) + event->len;
+            }
+            any = true;
+        }
+        if(any) {
+            schedule();
+        }
+    }
+
+    /*
+     * (Re)starts the timer for the current batch, unless the batch has already been waiting for the maximum delay.
+     */
+    void schedule(void)
+    {
+        if(!m_pending.isValid()) {
+            m_pending.start();
+        }
+        if(!m_timer.isActive() || m_pending.elapsed() + m_delay <= m_maxDelay) {
+            m_timer.start(m_delay);
+        }
+    }
+
+    void flush(void)
+    {
+        Q_Q(UnitFileWatcher);
+        m_pending.invalidate();
+        const UnitFileDelta delta = m_overflow ? reload() : reparse();
+        m_overflow = false;
+        m_dirty.clear();
+        if(!delta.isEmpty()) {
+            emit q->changed(delta);
+        }
+    }
+
+private:
+    int watch(const QString& path)
+    {
+        const int wd = inotify_add_watch(m_fd, QFile::encodeName(path).constData(), watchMask);
+        if(wd < 0) {
+            return -1;
+        }
+        if(!m_watches.contains(wd)) {
+            WatchedDirectory dir;
+            dir.path = path;
+            dir.priority = -1;
+            m_watches.insert(wd, dir);
+            m_dirs.insert(path, wd);
+        }
+        return wd;
+    }
+
+    /*
+     * Stops watching a directory which is gone, along with everything below it.
+     */
+    void forget(const QString& path)
+    {
+        const QString prefix = path + QLatin1Char('/');
+        QHash<QString, int>::iterator it = m_dirs.begin();
+        while(it != m_dirs.end()) {
+            if(it.key() == path || it.key().startsWith(prefix)) {
+                inotify_rm_watch(m_fd, it.value());
+                m_watches.remove(it.value());
+                it = m_dirs.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    static QFileInfoList list(const QString& path)
+    {
+        return QDir(path).entryInfoList(QDir::Files | QDir::Dirs | QDir::System | QDir::NoDotAndDotDot, QDir::NoSort);
+    }
+
+    /*
+     * Watches a search path and the drop-in directories in it. If scan is set, all files in it are queued to be read.
+     * A search path which does not exist is watched for from its parent directory instead.
+     */
+    void watchSearchPath(int index, bool scan)
+    {
+        const QString& path = m_paths.at(index);
+        if(!QFileInfo(path).isDir()) {
+            const QString parent = QFileInfo(path).path();
+            const int wd = QFileInfo(parent).isDir() ? watch(parent) : -1;
+            if(wd >= 0 && !m_watches[wd].missing.contains(index)) {
+                m_watches[wd].missing.append(index);
+            }
+            return;
+        }
+        const int wd = watch(path);
+        if(wd < 0) {
+            return;
+        }
+        m_watches[wd].priority = index;
+        m_watches[wd].unit.clear();
+        for(const QFileInfo& info: list(path)) {
+            const QString name = info.fileName();
+            if(info.isDir()) {
+                const QString unit = name.left(name.size() - dropInSuffix.size());
+                if(name.endsWith(dropInSuffix) && UnitFileLoader::isUnitName(unit)) {
+                    watchDropIns(info.filePath(), unit, index, scan);
+                }
+            }
+            else if(scan && UnitFileLoader::isUnitName(name)) {
+                m_dirty.insert(info.filePath());
+            }
+        }
+    }
+
+    void watchDropIns(const QString& path, const QString& unit, int priority, bool scan)
+    {
+        const int wd = watch(path);
+        if(wd < 0) {
+            return;
+        }
+        m_watches[wd].priority = priority;
+        m_watches[wd].unit = unit;
+        if(scan) {
+            for(const QFileInfo& info: list(path)) {
+                if(!info.isDir() && info.fileName().endsWith(dropInFileSuffix)) {
+                    m_dirty.insert(info.filePath());
+                }
+            }
+        }
+    }
+
+    /*
+     * Queues everything in the index below the given directory, which is gone. As the files no longer exist they are removed.
+     */
+    void markBelow(const QString& path)
+    {
+        const QString prefix = path + QLatin1Char('/');
+        for(const UnitFileEntry& entry: m_index.entries()) {
+            if(entry.path.startsWith(prefix)) {
+                m_dirty.insert(entry.path);
+            }
+        }
+    }
+
+    void handle(const struct inotify_event * event)
+    {
+        if(event->mask & IN_Q_OVERFLOW) {
+            m_overflow = true;
+            return;
+        }
+        if(!m_watches.contains(event->wd)) {
+            return;
+        }
+        // take a copy: watching other directories may modify m_watches
+        const WatchedDirectory dir = m_watches.value(event->wd);
+        if(event->mask & IN_IGNORED) {
+            m_watches.remove(event->wd);
+            m_dirs.remove(dir.path);
+            markBelow(dir.path);
+            if(dir.priority >= 0 && dir.unit.isEmpty()) {
+                // a search path which was removed may come back
+                watchSearchPath(dir.priority, false);
+            }
+            return;
+        }
+        const QString name = QFile::decodeName(event->name);
+        const QString path = dir.path + QLatin1Char('/') + name;
+        const bool appeared = event->mask & (IN_CREATE | IN_MOVED_TO);
+        const bool gone = event->mask & (IN_DELETE | IN_MOVED_FROM);
+        if(event->mask & IN_ISDIR) {
+            for(int i: dir.missing) {
+                if(appeared && m_paths.at(i) == path) {
+                    m_watches[event->wd].missing.removeAll(i);
+                    watchSearchPath(i, true);
+                }
+            }
+            if(dir.priority >= 0 && dir.unit.isEmpty() && name.endsWith(dropInSuffix)) {
+                const QString unit = name.left(name.size() - dropInSuffix.size());
+                if(!UnitFileLoader::isUnitName(unit)) {
+                    return;
+                }
+                if(appeared) {
+                    watchDropIns(path, unit, dir.priority, true);
+                }
+                else if(gone) {
+                    forget(path);
+                    markBelow(path);
+                }
+            }
+            return;
+        }
+        if(dir.priority >= 0 && (dir.unit.isEmpty() ? UnitFileLoader::isUnitName(name) : name.endsWith(dropInFileSuffix))) {
+            m_dirty.insert(path);
+        }
+    }
+
+    /*
+     * Reads the file at path as an entry of the directory it is in.
+     * Returns false if the file is not (or no longer) part of the index.
+     */
+    bool read(const QString& path, UnitFileEntry& entry) const
+    {
+        const int slash = path.lastIndexOf(QLatin1Char('/'));
+        const int wd = m_dirs.value(path.left(slash), -1);
+        if(wd < 0 || m_watches.value(wd).priority < 0) {
+            return false;
+        }
+        const WatchedDirectory dir = m_watches.value(wd);
+        const QFileInfo info(path);
+        if((!info.exists() && !info.isSymLink()) || info.isDir()) {
+            return false;
+        }
+        entry.path = path;
+        entry.priority = dir.priority;
+        if(dir.unit.isEmpty()) {
+            entry.unit = path.mid(slash + 1);
+            entry.kind = UnitFileLoader::isMasked(info) ? UnitFileEntry::Masked : UnitFileEntry::Unit;
+        }
+        else {
+            entry.unit = dir.unit;
+            entry.kind = UnitFileEntry::DropIn;
+        }
+        entry.stamp.inode = 0;
+        entry.stamp.size = entry.stamp.mtime = 0;
+        if(entry.kind != UnitFileEntry::Masked && FileStamp::read(path, entry.stamp)) {
+            entry.readContent(m_loader.lineEnding());
+        }
+        return true;
+    }
+
+    static bool differs(const UnitFileEntry& a, const UnitFileEntry& b)
+    {
+        return a.kind != b.kind || a.unit != b.unit || a.priority != b.priority || a.content != b.content;
+    }
+
+    static QStringList sorted(const QSet<QString>& units)
+    {
+        QStringList result = units.values();
+        result.sort();
+        return result;
+    }
+
+    /*
+     * Reads the files queued since the last batch, and updates the index.
+     */
+    UnitFileDelta reparse(void)
+    {
+        UnitFileDelta delta;
+        QSet<QString> units;
+        QHash<QString, int> byPath;
+        for(int i = 0; i < m_index.size(); ++i) {
+            byPath.insert(m_index.at(i).path, i);
+        }
+        QVector<UnitFileEntry> entries = m_index.entries();
+        QSet<int> removed;
+        for(const QString& path: m_dirty) {
+            const int old = byPath.value(path, -1);
+            UnitFileEntry entry;
+            if(!read(path, entry)) {
+                if(old >= 0) {
+                    removed.insert(old);
+                    delta.removed << path;
+                    units.insert(entries.at(old).unit);
+                }
+            }
+            else if(old < 0) {
+                delta.added << entry;
+                units.insert(entry.unit);
+            }
+            else {
+                if(differs(entries.at(old), entry)) {
+                    delta.changed << entry;
+                    units.insert(entries.at(old).unit);
+                    units.insert(entry.unit);
+                }
+                // even if nothing changed as far as anyone is concerned, the stamp may have
+                entries[old] = entry;
+            }
+        }
+        if(delta.isEmpty()) {
+            m_index.m_entries = entries;
+            return delta;
+        }
+        delta.removed.sort();
+        UnitFileIndex index;
+        index.m_entries.reserve(entries.size() + delta.added.size());
+        for(int i = 0; i < entries.size(); ++i) {
+            if(!removed.contains(i)) {
+                index.m_entries.append(entries.at(i));
+            }
+        }
+        index.m_entries += delta.added;
+        index.build();
+        m_index = index;
+        delta.units = sorted(units);
+        return delta;
+    }
+
+    /*
+     * Loads everything again after events were lost, working out the delta by comparing the old and the new index.
+     */
+    UnitFileDelta reload(void)
+    {
+        for(int i = 0; i < m_paths.size(); ++i) {
+            watchSearchPath(i, false);
+        }
+        const UnitFileIndex index = m_loader.load();
+        UnitFileDelta delta;
+        QSet<QString> units;
+        QHash<QString, int> byPath;
+        for(int i = 0; i < m_index.size(); ++i) {
+            byPath.insert(m_index.at(i).path, i);
+        }
+        for(const UnitFileEntry& entry: index.entries()) {
+            const QHash<QString, int>::iterator it = byPath.find(entry.path);
+            if(it == byPath.end()) {
+                delta.added << entry;
+                units.insert(entry.unit);
+            }
+            else {
+                const UnitFileEntry& old = m_index.at(it.value());
+                if(differs(old, entry)) {
+                    delta.changed << entry;
+                    units.insert(old.unit);
+                    units.insert(entry.unit);
+                }
+                byPath.erase(it);
+            }
+        }
+        for(QHash<QString, int>::const_iterator it = byPath.constBegin(); it != byPath.constEnd(); ++it) {
+            delta.removed << it.key();
+            units.insert(m_index.at(it.value()).unit);
+        }
+        delta.removed.sort();
+        delta.units = sorted(units);
+        m_index = index;
+        return delta;
+    }
+
+private:
+    UnitFileWatcher * const q_ptr;
+    Q_DECLARE_PUBLIC(UnitFileWatcher)
+
+public:
+    const UnitFileLoader m_loader;
+    QStringList m_paths;
+    UnitFileIndex m_index;
+    int m_fd;
+    QSocketNotifier * m_notifier;
+    QTimer m_timer;
+    QElapsedTimer m_pending;
+    int m_delay, m_maxDelay;
+    bool m_overflow;
+    QHash<int, WatchedDirectory> m_watches;
+    QHash<QString, int> m_dirs;
+    QSet<QString> m_dirty;
+};
+
+UnitFileWatcher::UnitFileWatcher(const UnitFileLoader& loader, QObject * parent) : QObject(parent), d_ptr(new UnitFileWatcherPrivate(loader, this))
+{
+    qRegisterMetaType<UnitFileDelta>();
+}
+
+UnitFileWatcher::~UnitFileWatcher()
+{
+    Q_D(UnitFileWatcher);
+    delete d;
+}
+
+void UnitFileWatcher::setDelay(int msec)
+{
+    Q_D(UnitFileWatcher);
+    d->m_delay = qMax(0, msec);
+}
+
+int UnitFileWatcher::delay(void) const
+{
+    Q_D(const UnitFileWatcher);
+    return d->m_delay;
+}
+
+void UnitFileWatcher::setMaximumDelay(int msec)
+{
+    Q_D(UnitFileWatcher);
+    d->m_maxDelay = qMax(0, msec);
+}
+
+int UnitFileWatcher::maximumDelay(void) const
+{
+    Q_D(const UnitFileWatcher);
+    return d->m_maxDelay;
+}
+
+bool UnitFileWatcher::start(void)
+{
+    Q_D(UnitFileWatcher);
+    return d->start();
+}
+
+void UnitFileWatcher::stop(void)
+{
+    Q_D(UnitFileWatcher);
+    d->stop();
+}
+
+bool UnitFileWatcher::isActive(void) const
+{
+    Q_D(const UnitFileWatcher);
+    return d->m_fd >= 0;
+}
+
+UnitFileIndex UnitFileWatcher::index(void) const
+{
+    Q_D(const UnitFileWatcher);
+    return d->m_index;
+}
@@ -0,0 +1,98 @@
+#ifndef SD_UIKIT_UNITFILE_WATCHER
+#define SD_UIKIT_UNITFILE_WATCHER
+
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "unit_file_index.h"
+#include "unit_file_loader.h"
+
+class UnitFileWatcherPrivate;
+
+/**
+ * \brief The changes made to the index of a UnitFileWatcher in one go.
+ */
+struct UnitFileDelta
+{
+    /**
+     * \brief entries for files which were not in the index before.
+     */
+    QVector<UnitFileEntry> added;
+    /**
+     * \brief the new entries for files whose contents changed, or which were masked or unmasked.
+     */
+    QVector<UnitFileEntry> changed;
+    /**
+     * \brief the paths of files which are no longer in the index, sorted.
+     */
+    QStringList removed;
+    /**
+     * \brief the names of all units affected by any of the above, sorted.
+     */
+    QStringList units;
+    bool isEmpty(void) const;
+};
+
+Q_DECLARE_METATYPE(UnitFileDelta)
+
+/**
+ * \brief Keeps a UnitFileIndex up to date as unit files and drop-ins are added, changed and removed, using inotify.
+ * The search paths and the drop-in directories in them are watched. Only files which changed are read and tokenised again.
+ *
+ * Events are not acted upon right away: changes tend to come in bursts (a package upgrade, a configuration management run) and
+ * these are coalesced into a single batch, which is processed once no further events arrive for #delay() milliseconds
+ * (or once the first event of the batch is #maximumDelay() milliseconds old, whichever comes first).
+ * Each batch is reported to observers as a UnitFileDelta, through the #changed(const UnitFileDelta&) signal.
+ *
+ * Should the kernel drop events (because its event queue overflowed) all files are loaded again, and the delta is worked out by comparing the old and the new index.
+ * Search paths which do not exist yet are picked up when they are created, provided their parent directory exists.
+ */
+class UnitFileWatcher: public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * \brief creates a watcher for the search paths of the given loader, which is also used to load the initial index.
+     */
+    UnitFileWatcher(const UnitFileLoader& loader, QObject * parent = 0);
+    virtual ~UnitFileWatcher();
+    /**
+     * \brief sets the time to wait for further events before processing a batch, in milliseconds. The default is 200.
+     */
+    void setDelay(int msec);
+    int delay(void) const;
+    /**
+     * \brief sets the maximum time a change may wait before its batch is processed, in milliseconds. The default is 2000.
+     */
+    void setMaximumDelay(int msec);
+    int maximumDelay(void) const;
+    /**
+     * \brief loads the index and starts watching for changes.
+     * \return false if inotify is not available, in which case the index is loaded but not kept up to date.
+     */
+    bool start(void);
+    /**
+     * \brief stops watching. Pending changes are discarded.
+     */
+    void stop(void);
+    bool isActive(void) const;
+    /**
+     * \brief the current index, which reflects all batches reported so far.
+     */
+    UnitFileIndex index(void) const;
+Q_SIGNALS:
+    /**
+     * \brief emitted after a batch of changes was applied to the index.
+     */
+    void changed(const UnitFileDelta& delta);
+private:
+    Q_DISABLE_COPY(UnitFileWatcher)
+
+    Q_DECLARE_PRIVATE(UnitFileWatcher)
+    UnitFileWatcherPrivate *const d_ptr;
+};
+
+#endif
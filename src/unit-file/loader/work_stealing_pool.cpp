@@ -0,0 +1,157 @@
+#include "work_stealing_pool.h"
+
+#include <deque>
+
+#include <QMutexLocker>
+#include <QThread>
+#include <QtAlgorithms>
+
+class WorkStealingQueue
+{
+public:
+    void push(const WorkStealingPool::Task& task)
+    {
+        QMutexLocker lock(&m_lock);
+        m_tasks.push_back(task);
+    }
+
+    bool popBack(WorkStealingPool::Task& task)
+    {
+        QMutexLocker lock(&m_lock);
+        if(m_tasks.empty()) {
+            return false;
+        }
+        task = m_tasks.back();
+        m_tasks.pop_back();
+        return true;
+    }
+
+    bool popFront(WorkStealingPool::Task& task)
+    {
+        QMutexLocker lock(&m_lock);
+        if(m_tasks.empty()) {
+            return false;
+        }
+        task = m_tasks.front();
+        m_tasks.pop_front();
+        return true;
+    }
+private:
+    QMutex m_lock;
+    std::deque<WorkStealingPool::Task> m_tasks;
+};
+
+class WorkStealingThread: public QThread
+{
+public:
+    WorkStealingThread(WorkStealingPool * pool, int worker) : m_pool(pool), m_worker(worker) {}
+protected:
+    void run(void) Q_DECL_OVERRIDE
+    {
+        m_pool->run(m_worker);
+    }
+private:
+    WorkStealingPool * const m_pool;
+    const int m_worker;
+};
+
+WorkStealingPool::WorkStealingPool(int threads) : m_queued(0), m_pending(0), m_next(0), m_stop(false)
+{
+    if(threads < 1) {
+        threads = qMax(1, QThread::idealThreadCount());
+    }
+    for(int i = 0; i < threads; ++i) {
+        m_queues.append(new WorkStealingQueue());
+    }
+    for(int i = 0; i < threads; ++i) {
+        WorkStealingThread * thread = new WorkStealingThread(this, i);
+        m_threads.append(thread);
+        thread->start();
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    waitForDone();
+    {
+        QMutexLocker lock(&m_lock);
+        m_stop = true;
+        m_wake.wakeAll();
+    }
+    for(WorkStealingThread * thread: m_threads) {
+        thread->wait();
+        delete thread;
+    }
+    qDeleteAll(m_queues);
+}
+
+int WorkStealingPool::threadCount(void) const
+{
+    return m_threads.size();
+}
+
+void WorkStealingPool::submit(const WorkStealingPool::Task& task)
+{
+    int worker = (m_next.fetchAndAddRelaxed(1) & 0x7FFFFFFF) % m_queues.size();
+    submit(worker, task);
+}
+
+void WorkStealingPool::submit(int worker, const WorkStealingPool::Task& task)
+{
+    m_pending.ref();
+    /*
+     * Counted before it is pushed, so a worker which takes the task straight away never drives m_queued below zero.
+     * Idle workers check m_queued while holding m_lock before they go to sleep, so waking them under the same lock cannot be missed.
+     * The queues are only read through at(), as a non-const QVector accessor may detach and is not safe to call from several threads.
+     */
+    m_queued.ref();
+    m_queues.at(worker)->push(task);
+    QMutexLocker lock(&m_lock);
+    m_wake.wakeOne();
+}
+
+void WorkStealingPool::waitForDone(void)
+{
+    QMutexLocker lock(&m_lock);
+    while(m_pending.load() > 0) {
+        m_done.wait(&m_lock);
+    }
+}
+
+bool WorkStealingPool::take(int worker, WorkStealingPool::Task& task)
+{
+    if(m_queues.at(worker)->popBack(task)) {
+        return true;
+    }
+    const int size = m_queues.size();
+    for(int i = 1; i < size; ++i) {
+        if(m_queues.at((worker + i) % size)->popFront(task)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(int worker)
+{
+    Task task;
+    forever {
+        if(take(worker, task)) {
+            m_queued.deref();
+            task(worker);
+            task = Task();
+            if(!m_pending.deref()) {
+                QMutexLocker lock(&m_lock);
+                m_done.wakeAll();
+            }
+            continue;
+        }
+        QMutexLocker lock(&m_lock);
+        while(m_queued.load() == 0 && !m_stop) {
+            m_wake.wait(&m_lock);
+        }
+        if(m_stop) {
+            return;
+        }
+    }
+}
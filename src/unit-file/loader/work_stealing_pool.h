@@ -0,0 +1,61 @@
+#ifndef SD_UIKIT_UNITFILE_WORK_STEALING_POOL
+#define SD_UIKIT_UNITFILE_WORK_STEALING_POOL
+
+#include <functional>
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QVector>
+#include <QWaitCondition>
+
+class WorkStealingQueue;
+class WorkStealingThread;
+
+/**
+ * \brief A fixed size thread pool in which each worker has a queue of its own.
+ * Tasks submitted by a running task go to the queue of the worker running it, and are taken from the back (most recent first).
+ * A worker which runs out of tasks steals from the front of the queues of other workers (oldest first).
+ * This keeps related work on one thread while still spreading the load evenly, which suits recursive work like walking a directory tree.
+ *
+ * Tasks are passed the index of the worker running them, so they can keep per worker results without any locking.
+ */
+class WorkStealingPool
+{
+public:
+    typedef std::function<void(int worker)> Task;
+    /**
+     * \param threads the number of worker threads. If less than 1, QThread::idealThreadCount() is used.
+     */
+    explicit WorkStealingPool(int threads = 0);
+    /**
+     * \brief waits for all tasks to finish, then stops the worker threads.
+     */
+    ~WorkStealingPool();
+    int threadCount(void) const;
+    /**
+     * \brief queues a task from outside the pool. Tasks are spread across the workers round-robin.
+     */
+    void submit(const Task& task);
+    /**
+     * \brief queues a task with the given worker, typically called by a task for follow up work.
+     */
+    void submit(int worker, const Task& task);
+    /**
+     * \brief blocks until all tasks submitted, including those submitted by other tasks, have run.
+     */
+    void waitForDone(void);
+private:
+    Q_DISABLE_COPY(WorkStealingPool)
+    friend class WorkStealingThread;
+    bool take(int worker, Task& task);
+    void run(int worker);
+private:
+    QVector<WorkStealingQueue *> m_queues;
+    QVector<WorkStealingThread *> m_threads;
+    QAtomicInt m_queued, m_pending, m_next;
+    QMutex m_lock;
+    QWaitCondition m_wake, m_done;
+    bool m_stop;
+};
+
+#endif
@@ -0,0 +1,162 @@
+#include "unit_file_merger.h"
+
+#include <QMutexLocker>
+
+bool EffectiveUnit::isValid(void) const
+{
+    return !sources.isEmpty();
+}
+
+QString EffectiveUnit::source(int entry) const
+{
+    return sources.at(origins.at(entry));
+}
+
+UnitFileMerger::UnitFileMerger(const UnitFileIndex& index, NameTable * names) : m_index(index), m_names(names) {}
+
+void UnitFileMerger::setIndex(const UnitFileIndex& index)
+{
+    QMutexLocker lock(&m_lock);
+    m_index = index;
+    m_cache.clear();
+}
+
+UnitFileIndex UnitFileMerger::index(void) const
+{
+    return m_index;
+}
+
+void UnitFileMerger::update(const UnitFileIndex& index, const QStringList& units)
+{
+    QMutexLocker lock(&m_lock);
+    m_index = index;
+    for(const QString& unit: units) {
+        m_cache.remove(unit);
+    }
+}
+
+EffectiveUnit UnitFileMerger::unit(const QString& name) const
+{
+    {
+        QMutexLocker lock(&m_lock);
+        const QHash<QString, EffectiveUnit>::const_iterator it = m_cache.constFind(name);
+        if(it != m_cache.constEnd()) {
+            return it.value();
+        }
+    }
+    // merge without holding the lock, so other threads are not held up. Should two threads merge the same unit, the results are the same.
+    const EffectiveUnit result = merge(m_index, name, m_names);
+    QMutexLocker lock(&m_lock);
+    m_cache.insert(name, result);
+    return result;
+}
+
+int UnitFileMerger::precompute(void)
+{
+    int merged = 0;
+    for(const QString& name: m_index.units()) {
+        {
+            QMutexLocker lock(&m_lock);
+            if(m_cache.contains(name)) {
+                continue;
+            }
+        }
+        const EffectiveUnit result = merge(m_index, name, m_names);
+        QMutexLocker lock(&m_lock);
+        m_cache.insert(name, result);
+        ++merged;
+    }
+    return merged;
+}
+
+int UnitFileMerger::cached(void) const
+{
+    QMutexLocker lock(&m_lock);
+    return m_cache.size();
+}
+
+static QString fileName(const QString& path)
+{
+    return path.mid(path.lastIndexOf(QLatin1Char('/')) + 1);
+}
+
+/*
+ * An assignment in one of the files, which is dropped (entry set to -1) if a later empty assignment resets its key.
+ */
+struct Assignment
+{
+    qint32 source;
+    qint32 entry;
+};
+
+static inline quint64 settingId(const UnitFile::Entry& entry)
+{
+    return ((quint64) (quint32) entry.section << 32) | (quint32) entry.key;
+}
+
+EffectiveUnit UnitFileMerger::merge(const UnitFileIndex& index, const QString& name, NameTable * names)
+{
+    EffectiveUnit result;
+    result.unit = name;
+    result.masked = false;
+    result.settings = UnitFile(names);
+
+    QVector<int> files;
+    const int unit = index.unit(name);
+    if(unit >= 0) {
+        if(index.at(unit).kind == UnitFileEntry::Masked) {
+            // drop-ins do not apply to a masked unit
+            result.masked = true;
+            result.sources << index.at(unit).path;
+            return result;
+        }
+        files << unit;
+    }
+    QString previous;
+    for(int dropIn: index.dropIns(name)) {
+        // drop-ins with the same name are sorted by priority, and the first one hides the others
+        const QString current = fileName(index.at(dropIn).path);
+        if(current != previous) {
+            files << dropIn;
+            previous = current;
+        }
+    }
+
+    QVector<UnitFile> models;
+    models.reserve(files.size());
+    QVector<Assignment> assignments;
+    // the assignments still in effect for each section and key
+    QHash<quint64, QVector<int> > live;
+    for(int source = 0; source < files.size(); ++source) {
+        const UnitFileEntry& entry = index.at(files.at(source));
+        result.sources << entry.path;
+        models.append(UnitFile::fromTokens(entry.content, entry.tokens, !entry.invalidBytes.isEmpty(), names));
+        const UnitFile& model = models.last();
+        for(int i = 0; i < model.size(); ++i) {
+            QVector<int>& previousAssignments = live[settingId(model.at(i))];
+            if(model.at(i).valueLength) {
+                previousAssignments.append(assignments.size());
+                assignments.append(Assignment { source, i });
+            }
+            else {
+                for(int reset: previousAssignments) {
+                    assignments[reset].entry = -1;
+                }
+                previousAssignments.clear();
+            }
+        }
+    }
+
+    UnitFileBuilder builder(names);
+    for(const Assignment& assignment: assignments) {
+        if(assignment.entry < 0) {
+            continue;
+        }
+        const UnitFile& model = models.at(assignment.source);
+        const UnitFile::Entry& entry = model.at(assignment.entry);
+        builder.assign(entry.section, entry.key, model.rawValue(assignment.entry), entry.line);
+        result.origins.append(assignment.source);
+    }
+    result.settings = builder.build();
+    return result;
+}
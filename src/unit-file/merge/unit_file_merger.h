@@ -0,0 +1,100 @@
+#ifndef SD_UIKIT_UNITFILE_MERGER
+#define SD_UIKIT_UNITFILE_MERGER
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "../loader/unit_file_index.h"
+#include "../model/name_table.h"
+#include "../model/unit_file.h"
+
+/**
+ * \brief The effective configuration of a unit: its unit file with all of its drop-ins applied.
+ */
+struct EffectiveUnit
+{
+    QString unit;
+    /**
+     * \brief whether the unit is masked, in which case there are no settings.
+     */
+    bool masked;
+    /**
+     * \brief the paths of the files which make up the configuration: the unit file, followed by the drop-ins in the order they were applied.
+     */
+    QStringList sources;
+    /**
+     * \brief the merged settings, in the order they were applied. Assignments which were reset by an empty assignment are left out, as are the empty assignments themselves.
+     */
+    UnitFile settings;
+    /**
+     * \brief for each entry of #settings, the index of its file in #sources.
+     */
+    QVector<qint32> origins;
+    /**
+     * \brief whether a unit file or drop-in was found for the unit at all.
+     */
+    bool isValid(void) const;
+    /**
+     * \brief the path of the file an entry of #settings comes from.
+     */
+    QString source(int entry) const;
+};
+
+/**
+ * \brief Works out the effective configuration of units from a UnitFileIndex, and caches it.
+ *
+ * The configuration of a unit is made up of the unit file found in the first search path that has one (a unit file in /etc replaces the one
+ * in /usr/lib as a whole), followed by all drop-ins for the unit in order of their file name. Of drop-ins with the same file name, only the one
+ * in the first search path is used. Assignments accumulate, and an empty assignment (e.g. ExecStart=) resets everything assigned to the same
+ * key before it, as systemd does. For settings which take a single value, UnitFile::value(const QString&, const QString&) then yields the
+ * effective value; for lists UnitFile::values(const QString&, const QString&) does.
+ *
+ * Each unit is merged once, on first use or through #precompute(), and then served from the cache. When files change only the affected units
+ * need to be merged again, which #update() takes care of; it fits the UnitFileWatcher::changed(const UnitFileDelta&) signal:
+ *
+ *     QObject::connect(&watcher, &UnitFileWatcher::changed, [&merger, &watcher](const UnitFileDelta& delta) { merger.update(watcher.index(), delta.units); });
+ *
+ * #unit() may be called from any number of threads at once, but not at the same time as #setIndex() or #update().
+ */
+class UnitFileMerger
+{
+public:
+    UnitFileMerger(const UnitFileIndex& index = UnitFileIndex(), NameTable * names = NameTable::global());
+    /**
+     * \brief replaces the index, dropping all cached configuration.
+     */
+    void setIndex(const UnitFileIndex& index);
+    UnitFileIndex index(void) const;
+    /**
+     * \brief replaces the index with one in which only files of the given units changed, dropping the cached configuration of only those units.
+     */
+    void update(const UnitFileIndex& index, const QStringList& units);
+    /**
+     * \brief the effective configuration of the unit, merging it if it is not cached yet.
+     */
+    EffectiveUnit unit(const QString& name) const;
+    /**
+     * \brief merges all units in the index which are not cached yet.
+     * \return the number of units merged.
+     */
+    int precompute(void);
+    /**
+     * \brief the number of units for which the configuration is cached.
+     */
+    int cached(void) const;
+    /**
+     * \brief works out the effective configuration of a unit, without any caching.
+     */
+    static EffectiveUnit merge(const UnitFileIndex& index, const QString& name, NameTable * names = NameTable::global());
+private:
+    Q_DISABLE_COPY(UnitFileMerger)
+    UnitFileIndex m_index;
+    NameTable * m_names;
+    mutable QMutex m_lock;
+    mutable QHash<QString, EffectiveUnit> m_cache;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#include "name_table.h"
+
+#include <QReadLocker>
+#include <QWriteLocker>
+
+Q_GLOBAL_STATIC(NameTable, globalNameTable)
+
+NameTable::NameTable() {}
+
+int NameTable::intern(const QByteArray& name)
+{
+    {
+        QReadLocker lock(&m_lock);
+        const QHash<QByteArray, int>::const_iterator it = m_ids.constFind(name);
+        if(it != m_ids.constEnd()) {
+            return it.value();
+        }
+    }
+    QWriteLocker lock(&m_lock);
+    // another thread may have added the name in the meantime
+    const QHash<QByteArray, int>::const_iterator it = m_ids.constFind(name);
+    if(it != m_ids.constEnd()) {
+        return it.value();
+    }
+    const int id = m_names.size();
+    // the name may well be a view on someone else's buffer (see QByteArray::fromRawData), so take a copy of its own
+    m_ids.insert(QByteArray(name.constData(), name.size()), id);
+    m_names.append(QString::fromUtf8(name));
+    return id;
+}
+
+int NameTable::intern(const QString& name)
+{
+    return intern(name.toUtf8());
+}
+
+int NameTable::find(const QByteArray& name) const
+{
+    QReadLocker lock(&m_lock);
+    return m_ids.value(name, Invalid);
+}
+
+int NameTable::find(const QString& name) const
+{
+    return find(name.toUtf8());
+}
+
+QString NameTable::name(int id) const
+{
+    QReadLocker lock(&m_lock);
+    return id >= 0 && id < m_names.size() ? m_names.at(id) : QString();
+}
+
+int NameTable::size(void) const
+{
+    QReadLocker lock(&m_lock);
+    return m_names.size();
+}
+
+NameTable * NameTable::global(void)
+{
+    return globalNameTable();
+}
@@ -0,0 +1,51 @@
+#ifndef SD_UIKIT_UNITFILE_NAME_TABLE
+#define SD_UIKIT_UNITFILE_NAME_TABLE
+
+#include <QByteArray>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+
+/**
+ * \brief Interns the names of sections and keys found in unit files.
+ * The same few hundred names (Unit, Service, ExecStart, Restart, WantedBy ...) recur in just about every unit file.
+ * Interning stores each distinct name once, and lets UnitFile refer to names by a small integer id which is cheap to store, hash and compare.
+ *
+ * Ids are never reused or invalidated: a table only grows. All methods are thread safe, so files may be parsed on different threads using the same table.
+ */
+class NameTable
+{
+public:
+    enum {
+        Invalid = -1
+    };
+    NameTable();
+    /**
+     * \brief the id of the given name (UTF-8), adding it to the table if it was not known yet.
+     */
+    int intern(const QByteArray& name);
+    int intern(const QString& name);
+    /**
+     * \brief the id of the given name (UTF-8), without adding it.
+     * \return the id or #Invalid if the name is not in the table, in which case no unit file using this table contains it.
+     */
+    int find(const QByteArray& name) const;
+    int find(const QString& name) const;
+    /**
+     * \brief the name for an id returned by #intern(const QByteArray&), or a null string if there is no such id.
+     */
+    QString name(int id) const;
+    int size(void) const;
+    /**
+     * \brief the table shared by default by all unit files.
+     */
+    static NameTable * global(void);
+private:
+    Q_DISABLE_COPY(NameTable)
+    mutable QReadWriteLock m_lock;
+    QHash<QByteArray, int> m_ids;
+    QVector<QString> m_names;
+};
+
+#endif
@@ -0,0 +1,316 @@
+#include "unit_file.h"
+#include "../parser/tokeniser.h"
+
+/*
+ * Section and key ids are small integers, so mix them up a bit to spread them over the hash table.
+ */
+static inline quint32 hashIds(int section, int key)
+{
+    return ((quint32) section * 0x9E3779B1u) ^ ((quint32) key * 0x85EBCA77u);
+}
+
+UnitFile::UnitFile(NameTable * names) : m_names(names) {}
+
+UnitFile UnitFile::fromTokens(const QByteArray& utf8, const QVector<TokenSpan>& tokens, bool skipInvalid, NameTable * names)
+{
+    UnitFileBuilder builder(names);
+    for(const TokenSpan& token: tokens) {
+        builder.add(token, utf8.constData(), skipInvalid);
+    }
+    return builder.build();
+}
+
+NameTable * UnitFile::names(void) const
+{
+    return m_names;
+}
+
+int UnitFile::size(void) const
+{
+    return m_entries.size();
+}
+
+bool UnitFile::isEmpty(void) const
+{
+    return m_entries.isEmpty();
+}
+
+const UnitFile::Entry& UnitFile::at(int entry) const
+{
+    return m_entries.at(entry);
+}
+
+const QVector<qint32>& UnitFile::sections(void) const
+{
+    return m_sections;
+}
+
+/*
+ * Linear probing: the table is at least twice the size of the number of entries, so probe sequences are short.
+ */
+int UnitFile::slot(int section, int key) const
+{
+    const int mask = m_slots.size() - 1;
+    int i = (int) (hashIds(section, key) & mask);
+    forever {
+        const int entry = m_slots.at(i);
+        if(entry < 0 || (m_entries.at(entry).section == section && m_entries.at(entry).key == key)) {
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+int UnitFile::find(int section, int key) const
+{
+    if(m_slots.isEmpty() || section < 0 || key < 0) {
+        return -1;
+    }
+    return m_slots.at(slot(section, key));
+}
+
+int UnitFile::find(const QString& section, const QString& key) const
+{
+    return find(m_names->find(section), m_names->find(key));
+}
+
+QString UnitFile::value(const QString& section, const QString& key) const
+{
+    int entry = find(section, key);
+    if(entry < 0) {
+        return QString();
+    }
+    while(m_entries.at(entry).next >= 0) {
+        entry = m_entries.at(entry).next;
+    }
+    return value(entry);
+}
+
+QStringList UnitFile::values(const QString& section, const QString& key) const
+{
+    QStringList result;
+    for(int entry = find(section, key); entry >= 0; entry = m_entries.at(entry).next) {
+        result << value(entry);
+    }
+    return result;
+}
+
+QString UnitFile::value(int entry) const
+{
+    const Entry& e = m_entries.at(entry);
+    return QString::fromUtf8(m_values.constData() + e.valueOffset, (int) e.valueLength);
+}
+
+QByteArray UnitFile::rawValue(int entry) const
+{
+    const Entry& e = m_entries.at(entry);
+    return QByteArray::fromRawData(m_values.constData() + e.valueOffset, (int) e.valueLength);
+}
+
+QString UnitFile::section(int entry) const
+{
+    return m_names->name(m_entries.at(entry).section);
+}
+
+QString UnitFile::key(int entry) const
+{
+    return m_names->name(m_entries.at(entry).key);
+}
+
+qint64 UnitFile::footprint(void) const
+{
+    return sizeof(UnitFile) +
+        (qint64) m_entries.capacity() * sizeof(Entry) +
+        (qint64) (m_sections.capacity() + m_slots.capacity()) * sizeof(qint32) +
+        m_values.capacity();
+}
+
+UnitFileBuilder::UnitFileBuilder(NameTable * names) : m_file(names), m_section(-1), m_key(-1), m_keyLine(0), m_open(false) {}
+
+void UnitFileBuilder::add(const TokenSpan& token, const char * utf8, bool skipInvalid)
+{
+    if(skipInvalid && !(token.flags & TokenSpan::Synthetic)) {
+        // leaving out invalid bytes takes a copy anyway, so go through the text
+        const QByteArray text = Tokeniser::text(QByteArray::fromRawData(utf8, (int) (token.offset + token.length)), token).toUtf8();
+        TokenSpan copy = token;
+        copy.offset = 0;
+        copy.length = (quint32) text.size();
+        copy.flags &= ~TokenSpan::Continued;
+        add(copy, text.constData(), false);
+        return;
+    }
+    switch(token.kind) {
+        case TokenSpan::Section:
+            section(QByteArray::fromRawData(utf8 + token.offset, (int) token.length));
+            break;
+        case TokenSpan::Key:
+            key(QByteArray::fromRawData(utf8 + token.offset, (int) token.length), token.line);
+            break;
+        case TokenSpan::Space:
+            space(token.hint);
+            break;
+        case TokenSpan::Value:
+            if(token.flags & TokenSpan::EmptyValue) {
+                value(0, 0, false);
+            }
+            else {
+                value(utf8 + token.offset, (int) token.length, token.flags & TokenSpan::Continued);
+            }
+            break;
+        case TokenSpan::SyntaxError:
+            error();
+            break;
+        default:
+            break;
+    }
+}
+
+void UnitFileBuilder::add(const Token& token)
+{
+    switch(token.kind()) {
+        case TokenSpan::Section:
+            section(token.toString().toUtf8());
+            break;
+        case TokenSpan::Key:
+            key(token.toString().toUtf8(), token.line());
+            break;
+        case TokenSpan::Space:
+            space(token.hint());
+            break;
+        case TokenSpan::Value:
+            if(token.isEmptyValue()) {
+                value(0, 0, false);
+            }
+            else {
+                const QByteArray text = token.toString().toUtf8();
+                value(text.constData(), text.size(), false);
+            }
+            break;
+        case TokenSpan::SyntaxError:
+            error();
+            break;
+        default:
+            break;
+    }
+}
+
+void UnitFileBuilder::assign(int section, int key, const QByteArray& value, int line)
+{
+    m_section = section;
+    m_key = key;
+    m_keyLine = line;
+    m_open = false;
+    if(!m_file.m_sections.contains(m_section)) {
+        m_file.m_sections.append(m_section);
+    }
+    open();
+    this->value(value.constData(), value.size(), false);
+}
+
+void UnitFileBuilder::section(const QByteArray& name)
+{
+    m_section = m_file.m_names->intern(name);
+    m_key = -1;
+    m_open = false;
+    if(!m_file.m_sections.contains(m_section)) {
+        m_file.m_sections.append(m_section);
+    }
+}
+
+void UnitFileBuilder::key(const QByteArray& name, int line)
+{
+    // whitespace between the key and the '=' is part of the Key token
+    int size = name.size();
+    while(size > 0 && (name.at(size - 1) == ' ' || name.at(size - 1) == '\t')) {
+        --size;
+    }
+    m_key = m_file.m_names->intern(QByteArray::fromRawData(name.constData(), size));
+    m_keyLine = line;
+    m_open = false;
+}
+
+/*
+ * A syntax error anywhere before the value means the line is not a valid assignment.
+ */
+void UnitFileBuilder::error(void)
+{
+    m_key = -1;
+    m_open = false;
+}
+
+/*
+ * Whitespace after the '=' means the key has a value, even if it turns out to be empty.
+ */
+void UnitFileBuilder::space(int hint)
+{
+    if(Tokeniser::getToken(hint) == Tokeniser::Value) {
+        open();
+    }
+}
+
+void UnitFileBuilder::value(const char * text, int size, bool continued)
+{
+    open();
+    if(!m_open) {
+        return;
+    }
+    if(!size) {
+        return;
+    }
+    m_file.m_values.append(text, size);
+    if(continued) {
+        m_file.m_values[m_file.m_values.size() - 1] = ' ';
+    }
+    m_file.m_entries.last().valueLength += (quint32) size;
+}
+
+/*
+ * Starts a new entry for the current key, unless that has already been done (values continued over several lines are reported as multiple tokens).
+ */
+void UnitFileBuilder::open(void)
+{
+    if(m_open || m_key < 0 || m_section < 0) {
+        return;
+    }
+    UnitFile::Entry entry;
+    entry.section = m_section;
+    entry.key = m_key;
+    entry.next = -1;
+    entry.line = m_keyLine;
+    entry.valueOffset = (quint32) m_file.m_values.size();
+    entry.valueLength = 0;
+    m_file.m_entries.append(entry);
+    m_open = true;
+}
+
+UnitFile UnitFileBuilder::build(void)
+{
+    UnitFile& file = m_file;
+    int tableSize = 8;
+    while(tableSize < file.m_entries.size() * 2) {
+        tableSize *= 2;
+    }
+    file.m_slots.fill(-1, tableSize);
+    // the last entry found so far for each slot, to chain repeated assignments in file order
+    QVector<qint32> last(tableSize, -1);
+    for(int i = 0; i < file.m_entries.size(); ++i) {
+        const int s = file.slot(file.m_entries.at(i).section, file.m_entries.at(i).key);
+        if(file.m_slots.at(s) < 0) {
+            file.m_slots[s] = i;
+        }
+        else {
+            file.m_entries[last.at(s)].next = i;
+        }
+        last[s] = i;
+    }
+    file.m_entries.squeeze();
+    file.m_sections.squeeze();
+    file.m_values.squeeze();
+
+    UnitFile result = file;
+    m_file = UnitFile(file.m_names);
+    m_section = m_key = -1;
+    m_keyLine = 0;
+    m_open = false;
+    return result;
+}
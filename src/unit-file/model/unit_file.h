@@ -0,0 +1,145 @@
+#ifndef SD_UIKIT_UNITFILE_UNIT_FILE
+#define SD_UIKIT_UNITFILE_UNIT_FILE
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "../parser/token.h"
+#include "name_table.h"
+
+/**
+ * \brief A compact, read-only model of the settings in a unit file (or drop-in).
+ * Section and key names are interned in a NameTable and referred to by id. Everything else is kept in a few flat arrays:
+ *  - one Entry record per assignment, in file order;
+ *  - a single UTF-8 buffer holding all values;
+ *  - an open addressing hash table from (section, key) to the first matching entry, so settings are looked up in constant time.
+ *
+ * Assignments which occur more than once (e.g. ExecStartPre= or a [Service] section which is split in two) are chained in file order.
+ * Assignments outside of any section and keys which are not followed by a value (i.e. which have a syntax error) are left out, as systemd would ignore them.
+ *
+ * UnitFile is built by UnitFileBuilder. It is implicitly shared: copies are cheap and may be read from any thread.
+ */
+class UnitFile
+{
+public:
+    /**
+     * \brief a single assignment: key=value.
+     */
+    struct Entry {
+        qint32 section;
+        qint32 key;
+        /**
+         * \brief the entry with the same section and key which comes next in the file, or -1.
+         */
+        qint32 next;
+        /**
+         * \brief the line of the key.
+         */
+        qint32 line;
+        quint32 valueOffset;
+        quint32 valueLength;
+    };
+
+    UnitFile(NameTable * names = NameTable::global());
+    /**
+     * \brief builds a model from the output of Tokeniser::tokenise(const QByteArray&, const Tokeniser::LineEnding&, QVector<ByteRange>*).
+     * \param skipInvalid whether utf8 contains invalid bytes, which must be left out of values.
+     */
+    static UnitFile fromTokens(const QByteArray& utf8, const QVector<TokenSpan>& tokens, bool skipInvalid = false, NameTable * names = NameTable::global());
+    NameTable * names(void) const;
+    /**
+     * \brief the number of assignments.
+     */
+    int size(void) const;
+    bool isEmpty(void) const;
+    const Entry& at(int entry) const;
+    /**
+     * \brief the ids of the sections with at least one assignment, in order of first appearance.
+     */
+    const QVector<qint32>& sections(void) const;
+    /**
+     * \brief the first entry for the given section and key (by id).
+     * \return the index of the entry, or -1 if the setting is not present.
+     */
+    int find(int section, int key) const;
+    int find(const QString& section, const QString& key) const;
+    /**
+     * \brief the value of the setting: if it is assigned more than once, the last assignment wins. A null string is returned if the setting is not present.
+     */
+    QString value(const QString& section, const QString& key) const;
+    /**
+     * \brief all values assigned to the setting, in file order.
+     */
+    QStringList values(const QString& section, const QString& key) const;
+    QString value(int entry) const;
+    /**
+     * \brief the UTF-8 encoded value of an entry, without copying it. Only valid as long as this UnitFile (or a copy of it) is.
+     */
+    QByteArray rawValue(int entry) const;
+    QString section(int entry) const;
+    QString key(int entry) const;
+    /**
+     * \brief the approximate number of bytes of memory used by the model, not counting the NameTable.
+     */
+    qint64 footprint(void) const;
+private:
+    friend class UnitFileBuilder;
+    int slot(int section, int key) const;
+private:
+    NameTable * m_names;
+    QVector<Entry> m_entries;
+    QVector<qint32> m_sections;
+    QVector<qint32> m_slots;
+    QByteArray m_values;
+};
+
+Q_DECLARE_TYPEINFO(UnitFile::Entry, Q_PRIMITIVE_TYPE);
+
+/**
+ * \brief Builds a UnitFile from tokens, as they are found by the Tokeniser.
+ * The builder may be fed from the output of Tokeniser::tokenise(), or from the Tokeniser::token(const Token&) signal using a direct connection:
+ *
+ *     UnitFileBuilder builder;
+ *     QObject::connect(&tokeniser, &Tokeniser::token, [&builder](const Token& token) { builder.add(token); });
+ */
+class UnitFileBuilder
+{
+public:
+    UnitFileBuilder(NameTable * names = NameTable::global());
+    /**
+     * \brief adds a token, reading its text from the source.
+     * \param utf8 the UTF-8 source the token was found in.
+     * \param skipInvalid whether the source contains invalid bytes, which must be left out.
+     */
+    void add(const TokenSpan& token, const char * utf8, bool skipInvalid = false);
+    /**
+     * \brief adds a token reported by the Tokeniser::token(const Token&) signal.
+     */
+    void add(const Token& token);
+    /**
+     * \brief adds an assignment by section and key id, e.g. one taken from another UnitFile which uses the same NameTable.
+     * \param line the line of the key, in whichever file the assignment was found.
+     */
+    void assign(int section, int key, const QByteArray& value, int line);
+    /**
+     * \brief finishes the model and resets the builder, so it may be used for another file.
+     */
+    UnitFile build(void);
+private:
+    void section(const QByteArray& name);
+    void key(const QByteArray& name, int line);
+    void space(int hint);
+    void value(const char * text, int size, bool continued);
+    void open(void);
+    void error(void);
+private:
+    UnitFile m_file;
+    qint32 m_section;
+    qint32 m_key;
+    qint32 m_keyLine;
+    bool m_open;
+};
+
+#endif
@@ -0,0 +1,290 @@
+#include "incremental_tokeniser.h"
+#include "tokeniser_p.h"
+
+typedef IncrementalTokeniser::Line Line;
+
+/*
+ * Tokenises a run of logical lines, splitting the tokens (and invalid bytes) found by line and making them relative to the start of their line.
+ * The text fed must start at the beginning of a logical line, which means the engine can start afresh.
+ */
+class LineCollector: public TokenSink, public UTF8Validator::Sink
+{
+public:
+    LineCollector(const Tokeniser::LineEnding& nl) : m_engine(nl, this), m_validator(UTF8Validator::Vectorised), m_lineStart(0), m_firstLine(1), m_line(1)
+    {
+        m_current.lineBreaks = 0;
+    }
+
+    void feed(const QByteArray& data)
+    {
+        m_text.append(data);
+        m_validator.feed(data.constData(), data.size(), *this);
+    }
+
+    /*
+     * Whether the text fed so far ends with a complete logical line, so that the lines which follow need not be tokenised again.
+     */
+    bool atLineStart(void) const
+    {
+        return m_lineStart == m_validator.offset();
+    }
+
+    /*
+     * Signals the end of the document: whatever follows the last line break is the last line.
+     */
+    void finish(void)
+    {
+        m_validator.finish(*this);
+        m_engine.finish();
+        m_current.text = m_text.mid((int) m_lineStart);
+        m_lines.append(m_current);
+    }
+
+    const QVector<Line>& lines(void) const
+    {
+        return m_lines;
+    }
+
+    void valid(const char * data, qint64 length, qint64 offset) Q_DECL_OVERRIDE
+    {
+        m_engine.pushUTF8(data, length, offset);
+    }
+
+    void invalid(const char *, qint64 length, qint64 offset) Q_DECL_OVERRIDE
+    {
+        QVector<ByteRange>& invalid = m_current.invalid;
+        if(!invalid.isEmpty() && invalid.last().offset + invalid.last().length == (quint64) (offset - m_lineStart)) {
+            invalid.last().length += (quint32) length;
+            return;
+        }
+        ByteRange range;
+        range.offset = (quint32) (offset - m_lineStart);
+        range.length = (quint32) length;
+        invalid.append(range);
+    }
+
+    void token(const TokenSpan& token) Q_DECL_OVERRIDE
+    {
+        TokenSpan relative = token;
+        relative.offset = (quint32) (token.offset - m_lineStart);
+        relative.line = token.line - m_firstLine;
+        m_current.tokens.append(relative);
+    }
+
+    void newLine(qint64 offset, bool continued) Q_DECL_OVERRIDE
+    {
+        m_line ++;
+        m_current.lineBreaks ++;
+        if(!continued) {
+            m_current.text = m_text.mid((int) m_lineStart, (int) (offset - m_lineStart));
+            m_lines.append(m_current);
+            m_current = Line();
+            m_current.lineBreaks = 0;
+            m_lineStart = offset;
+            m_firstLine = m_line;
+        }
+    }
+
+private:
+    TokeniserEngine m_engine;
+    UTF8Validator m_validator;
+    QByteArray m_text;
+    QVector<Line> m_lines;
+    Line m_current;
+    qint64 m_lineStart;
+    int m_firstLine, m_line;
+};
+
+IncrementalTokeniser::IncrementalTokeniser(const Tokeniser::LineEnding& lineEnding) : m_lineEnding(lineEnding), m_size(0), m_cursor(0), m_cursorOffset(0), m_cursorLine(1)
+{
+    setText(QByteArray());
+}
+
+void IncrementalTokeniser::setText(const QByteArray& utf8)
+{
+    LineCollector collector(m_lineEnding);
+    collector.feed(utf8);
+    collector.finish();
+    m_lines = collector.lines();
+    m_size = utf8.size();
+    m_cursor = 0;
+    m_cursorOffset = 0;
+    m_cursorLine = 1;
+}
+
+IncrementalTokeniser::Change IncrementalTokeniser::edit(qint64 offset, qint64 length, const QByteArray& replacement)
+{
+    offset = qBound(Q_INT64_C(0), offset, m_size);
+    length = qBound(Q_INT64_C(0), length, m_size - offset);
+
+    // the last line affected is the one the edit ends in: if that is at the very start of a line, removing the preceding line break joins it to the edit
+    seekOffset(offset + length);
+    const int last = m_cursor;
+    seekOffset(offset);
+    const int first = m_cursor;
+
+    QByteArray affected;
+    for(int i = first; i <= last; ++i) {
+        affected.append(m_lines.at(i).text);
+    }
+    const int at = (int) (offset - m_cursorOffset);
+    affected.replace(at, (int) length, replacement);
+
+    /*
+     * Lines after the edit are only taken along if the edit left the last logical line open, e.g. by removing its line break.
+     * Once the text tokenised ends at the start of a logical line the tokeniser is back in its initial state, so the lines which follow are unaffected.
+     */
+    LineCollector collector(m_lineEnding);
+    collector.feed(affected);
+    int end = last + 1;
+    while(end < m_lines.size() && !collector.atLineStart()) {
+        collector.feed(m_lines.at(end).text);
+        end ++;
+    }
+    // the last line of the document is the only one without a line break of its own, so it is always tokenised up to the end
+    if(end == m_lines.size()) {
+        collector.finish();
+    }
+
+    const QVector<Line>& lines = collector.lines();
+    Change change;
+    change.firstLine = first;
+    change.removedLines = end - first;
+    change.insertedLines = lines.size();
+
+    const int common = qMin(change.removedLines, change.insertedLines);
+    for(int i = 0; i < common; ++i) {
+        m_lines[first + i] = lines.at(i);
+    }
+    if(change.removedLines > common) {
+        m_lines.remove(first + common, change.removedLines - common);
+    }
+    else if(change.insertedLines > common) {
+        m_lines.insert(first + common, change.insertedLines - common, Line());
+        for(int i = common; i < change.insertedLines; ++i) {
+            m_lines[first + i] = lines.at(i);
+        }
+    }
+    m_size += replacement.size() - length;
+    // the cursor is still on the first line affected, which starts at the same offset and physical line as before
+    return change;
+}
+
+QByteArray IncrementalTokeniser::text(void) const
+{
+    QByteArray result;
+    result.reserve((int) m_size);
+    for(const Line& line: m_lines) {
+        result.append(line.text);
+    }
+    return result;
+}
+
+qint64 IncrementalTokeniser::size(void) const
+{
+    return m_size;
+}
+
+int IncrementalTokeniser::lineCount(void) const
+{
+    return m_lines.size();
+}
+
+int IncrementalTokeniser::lineAt(qint64 offset) const
+{
+    seekOffset(offset);
+    return m_cursor;
+}
+
+qint64 IncrementalTokeniser::lineOffset(int line) const
+{
+    seek(line);
+    return m_cursorOffset;
+}
+
+QByteArray IncrementalTokeniser::lineText(int line) const
+{
+    return m_lines.at(line).text;
+}
+
+QVector<TokenSpan> IncrementalTokeniser::lineTokens(int line) const
+{
+    seek(line);
+    QVector<TokenSpan> result = m_lines.at(line).tokens;
+    for(TokenSpan& token: result) {
+        token.offset += (quint32) m_cursorOffset;
+        token.line += m_cursorLine;
+    }
+    return result;
+}
+
+QVector<TokenSpan> IncrementalTokeniser::tokens(void) const
+{
+    QVector<TokenSpan> result;
+    qint64 offset = 0;
+    int physical = 1;
+    for(const Line& line: m_lines) {
+        for(TokenSpan token: line.tokens) {
+            token.offset += (quint32) offset;
+            token.line += physical;
+            result.append(token);
+        }
+        offset += line.text.size();
+        physical += line.lineBreaks;
+    }
+    return result;
+}
+
+QVector<ByteRange> IncrementalTokeniser::invalidBytes(void) const
+{
+    QVector<ByteRange> result;
+    qint64 offset = 0;
+    for(const Line& line: m_lines) {
+        for(ByteRange range: line.invalid) {
+            range.offset += (quint32) offset;
+            result.append(range);
+        }
+        offset += line.text.size();
+    }
+    return result;
+}
+
+QString IncrementalTokeniser::tokenText(const TokenSpan& token) const
+{
+    if(token.flags & TokenSpan::Synthetic) {
+        return QString(QLatin1Char(token.literal));
+    }
+    seekOffset(token.offset);
+    const Line& line = m_lines.at(m_cursor);
+    TokenSpan relative = token;
+    relative.offset -= (quint32) m_cursorOffset;
+    return tokenTextUTF8(line.text.constData(), relative, !line.invalid.isEmpty());
+}
+
+/*
+ * Lines are found by walking from the cursor, so looking up lines close to the previous one (as an editor does) stays cheap.
+ */
+void IncrementalTokeniser::seek(int line) const
+{
+    line = qBound(0, line, m_lines.size() - 1);
+    while(m_cursor < line) {
+        m_cursorOffset += m_lines.at(m_cursor).text.size();
+        m_cursorLine += m_lines.at(m_cursor).lineBreaks;
+        m_cursor ++;
+    }
+    while(m_cursor > line) {
+        m_cursor --;
+        m_cursorOffset -= m_lines.at(m_cursor).text.size();
+        m_cursorLine -= m_lines.at(m_cursor).lineBreaks;
+    }
+}
+
+void IncrementalTokeniser::seekOffset(qint64 offset) const
+{
+    while(m_cursor > 0 && offset < m_cursorOffset) {
+        seek(m_cursor - 1);
+    }
+    while(m_cursor < m_lines.size() - 1 && offset >= m_cursorOffset + m_lines.at(m_cursor).text.size()) {
+        seek(m_cursor + 1);
+    }
+}
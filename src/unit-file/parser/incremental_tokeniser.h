@@ -0,0 +1,111 @@
+#ifndef SD_UIKIT_UNITFILE_INCREMENTAL_TOKENISER
+#define SD_UIKIT_UNITFILE_INCREMENTAL_TOKENISER
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include "token.h"
+#include "tokeniser.h"
+
+/**
+ * \brief Keeps the tokens of a UTF-8 document up to date as it is edited, for use by an editor.
+ * The document is held as a list of logical lines: physical lines joined by backslash continuations.
+ * The tokeniser starts afresh at the beginning of every logical line, so an edit only requires the logical lines it touches to be tokenised again.
+ * Should the edit open up a logical line (e.g. by removing a line break or adding a trailing backslash) the following lines are taken along until one ends as before.
+ *
+ * Tokens of other lines are kept as they are: they are stored relative to the start of their logical line, so they need no updating when lines before them grow or shrink.
+ * The work done per edit is therefore proportional to the size of the logical lines affected, not the size of the document.
+ * Lines are located starting from the line last edited or looked up, which keeps this cheap for the typical edits made while typing.
+ *
+ * Tokens reported by #tokens() and #lineTokens(int) have absolute byte offsets and line numbers, exactly as Tokeniser::tokenise(const QByteArray&, const LineEnding&, QVector<ByteRange>*) would report them for #text().
+ */
+class IncrementalTokeniser
+{
+public:
+    /**
+     * \brief describes which logical lines changed in an edit.
+     * Lines [firstLine, firstLine + removedLines) of the document before the edit were replaced by lines [firstLine, firstLine + insertedLines) of the document after it.
+     */
+    struct Change {
+        int firstLine;
+        int removedLines;
+        int insertedLines;
+    };
+
+    IncrementalTokeniser(const Tokeniser::LineEnding& lineEnding = Tokeniser::LF);
+    /**
+     * \brief replaces the whole document, tokenising it from scratch.
+     */
+    void setText(const QByteArray& utf8);
+    /**
+     * \brief replaces length bytes at offset by the given bytes, and tokenises the logical lines affected.
+     * Offset and length are clamped to the document.
+     * \return the logical lines which were tokenised again.
+     */
+    Change edit(qint64 offset, qint64 length, const QByteArray& replacement);
+    /**
+     * \brief the document, as a single buffer. This copies every line, so avoid calling it after every edit.
+     */
+    QByteArray text(void) const;
+    qint64 size(void) const;
+    /**
+     * \brief the number of logical lines. There is always at least one: the (possibly empty) line after the last line break.
+     */
+    int lineCount(void) const;
+    /**
+     * \brief the logical line which contains the given byte offset.
+     */
+    int lineAt(qint64 offset) const;
+    /**
+     * \brief the byte offset at which the given logical line starts.
+     */
+    qint64 lineOffset(int line) const;
+    /**
+     * \brief the raw bytes of the given logical line, including its line break(s).
+     */
+    QByteArray lineText(int line) const;
+    /**
+     * \brief the tokens of the given logical line, with absolute offsets and line numbers.
+     */
+    QVector<TokenSpan> lineTokens(int line) const;
+    /**
+     * \brief all tokens of the document, with absolute offsets and line numbers.
+     */
+    QVector<TokenSpan> tokens(void) const;
+    /**
+     * \brief all runs of invalid bytes in the document, with absolute offsets.
+     */
+    QVector<ByteRange> invalidBytes(void) const;
+    /**
+     * \brief the text of a token returned by #tokens() or #lineTokens(int), exactly as it would have been reported through the Tokeniser signals.
+     */
+    QString tokenText(const TokenSpan& token) const;
+public:
+    /*
+     * A logical line: its bytes, the number of line breaks in it and its tokens, relative to its start.
+     */
+    struct Line {
+        QByteArray text;
+        int lineBreaks;
+        QVector<TokenSpan> tokens;
+        QVector<ByteRange> invalid;
+    };
+private:
+    void seek(int line) const;
+    void seekOffset(qint64 offset) const;
+private:
+    const Tokeniser::LineEnding m_lineEnding;
+    QVector<Line> m_lines;
+    qint64 m_size;
+    /*
+     * The last line looked up: its index, byte offset and (1-based) number of its first physical line.
+     */
+    mutable int m_cursor;
+    mutable qint64 m_cursorOffset;
+    mutable int m_cursorLine;
+};
+
+Q_DECLARE_TYPEINFO(IncrementalTokeniser::Line, Q_MOVABLE_TYPE);
+
+#endif
@@ -0,0 +1,94 @@
+#include "mapped_unit_file.h"
+#include "tokeniser_p.h"
+
+MappedUnitFile::MappedUnitFile(const QString& fileName, const Tokeniser::LineEnding& lineEnding) :
+    m_file(fileName), m_lineEnding(lineEnding), m_map(0), m_size(0), m_open(false) {}
+
+MappedUnitFile::~MappedUnitFile()
+{
+    close();
+}
+
+bool MappedUnitFile::open(void)
+{
+    close();
+    if(!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    m_size = m_file.size();
+    // an empty file cannot be mapped, but it is perfectly valid
+    if(m_size > 0) {
+        m_map = m_file.map(0, m_size);
+        if(!m_map) {
+            m_file.close();
+            m_size = 0;
+            return false;
+        }
+    }
+    m_open = true;
+    m_tokens = tokeniseUTF8(data(), m_size, m_lineEnding, &m_invalid);
+    return true;
+}
+
+void MappedUnitFile::close(void)
+{
+    m_tokens.clear();
+    m_invalid.clear();
+    if(m_map) {
+        m_file.unmap(m_map);
+        m_map = 0;
+    }
+    if(m_open) {
+        m_file.close();
+        m_open = false;
+    }
+    m_size = 0;
+}
+
+bool MappedUnitFile::isOpen(void) const
+{
+    return m_open;
+}
+
+QString MappedUnitFile::fileName(void) const
+{
+    return m_file.fileName();
+}
+
+QString MappedUnitFile::errorString(void) const
+{
+    return m_file.errorString();
+}
+
+const char * MappedUnitFile::data(void) const
+{
+    return reinterpret_cast<const char *>(m_map);
+}
+
+qint64 MappedUnitFile::size(void) const
+{
+    return m_size;
+}
+
+const QVector<TokenSpan>& MappedUnitFile::tokens(void) const
+{
+    return m_tokens;
+}
+
+const QVector<ByteRange>& MappedUnitFile::invalidBytes(void) const
+{
+    return m_invalid;
+}
+
+QByteArray MappedUnitFile::bytes(const TokenSpan& token) const
+{
+    if(token.flags & TokenSpan::Synthetic) {
+        return QByteArray();
+    }
+    return QByteArray::fromRawData(data() + token.offset, (int) token.length);
+}
+
+QString MappedUnitFile::text(const TokenSpan& token) const
+{
+    return tokenTextUTF8(data(), token, !m_invalid.isEmpty());
+}
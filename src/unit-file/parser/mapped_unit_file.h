@@ -0,0 +1,64 @@
+#ifndef SD_UIKIT_UNITFILE_MAPPED_UNIT_FILE
+#define SD_UIKIT_UNITFILE_MAPPED_UNIT_FILE
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include "token.h"
+#include "tokeniser.h"
+
+/**
+ * \brief Validates and tokenises a unit file straight from a read-only memory mapping of the file.
+ * Nothing is copied on the way: UTF-8 validation and tokenisation both run over the mapped bytes, and tokens are
+ * reported as TokenSpan records whose offsets and lengths are byte positions in the mapping.
+ * Text is only materialised when asked for, using #text(const TokenSpan&) or #bytes(const TokenSpan&).
+ *
+ * Malformed UTF-8 is treated as by UTF8Reader: invalid bytes are not fed to the tokeniser. They are listed by #invalidBytes().
+ * A token may therefore span invalid bytes, which #text(const TokenSpan&) leaves out.
+ *
+ * \note Token spans and the pointer returned by #data() are only valid while the file is open.
+ */
+class MappedUnitFile
+{
+public:
+    MappedUnitFile(const QString& fileName, const Tokeniser::LineEnding& lineEnding = Tokeniser::LF);
+    ~MappedUnitFile();
+    /**
+     * \brief opens and maps the file, then validates and tokenises its contents.
+     * \return true on success, false if the file could not be opened or mapped. See #errorString().
+     */
+    bool open(void);
+    /**
+     * \brief unmaps and closes the file, invalidating all token spans.
+     */
+    void close(void);
+    bool isOpen(void) const;
+    QString fileName(void) const;
+    QString errorString(void) const;
+    const char * data(void) const;
+    qint64 size(void) const;
+    const QVector<TokenSpan>& tokens(void) const;
+    const QVector<ByteRange>& invalidBytes(void) const;
+    /**
+     * \brief the raw source bytes of the token, without copying them.
+     * For synthetic tokens (see TokenSpan::Synthetic) this is empty.
+     */
+    QByteArray bytes(const TokenSpan& token) const;
+    /**
+     * \brief the text of the token, exactly as it would have been reported through the Tokeniser signals.
+     */
+    QString text(const TokenSpan& token) const;
+private:
+    Q_DISABLE_COPY(MappedUnitFile)
+    QFile m_file;
+    const Tokeniser::LineEnding m_lineEnding;
+    uchar * m_map;
+    qint64 m_size;
+    bool m_open;
+    QVector<TokenSpan> m_tokens;
+    QVector<ByteRange> m_invalid;
+};
+
+#endif
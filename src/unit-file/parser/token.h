@@ -0,0 +1,139 @@
+#ifndef SD_UIKIT_UNITFILE_TOKEN
+#define SD_UIKIT_UNITFILE_TOKEN
+
+#include <QLatin1String>
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * \brief Location and classification of a single token found by the tokeniser.
+ * A span is plain data: it refers to the source text by offset and length instead of holding a copy of it.
+ * Offsets and lengths are expressed in the units of the source which was tokenised: bytes for UTF-8 input, QChar for UTF-16 (QString) input.
+ */
+struct TokenSpan
+{
+    /**
+     * \brief what kind of token this is. Each kind corresponds to a Tokeniser signal.
+     */
+    enum Kind {
+        Key = 0,
+        Value,
+        Section,
+        Space,
+        Comment,
+        Include,
+        SyntaxError
+    };
+    enum Flag {
+        Synthetic = 1, /* the token does not occur in the source: its text is the #literal character. The offset is where it was expected. */
+        Continued = 2, /* a value continued on the next line: the trailing backslash in the source reads as a single space */
+        EmptyValue = 4 /* the value of an assignment is empty: the token is made up of just the '=' */
+    };
+    quint32 offset;
+    quint32 length;
+    qint32 line;
+    qint32 column;
+    quint8 kind;
+    /**
+     * \brief the hint code as reported by Tokeniser::space() and Tokeniser::syntaxError(), 0 for other kinds.
+     */
+    quint8 hint;
+    quint8 flags;
+    char literal;
+};
+Q_DECLARE_TYPEINFO(TokenSpan, Q_PRIMITIVE_TYPE);
+
+/**
+ * \brief A run of consecutive bytes in UTF-8 input, such as bytes which do not form well formed UTF-8.
+ */
+struct ByteRange
+{
+    quint32 offset;
+    quint32 length;
+};
+Q_DECLARE_TYPEINFO(ByteRange, Q_PRIMITIVE_TYPE);
+
+/**
+ * \brief A view of a token: its TokenSpan plus a pointer into the UTF-16 text it was found in.
+ * Creating, copying and inspecting a Token never allocates; an owned string is only created by #toString().
+ * The special cases recorded in the span flags are taken care of: a synthetic token reads as its literal character,
+ * and the trailing backslash of a continued value reads as a space.
+ *
+ * \note A Token does not keep the text alive. It is only valid as long as the text it points into, which for tokens
+ * reported by Tokeniser::token() means for the duration of the signal emission.
+ */
+class Token
+{
+public:
+    Token(const TokenSpan& span, const QChar * text) : m_span(span), m_text(text) {}
+    const TokenSpan& span(void) const { return m_span; }
+    TokenSpan::Kind kind(void) const { return (TokenSpan::Kind) m_span.kind; }
+    int hint(void) const { return m_span.hint; }
+    int line(void) const { return m_span.line; }
+    int column(void) const { return m_span.column; }
+    bool isSynthetic(void) const { return m_span.flags & TokenSpan::Synthetic; }
+    int size(void) const { return isSynthetic() ? 1 : (int) m_span.length; }
+    bool isEmpty(void) const { return size() == 0; }
+    bool isEmptyValue(void) const { return m_span.flags & TokenSpan::EmptyValue; }
+
+    QChar at(int i) const
+    {
+        if(isSynthetic()) {
+            return QLatin1Char(m_span.literal);
+        }
+        if(m_span.flags & TokenSpan::Continued && i == size() - 1) {
+            return QLatin1Char(' ');
+        }
+        return m_text[i];
+    }
+
+    /**
+     * \brief materialises the token text as an owned string, exactly as it is reported through the Tokeniser signals.
+     */
+    QString toString(void) const
+    {
+        if(isSynthetic()) {
+            return QString(QLatin1Char(m_span.literal));
+        }
+        QString result(m_text, size());
+        if(m_span.flags & TokenSpan::Continued) {
+            result[result.size() - 1] = QLatin1Char(' ');
+        }
+        return result;
+    }
+
+    bool operator==(QLatin1String other) const
+    {
+        if(other.size() != size()) {
+            return false;
+        }
+        for(int i = 0; i < other.size(); ++i) {
+            if(at(i) != QLatin1Char(other.data()[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator==(const QString& other) const
+    {
+        if(other.size() != size()) {
+            return false;
+        }
+        for(int i = 0; i < other.size(); ++i) {
+            if(at(i) != other[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(QLatin1String other) const { return !(*this == other); }
+    bool operator!=(const QString& other) const { return !(*this == other); }
+private:
+    TokenSpan m_span;
+    const QChar * m_text;
+};
+Q_DECLARE_TYPEINFO(Token, Q_MOVABLE_TYPE);
+
+#endif
@@ -1,417 +1,146 @@
-#include "tokeniser.h"
+#include "tokeniser_p.h"
 
+#include <QMetaMethod>
 
-class LineCounter {
-public:
-    LineCounter(const Tokeniser::LineEnding& type) : m_nlType(type), m_prev(QLatin1Char('\0')), m_line(1), m_column(0) {}
-    int line(void) const { return m_line; }
-    int column(void) const { return m_column; }
-    QChar previous(void) const { return m_prev; }
-    
-    bool push(QChar c)
-    {
-        bool nlFound = (c == QLatin1Char('\r') && m_nlType & Tokeniser::CR && m_nlType != Tokeniser::CRLF) || 
-                        (c == QLatin1Char('\n') && m_nlType & Tokeniser::LF && (m_nlType != Tokeniser::CRLF || m_prev == QLatin1Char('\r')));
-        
-        if(nlFound) {
-            m_prev = QLatin1Char('\0');
-            m_column = 0;
-            m_line ++;
-        }
-        else {
-            m_prev = c;
-            m_column++;
-        }
-        return nlFound;
-    }
-    
-    bool pushPair(QChar, QChar)
-    {
-        m_column++;
-        m_prev = QLatin1Char('\0');
-        return false;
-    }
-    
-    bool retraceCR(void)
-    {
-        if(m_prev == QLatin1Char('\r')) {
-            m_column--;
-            return true;
-        }
-        else {
-            return false;
-        }
-    }
-    
-    void retraceFixCount(void)
-    {
-        m_column++;
-    }
-    
-private:
-    const Tokeniser::LineEnding m_nlType;
-    QChar m_prev;
-    int m_line, m_column;
-};
-
-typedef enum TokenClass { 
-    Section, Key, Value, Space, Comment, Syntax, Error
-} TokenClass;
+#ifdef SDUIKIT_TRACING
+Q_LOGGING_CATEGORY(tokeniserTrace, "sduikit.unitfile.tokeniser.trace", QtWarningMsg)
+#endif
 
-class TokenClassifier 
-{
+/*
+ * Bridges the TokeniserEngine to the Tokeniser signals.
+ * Text received is kept in a window which is trimmed as tokens are reported, so tokens can point into it when they are emitted.
+ * Token text is only copied out of the window for the string based signals which are actually connected.
+ */
+class TokeniserPrivate: public TokenSink {
 public:
-    TokenClassifier() { resetToNewLine(); }
-    TokenClass bias(void) const { return m_bias; }
-    bool startChar(void) const { return m_startChar; }
-    
-    void resetToNewLine(void)
-    {
-        m_bias = Syntax;
-        m_startChar = false;
-    }
-    
-    void resetToValue(void)
-    { 
-        m_bias = Value;
-    }
-    
-    TokenClass type(QChar c)
-    {
-        TokenClass result = Error;
-        if(c == QLatin1Char('[')) {
-            if(m_bias == Syntax) {
-                m_bias = Section;
-                m_startChar = false;
-                result = Syntax;
-            }
-        }
-        else if(c == QLatin1Char(']')) {
-            if(m_bias == Section && m_startChar) {
-                m_bias = Space;
-                result = Syntax;
-            }
-        }
-        else if(c == QLatin1Char('=')) {
-            if(m_bias == Key) {
-                m_startChar = false;
-                m_bias = Value;
-                result = Syntax;
-            }
-        }
-        else if(c == QLatin1Char(';') || c == QLatin1Char('#')) {
-            if(m_bias == Syntax) {
-                m_startChar = true;
-                m_bias = Comment;
-                result = Syntax;
-            }
-        }
-        
-        // none of the above if-clauses fired
-        if(result != Syntax) {
-            result = validateAgainstType(c);
-        }
-        
-        return result;
-    }
-    
-    TokenClass type(QChar fst, QChar snd) 
-    {
-        if(fst.isSurrogate() && snd.isSurrogate()) {
-            switch(m_bias) {
-                case Comment:
-                case Value:
-                    m_startChar = true;
-                    return m_bias;
-                default:
-                    return Error;
-            }
-        }
-        else {
-            return Error;
-        }
-    }
-private:
-    inline bool isSpace(QChar c) 
-    {
-        return c == QLatin1Char(' ') || c == QLatin1Char('\t');
-    }
-    /*
-     * According to the systemd unit file man page "The syntax is inspired by XDG Desktop Entry Specification .desktop files"
-     * According to the XDG Desktop file spec (v 1.1), "Only the characters A-Za-z0-9- may be used in key names."
-     */
-    inline bool isKeyChar(QChar c)
-    {
-        return (c >= QLatin1Char('A') && c <= QLatin1Char('Z')) || 
-               (c >= QLatin1Char('a') && c <= QLatin1Char('z')) ||
-               (c >= QLatin1Char('0') && c <= QLatin1Char('9')) ||
-               c == QLatin1Char('-');
-    }
-    /*
-     * According to the systemd unit file man page "The syntax is inspired by XDG Desktop Entry Specification .desktop files"
-     * According to the XDG Desktop file spec (v 1.1), a section name may contain "Any ASCII char except [ and ] and control characters".
-     */
-    inline bool isSectionChar(QChar c)
-    {
-        return c >= QLatin1Char(' ') && c <= QLatin1Char('~') && c != QLatin1Char('[') && c != QLatin1Char(']');
-    }
+    TokeniserPrivate(const Tokeniser::LineEnding& nl, Tokeniser * q) : q_ptr(q), m_engine(nl, this), m_received(0), m_textBase(0), m_connected(0) {}
     
-    TokenClass validateAgainstType(QChar c) 
+    void push(QChar c)
     {
-        if(isSpace(c)) {
-            switch(m_bias) {
-                case Section:
-                    m_startChar = true;
-                    return isSectionChar(c) ? m_bias: Error;
-                case Value:
-                    /*
-                     * Eat up leading whitespace for values. 
-                     * m_startChar is set to true once a non-whitespace character is found in the Value.
-                     */
-                    return m_startChar ? m_bias: Space;
-                // NOTE fall through logic used here.
-                case Syntax:
-                    m_bias = Space; // leading whitespace on lines is only allowed if all subsequent stuff is such whitespace.
-                case Key:
-                    m_startChar = true; // m_startChar is used to mark-end-of-key i.e. space is considered trailing.
-                default:
-                    return m_bias;
-            }
-        }
-        else {
-            switch(m_bias) {
-                case Syntax:
-                    /*
-                     * Assume the start of alpha numeric content indicates a key.
-                     */
-                    if(isKeyChar(c)) {
-                        m_startChar = false; // m_startChar is used for whitespace related purposes now, reset to false.
-                        m_bias = Key;
-                        return m_bias;
-                    }
-                    else {
-                        return Error;
-                    }
-                case Space:
-                    return Error; // we're in a situation in which only (trailing) whitespace is allowed
-                case Comment:
-                    return m_bias;
-                case Value:
-                    m_startChar = true; // we have found a non-whitespace character in the Value, use m_startChar to mark the occasion.
-                    return m_bias; // may need to filter out control chars?
-                case Key:
-                    /*
-                     * m_startChar is used to mark end-of-key when trailing whitespace is encountered.
-                     * Further trailing content would therefore indicate an error, might as well report *that* content as the error instead of the whitespace sequence.
-                     */
-                    return !isKeyChar(c) || m_startChar ? Error: m_bias;
-                case Section:
-                    m_startChar = true;
-                    return isSectionChar(c) ? m_bias: Error;
-                default:
-                    return Error;
-            }
-        }
+        m_text.append(c);
+        m_engine.push(c, m_received, 1);
+        m_received += 1;
+        trim();
+        acknowledge(1);
     }
-private:
-    TokenClass m_bias;
-    bool m_startChar;
-};
-
-class TokeniserPrivate {
-public:
-    TokeniserPrivate(const Tokeniser::LineEnding& nl, Tokeniser * q) : q_ptr(q), m_type(Syntax), m_counter(nl) { mark(); }
     
-    void push(QChar c)
+    void pushPair(QChar fst, QChar snd)
     {
-        bool retraceCR = m_counter.retraceCR();
-        if(m_counter.push(c)) {
-            newLineDecision();
-        }
-        else {
-            retrace(retraceCR);
-            if(c != QLatin1Char('\r')) {
-                update(m_cls.type(c));
-                m_token.append(c);
-            }
-        }
+        m_text.append(fst);
+        m_text.append(snd);
+        m_engine.pushPair(fst, snd, m_received, 2);
+        m_received += 2;
+        trim();
+        acknowledge(2);
     }
     
-    void pushPair(QChar fst, QChar snd)
+    void pushChunk(const QChar * data, int size)
     {
-        bool retraceCR = m_counter.retraceCR();
-        if(m_counter.pushPair(fst, snd)) {
-            newLineDecision();
-        }
-        else {
-            retrace(retraceCR);
-            update(m_cls.type(fst, snd));
-            m_token.append(fst);
-            m_token.append(snd);
-        }
+        m_text.append(data, size);
+        m_engine.pushText(data, size, m_received);
+        m_received += size;
+        trim();
+        acknowledge(size);
     }
     
     void finish(void)
     {
         Q_Q(Tokeniser);
-        retrace(m_counter.retraceCR());
-        flush();
+        m_engine.finish();
         emit q->done();
     }
     
-private:
-    
-    Tokeniser * const q_ptr;
-    Q_DECLARE_PUBLIC(Tokeniser)
-    
-    void reportToken(TokenClass categoryHint, TokenClass type, QString token, int line, int column)
+    void token(const TokenSpan& span) Q_DECL_OVERRIDE
     {
         Q_Q(Tokeniser);
-        int hint = 0;
-        switch(type) {
-            case Error:
-                hint = hintCode(Tokeniser::IllegalCharacter, tokenType(categoryHint));
-                emit q->syntaxError(line, column, token, hint);
+        const Token token(span, span.flags & TokenSpan::Synthetic ? 0 : m_text.constData() + (span.offset - m_textBase));
+        if(m_connected & TokenViewConnected) {
+            emit q->token(token);
+        }
+        if(!(m_connected & (1 << span.kind))) {
+            return;
+        }
+        const QString text = token.toString();
+        switch(span.kind) {
+            case TokenSpan::SyntaxError:
+                emit q->syntaxError(span.line, span.column, text, span.hint);
                 break;
-            case Syntax:
-                if(token == QStringLiteral("[")) {
-                    hint = hintCode(Tokeniser::MissingIdentifier, Tokeniser::Section);
-                }
-                else {
-                    hint = hintCode(Tokeniser::UnterminatedItem, tokenType(m_type));
-                }
-                emit q->syntaxError(line, column, token, hint);
+            case TokenSpan::Space:
+                emit q->space(span.line, span.column, text, span.hint);
                 break;
-            case Space:
-                hint = hintCode(Tokeniser::NotASyntaxError, tokenType(categoryHint));
-                emit q->space(line, column, token, hint);
+            case TokenSpan::Key:
+                emit q->key(span.line, span.column, text);
                 break;
-            case Key:
-                emit q->key(line, column, token);
+            case TokenSpan::Value:
+                emit q->value(span.line, span.column, text);
                 break;
-            case Value:
-                emit q->value(line, column, token);
+            case TokenSpan::Section:
+                emit q->section(span.line, span.column, text);
                 break;
-            case Section:
-                emit q->section(line, column, token);
+            case TokenSpan::Comment:
+                emit q->comment(span.line, span.column, text);
                 break;
-            case Comment:
-                emit q->comment(line, column, token);
+            case TokenSpan::Include:
+                emit q->include(span.line, span.column, text);
                 break;
             default:
                 break;
         }
     }
     
-    inline int hintCode(Tokeniser::SyntaxError err, Tokeniser::TokenType type)
-    {
-        return ((int) err) | ((int) type);
-    }
-    
-    Tokeniser::TokenType tokenType(TokenClass categoryHint)
+    /*
+     * Record which signals are connected, one bit per TokenSpan::Kind. This is checked for every token, so it is not looked up each time.
+     */
+    void updateConnections(void)
     {
-        switch(categoryHint) {
-            case Syntax:
-            case Key:
-                return Tokeniser::Key;
-            case Section:
-                return Tokeniser::Section;
-            case Value:
-                return Tokeniser::Value;
-            default:
-                return Tokeniser::Space;
-        }
+        Q_Q(Tokeniser);
+        m_connected = 0;
+        if(q->isSignalConnected(QMetaMethod::fromSignal(&Tokeniser::key))) m_connected |= 1 << TokenSpan::Key;
+        if(q->isSignalConnected(QMetaMethod::fromSignal(&Tokeniser::value))) m_connected |= 1 << TokenSpan::Value;
+        if(q->isSignalConnected(QMetaMethod::fromSignal(&Tokeniser::section))) m_connected |= 1 << TokenSpan::Section;
+        if(q->isSignalConnected(QMetaMethod::fromSignal(&Tokeniser::space))) m_connected |= 1 << TokenSpan::Space;
+        if(q->isSignalConnected(QMetaMethod::fromSignal(&Tokeniser::comment))) m_connected |= 1 << TokenSpan::Comment;
+        if(q->isSignalConnected(QMetaMethod::fromSignal(&Tokeniser::include))) m_connected |= 1 << TokenSpan::Include;
+        if(q->isSignalConnected(QMetaMethod::fromSignal(&Tokeniser::syntaxError))) m_connected |= 1 << TokenSpan::SyntaxError;
+        if(q->isSignalConnected(QMetaMethod::fromSignal(&Tokeniser::token))) m_connected |= TokenViewConnected;
+        if(q->isSignalConnected(QMetaMethod::fromSignal(&Tokeniser::consumed))) m_connected |= ConsumedConnected;
     }
     
-    void flush(void)
-    {
-        switch(m_type)
-        {
-            case Section:
-                report();
-                reportToken(Syntax, Syntax, QStringLiteral("]"), m_tokenLine, m_tokenColumn + m_token.size());
-            case Key:
-                report();
-                reportToken(Syntax, Syntax, QStringLiteral("="), m_tokenLine, m_tokenColumn + m_token.size());
-                break;
-            case Space:
-            case Error:
-            case Value:
-            case Comment:
-                report();
-                break;
-            case Syntax:
-                TokenClass bias= m_cls.bias();
-                switch(bias) {
-                    case Section: // just a single '['
-                        reportToken(Syntax, Syntax, QStringLiteral("["), m_tokenLine, 1);
-                        break;
-                    case Comment:
-                    case Value:
-                        reportToken(bias, bias, m_token, m_tokenLine, m_tokenColumn); // synthesise 'empty' value/comment token
-                        break;
-                    default:
-                        break;
-                }
-                break;
-        }
-    }
+private:
     
-    void report(void)
-    {
-        if(m_type != Syntax) {
-            TokenClass bias = m_cls.bias();
-            reportToken(bias == Syntax ? m_type : bias, m_type, m_token, m_tokenLine, m_tokenColumn);
-        }
-    }
+    Tokeniser * const q_ptr;
+    Q_DECLARE_PUBLIC(Tokeniser)
     
-    void mark(void)
-    {
-       m_tokenLine = m_counter.line();
-       m_tokenColumn = m_counter.column();
-       m_token = QStringLiteral("");
-    }
+    enum {
+        TokenViewConnected = 1 << 7,
+        ConsumedConnected = 1 << 8
+    };
     
-    void update(TokenClass t)
+    void acknowledge(int size)
     {
-        if(t != m_type) {
-            report();
-            mark();
-            m_type = t;
+        Q_Q(Tokeniser);
+        if(m_connected & ConsumedConnected) {
+            emit q->consumed(size);
         }
     }
     
-    void retrace(bool retraceCR)
+    /*
+     * Drop text which can no longer be referred to by any token, once that is at least half of the window.
+     */
+    void trim(void)
     {
-        if(retraceCR) {
-            update(m_cls.type(QLatin1Char('\r')));
-            m_token.append(QLatin1Char('\r'));
-            m_counter.retraceFixCount();
+        qint64 obsolete = m_engine.pendingOffset() - m_textBase;
+        if(obsolete > 1024 && obsolete * 2 > m_text.size()) {
+            m_text.remove(0, (int) obsolete);
+            m_textBase += obsolete;
         }
     }
     
-    void newLineDecision(void)
-    {
-        if(m_type == Value && m_token.endsWith(QStringLiteral("\\"))) {
-            m_token.chop(1);
-            m_token.append(QLatin1Char(' '));
-            report();
-            mark();
-            m_cls.resetToValue();
-        }
-        else {
-            flush();
-            mark();
-            m_type = Syntax;
-            m_cls.resetToNewLine();
-        }
-    }
 private:
-    TokenClass m_type;
-    LineCounter m_counter;
-    TokenClassifier m_cls;
-    QString m_token;
-    int m_tokenLine, m_tokenColumn;
+    TokeniserEngine m_engine;
+    QString m_text;
+    qint64 m_received, m_textBase;
+    int m_connected;
 };
 
 Tokeniser::Tokeniser(const Tokeniser::LineEnding& lineEnding, QObject * parent) : QObject(parent), d_ptr(new TokeniserPrivate(lineEnding, this)) {}
@@ -434,8 +163,115 @@ void Tokeniser::receivePair(QChar fst, QChar snd)
     d->pushPair(fst, snd);
 }
 
+void Tokeniser::receiveChunk(QString chunk)
+{
+    Q_D(Tokeniser);
+    d->pushChunk(chunk.constData(), chunk.size());
+}
+
 void Tokeniser::end(void)
 {
     Q_D(Tokeniser);
     d->finish();
 }
+
+QVector<TokenSpan> Tokeniser::tokenise(const QString& text, const Tokeniser::LineEnding& lineEnding)
+{
+    return tokenise(text.constData(), text.size(), lineEnding);
+}
+
+/*
+ * Unit files average well over 16 bytes per token, so reserving this much up front means most files are tokenised without reallocating.
+ */
+static inline int estimateTokens(qint64 size)
+{
+    return (int) qMin(size / 16 + 16, Q_INT64_C(1) << 20);
+}
+
+QVector<TokenSpan> Tokeniser::tokenise(const QChar * text, int size, const Tokeniser::LineEnding& lineEnding)
+{
+    QVector<TokenSpan> tokens;
+    tokens.reserve(estimateTokens(size));
+    TokenCollector collector(tokens);
+    TokeniserEngine engine(lineEnding, &collector);
+    engine.pushText(text, size, 0);
+    engine.finish();
+    return tokens;
+}
+
+QVector<TokenSpan> Tokeniser::tokenise(const QByteArray& utf8, const Tokeniser::LineEnding& lineEnding, QVector<ByteRange> * invalidBytes)
+{
+    return tokeniseUTF8(utf8.constData(), utf8.size(), lineEnding, invalidBytes);
+}
+
+QString Tokeniser::text(const QString& text, const TokenSpan& token)
+{
+    return Token(token, text.constData() + token.offset).toString();
+}
+
+QString Tokeniser::text(const QByteArray& utf8, const TokenSpan& token)
+{
+    return tokenTextUTF8(utf8.constData(), token, true);
+}
+
+QVector<TokenSpan> tokeniseUTF8(const char * data, qint64 size, const Tokeniser::LineEnding& lineEnding, QVector<ByteRange> * invalid)
+{
+    QVector<TokenSpan> tokens;
+    tokens.reserve(estimateTokens(size));
+    TokenCollector collector(tokens);
+    TokeniserEngine engine(lineEnding, &collector);
+    UTF8TokeniserFeed feed(engine, invalid);
+    UTF8Validator validator(UTF8Validator::Vectorised);
+    validator.feed(data, size, feed);
+    validator.finish(feed);
+    engine.finish();
+    return tokens;
+}
+
+/*
+ * Collects valid text only, used to materialise tokens which span invalid bytes.
+ */
+class TextCollector: public UTF8Validator::Sink
+{
+public:
+    QString text;
+    void valid(const char * data, qint64 length, qint64) Q_DECL_OVERRIDE
+    {
+        text.append(QString::fromUtf8(data, (int) length));
+    }
+    void invalid(const char *, qint64, qint64) Q_DECL_OVERRIDE {}
+};
+
+QString tokenTextUTF8(const char * data, const TokenSpan& token, bool skipInvalid)
+{
+    if(token.flags & TokenSpan::Synthetic) {
+        return QString(QLatin1Char(token.literal));
+    }
+    QString result;
+    if(skipInvalid) {
+        TextCollector collector;
+        UTF8Validator validator;
+        validator.feed(data + token.offset, token.length, collector);
+        validator.finish(collector);
+        result = collector.text;
+    }
+    else {
+        result = QString::fromUtf8(data + token.offset, (int) token.length);
+    }
+    if(token.flags & TokenSpan::Continued) {
+        result[result.size() - 1] = QLatin1Char(' ');
+    }
+    return result;
+}
+
+void Tokeniser::connectNotify(const QMetaMethod&)
+{
+    Q_D(Tokeniser);
+    d->updateConnections();
+}
+
+void Tokeniser::disconnectNotify(const QMetaMethod&)
+{
+    Q_D(Tokeniser);
+    d->updateConnections();
+}
@@ -1,10 +1,13 @@
 #ifndef SD_UIKIT_UNITFILE_TOKENISER
 #define SD_UIKIT_UNITFILE_TOKENISER
 
+#include <QByteArray>
 #include <QChar>
 #include <QObject>
 #include <QString>
+#include <QVector>
 
+#include "token.h"
 
 class TokeniserPrivate;
 
@@ -37,6 +40,27 @@ public:
     static constexpr inline enum Tokeniser::TokenType getToken(int hintCode) { return (Tokeniser::TokenType) (hintCode & 0xC); }
     Tokeniser(const LineEnding& lineEnding, QObject * parent = 0);
     virtual ~Tokeniser();
+    /**
+     * \brief tokenises a complete text in one go, without any signals being emitted.
+     * \return the tokens found, in order. Offsets and lengths are in QChar; use #text(const QString&, const TokenSpan&) to get at token text.
+     */
+    static QVector<TokenSpan> tokenise(const QString& text, const LineEnding& lineEnding = LF);
+    static QVector<TokenSpan> tokenise(const QChar * text, int size, const LineEnding& lineEnding = LF);
+    /**
+     * \brief tokenises a complete buffer of UTF-8 in one go, without any signals being emitted.
+     * Bytes which are not well formed UTF-8 are skipped, as UTF8Reader would.
+     * \param invalidBytes if given, receives the runs of invalid bytes found.
+     * \return the tokens found, in order. Offsets and lengths are in bytes; use #text(const QByteArray&, const TokenSpan&) to get at token text.
+     */
+    static QVector<TokenSpan> tokenise(const QByteArray& utf8, const LineEnding& lineEnding = LF, QVector<ByteRange> * invalidBytes = 0);
+    /**
+     * \brief the text of a token returned by #tokenise(const QString&, const LineEnding&), as it would have been reported through the signals.
+     */
+    static QString text(const QString& text, const TokenSpan& token);
+    /**
+     * \brief the text of a token returned by #tokenise(const QByteArray&, const LineEnding&, QVector<ByteRange>*), as it would have been reported through the signals.
+     */
+    static QString text(const QByteArray& utf8, const TokenSpan& token);
 Q_SIGNALS:
     void done(void);
     void key(int line, int column, QString name);
@@ -46,10 +70,27 @@ Q_SIGNALS:
     void comment(int line, int column, QString comment);
     void include(int line, int column, QString import);
     void syntaxError(int line, int column, QString token, int hint);
+    /**
+     * \brief reports every token as a view into the text received, without allocating a string for it.
+     * The Token is only valid for the duration of the emission: use a direct connection and call Token::toString() to keep the text.
+     * Text for the string based signals above is only materialised when something is connected to them.
+     */
+    void token(const Token& token);
+    /**
+     * \brief emitted once text received through one of the receive slots was tokenised, to acknowledge it to a streaming UTF8Reader.
+     * \param size the number of QChar received.
+     * This is only emitted if something is connected to it. Connect it to UTF8Reader::acknowledge(qint64) when the tokeniser receives text
+     * through a queued connection, so the reader does not run ahead of it.
+     */
+    void consumed(int size);
 public Q_SLOTS:
     void receive(QChar c);
     void receivePair(QChar fst, QChar snd);
+    void receiveChunk(QString chunk);
     void end(void);
+protected:
+    void connectNotify(const QMetaMethod& signal) Q_DECL_OVERRIDE;
+    void disconnectNotify(const QMetaMethod& signal) Q_DECL_OVERRIDE;
 private:
     Q_DISABLE_COPY(Tokeniser)
 
@@ -0,0 +1,600 @@
+#ifndef SD_UIKIT_UNITFILE_TOKENISER_P
+#define SD_UIKIT_UNITFILE_TOKENISER_P
+
+/*
+ * Internal tokeniser state machine, shared by the Tokeniser QObject and the other front ends which feed it text
+ * (e.g. MappedUnitFile). This header is not part of the public API.
+ */
+
+#include "tokeniser.h"
+#include "token.h"
+#include "../../tracing.h"
+#include "../../utf8/utf8_validator.h"
+
+#include <QVector>
+
+#ifdef SDUIKIT_TRACING
+Q_DECLARE_LOGGING_CATEGORY(tokeniserTrace)
+#endif
+
+class LineCounter {
+public:
+    LineCounter(const Tokeniser::LineEnding& type) : m_nlType(type), m_prev(QLatin1Char('\0')), m_line(1), m_column(0) {}
+    int line(void) const { return m_line; }
+    int column(void) const { return m_column; }
+    QChar previous(void) const { return m_prev; }
+    
+    bool push(QChar c)
+    {
+        bool nlFound = (c == QLatin1Char('\r') && m_nlType & Tokeniser::CR && m_nlType != Tokeniser::CRLF) || 
+                        (c == QLatin1Char('\n') && m_nlType & Tokeniser::LF && (m_nlType != Tokeniser::CRLF || m_prev == QLatin1Char('\r')));
+        
+        if(nlFound) {
+            m_prev = QLatin1Char('\0');
+            m_column = 0;
+            m_line ++;
+        }
+        else {
+            m_prev = c;
+            m_column++;
+        }
+        return nlFound;
+    }
+    
+    bool pushPair(QChar, QChar)
+    {
+        m_column++;
+        m_prev = QLatin1Char('\0');
+        return false;
+    }
+    
+    bool retraceCR(void)
+    {
+        if(m_prev == QLatin1Char('\r')) {
+            m_column--;
+            return true;
+        }
+        else {
+            return false;
+        }
+    }
+    
+    void retraceFixCount(void)
+    {
+        m_column++;
+    }
+    
+private:
+    const Tokeniser::LineEnding m_nlType;
+    QChar m_prev;
+    int m_line, m_column;
+};
+
+typedef enum TokenClass { 
+    Section, Key, Value, Space, Comment, Syntax, Error
+} TokenClass;
+
+/*
+ * The classes of characters which the tokeniser tells apart. Characters of a class are treated alike in every state.
+ *
+ * According to the systemd unit file man page "The syntax is inspired by XDG Desktop Entry Specification .desktop files"
+ * According to the XDG Desktop file spec (v 1.1), "Only the characters A-Za-z0-9- may be used in key names."
+ * and a section name may contain "Any ASCII char except [ and ] and control characters".
+ */
+enum CharClass {
+    OpenBracket, /* '[' */
+    CloseBracket, /* ']' */
+    Equals, /* '=' */
+    CommentMark, /* ';' or '#' */
+    Blank, /* ' ' */
+    Tab, /* '\t', which unlike ' ' is a control character: it may not occur in section names */
+    KeyChar, /* A-Za-z0-9- */
+    Printable, /* any other printable ASCII character */
+    Other, /* control characters and anything beyond ASCII */
+    CharClassCount
+};
+
+/*
+ * Compile time generation of the classifier tables: a table is a pack expansion of a constexpr function over the indices of its entries.
+ */
+template<int... I> struct TableIndices {};
+template<int N, int... I> struct MakeTableIndices: MakeTableIndices<N - 1, N - 1, I...> {};
+template<int... I> struct MakeTableIndices<0, I...> { typedef TableIndices<I...> Type; };
+
+template<typename Generator, typename Indices> struct Table;
+template<typename Generator, int... I> struct Table<Generator, TableIndices<I...>>
+{
+    static constexpr quint8 entries[sizeof...(I)] = { Generator::entry(I)... };
+};
+template<typename Generator, int... I> constexpr quint8 Table<Generator, TableIndices<I...>>::entries[sizeof...(I)];
+
+struct AsciiClasses
+{
+    static constexpr quint8 entry(int c)
+    {
+        return c == '[' ? OpenBracket : c == ']' ? CloseBracket : c == '=' ? Equals : c == ';' || c == '#' ? CommentMark :
+            c == ' ' ? Blank : c == '\t' ? Tab :
+            (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' ? KeyChar :
+            c > ' ' && c <= '~' ? Printable : Other;
+    }
+};
+
+/*
+ * The state of the classifier is its bias plus a flag whose meaning depends on the bias (see TokenClassifier), packed as (bias << 1) | flag.
+ * Each transition is packed as the next state in the low nibble and the class of the character in the high nibble.
+ */
+struct Transitions
+{
+    static constexpr quint8 pack(int bias, bool startChar, int result)
+    {
+        return (quint8) ((bias << 1) | (startChar ? 1 : 0) | (result << 4));
+    }
+
+    static constexpr bool isSectionChar(int cls)
+    {
+        return cls == Blank || cls == Equals || cls == CommentMark || cls == KeyChar || cls == Printable;
+    }
+
+    /*
+     * Whitespace: in a Value, leading whitespace is eaten up (m_startChar is set once a non-whitespace character is found).
+     * Leading whitespace on a line is only allowed if all that follows is such whitespace, and in a Key the flag marks the end of the key.
+     */
+    static constexpr quint8 space(int bias, bool startChar, int cls)
+    {
+        return bias == Section ? pack(Section, true, isSectionChar(cls) ? Section : Error) :
+            bias == Value ? pack(Value, startChar, startChar ? Value : Space) :
+            bias == Syntax ? pack(Space, true, Space) :
+            bias == Key ? pack(Key, true, Key) :
+            pack(bias, startChar, bias);
+    }
+
+    /*
+     * Anything else: the start of alpha numeric content indicates a key, after trailing whitespace in a key or in a Space only errors follow,
+     * and the flag marks that a non-whitespace character was found in a Value.
+     */
+    static constexpr quint8 other(int bias, bool startChar, int cls)
+    {
+        return bias == Syntax ? (cls == KeyChar ? pack(Key, false, Key) : pack(Syntax, startChar, Error)) :
+            bias == Space ? pack(Space, startChar, Error) :
+            bias == Comment ? pack(Comment, startChar, Comment) :
+            bias == Value ? pack(Value, true, Value) :
+            bias == Key ? pack(Key, startChar, cls != KeyChar || startChar ? Error : Key) :
+            bias == Section ? pack(Section, true, isSectionChar(cls) ? Section : Error) :
+            pack(bias, startChar, Error);
+    }
+
+    static constexpr quint8 transition(int bias, bool startChar, int cls)
+    {
+        return cls == OpenBracket && bias == Syntax ? pack(Section, false, Syntax) :
+            cls == CloseBracket && bias == Section && startChar ? pack(Space, startChar, Syntax) :
+            cls == Equals && bias == Key ? pack(Value, false, Syntax) :
+            cls == CommentMark && bias == Syntax ? pack(Comment, true, Syntax) :
+            cls == Blank || cls == Tab ? space(bias, startChar, cls) :
+            other(bias, startChar, cls);
+    }
+
+    static constexpr quint8 entry(int i)
+    {
+        return transition(i / CharClassCount / 2, (i / CharClassCount) % 2 != 0, i % CharClassCount);
+    }
+};
+
+/*
+ * Classifies characters by the kind of token they belong to, given what came before them on the line.
+ * This is a DFA: a character is looked up in a table of character classes, and the class along with the current state in a table of
+ * transitions, both generated at compile time.
+ */
+class TokenClassifier 
+{
+public:
+    TokenClassifier() { resetToNewLine(); }
+    TokenClass bias(void) const { return (TokenClass) (m_state >> 1); }
+    bool startChar(void) const { return m_state & 1; }
+    
+    void resetToNewLine(void)
+    {
+        m_state = Syntax << 1;
+    }
+    
+    void resetToValue(void)
+    { 
+        m_state = (quint8) ((Value << 1) | (m_state & 1));
+    }
+    
+    static CharClass charClass(QChar c)
+    {
+        const ushort u = c.unicode();
+        return u < 0x80 ? (CharClass) AsciiTable::entries[u] : Other;
+    }
+    
+    TokenClass type(QChar c)
+    {
+        const quint8 transition = TransitionTable::entries[m_state * CharClassCount + charClass(c)];
+        m_state = transition & 0xF;
+        return (TokenClass) (transition >> 4);
+    }
+    
+    TokenClass type(QChar fst, QChar snd) 
+    {
+        if(fst.isSurrogate() && snd.isSurrogate()) {
+            switch(bias()) {
+                case Comment:
+                case Value:
+                    m_state |= 1;
+                    return bias();
+                default:
+                    return Error;
+            }
+        }
+        else {
+            return Error;
+        }
+    }
+private:
+    typedef Table<AsciiClasses, MakeTableIndices<0x80>::Type> AsciiTable;
+    typedef Table<Transitions, MakeTableIndices<(Error + 1) * 2 * CharClassCount>::Type> TransitionTable;
+    quint8 m_state;
+};
+
+/*
+ * Receives the tokens found by TokeniserEngine.
+ */
+class TokenSink {
+public:
+    virtual ~TokenSink() {}
+    virtual void token(const TokenSpan& token) = 0;
+    /*
+     * Called for each line break, after any tokens which end on that line. Offset is that of the first character after the line break.
+     * If the line break does not continue a value, the tokeniser starts afresh on the next line: nothing after it depends on what came before.
+     */
+    virtual void newLine(qint64 offset, bool continued)
+    {
+        Q_UNUSED(offset);
+        Q_UNUSED(continued);
+    }
+};
+
+/*
+ * The tokeniser state machine proper. It does not keep a copy of the text it is fed: it only tracks where the current token starts and ends.
+ * Every character is passed along with its offset and width in the source, in whatever unit the source uses (QChar for QString, bytes for UTF-8).
+ */
+class TokeniserEngine {
+public:
+    TokeniserEngine(const Tokeniser::LineEnding& nl, TokenSink * sink) : m_sink(sink), m_type(Syntax), m_counter(nl), m_pos(0), m_crOffset(0) { mark(); }
+    
+    /*
+     * The offset of the earliest text which may still be referred to by tokens yet to be reported.
+     */
+    qint64 pendingOffset(void) const { return m_tokenOffset; }
+    
+    void push(QChar c, qint64 offset, int width)
+    {
+        bool retraceCR = m_counter.retraceCR();
+        if(m_counter.push(c)) {
+            m_pos = offset + width; // whatever comes next starts after the line break
+            newLineDecision();
+        }
+        else {
+            retrace(retraceCR);
+            if(c != QLatin1Char('\r')) {
+                m_pos = offset;
+                update(m_cls.type(c));
+                append(offset, width, 1, c == QLatin1Char('\\'));
+            }
+            else {
+                m_crOffset = offset;
+            }
+        }
+    }
+    
+    void pushPair(QChar fst, QChar snd, qint64 offset, int width)
+    {
+        bool retraceCR = m_counter.retraceCR();
+        if(m_counter.pushPair(fst, snd)) {
+            m_pos = offset + width;
+            newLineDecision();
+        }
+        else {
+            retrace(retraceCR);
+            m_pos = offset;
+            update(m_cls.type(fst, snd));
+            append(offset, width, 2, false);
+        }
+    }
+    
+    /*
+     * Feeds a block of UTF-16 text, where offset is that of the first QChar in the block.
+     */
+    void pushText(const QChar * data, int size, qint64 offset)
+    {
+        for(int i = 0; i < size; ++i) {
+            if(data[i].isSurrogate() && i + 1 < size && data[i + 1].isSurrogate()) {
+                pushPair(data[i], data[i + 1], offset + i, 2);
+                ++i;
+            }
+            else {
+                push(data[i], offset + i, 1);
+            }
+        }
+    }
+    
+    /*
+     * Feeds a block of well formed UTF-8, where offset is that of the first byte in the block.
+     */
+    void pushUTF8(const char * data, qint64 length, qint64 offset)
+    {
+        const uchar * bytes = reinterpret_cast<const uchar *>(data);
+        qint64 i = 0;
+        while(i < length) {
+            const uchar lead = bytes[i];
+            if(lead < 0x80) {
+                push(QChar((ushort) lead), offset + i, 1);
+                ++i;
+                continue;
+            }
+            const int size = lead < 0xE0 ? 2 : (lead < 0xF0 ? 3 : 4);
+            uint codePoint = lead & (0x7F >> size);
+            for(int k = 1; k < size; ++k) {
+                codePoint = (codePoint << 6) | (bytes[i + k] & 0x3F);
+            }
+            if(QChar::requiresSurrogates(codePoint)) {
+                pushPair(QChar(QChar::highSurrogate(codePoint)), QChar(QChar::lowSurrogate(codePoint)), offset + i, size);
+            }
+            else {
+                push(QChar(codePoint), offset + i, size);
+            }
+            i += size;
+        }
+    }
+    
+    void finish(void)
+    {
+        retrace(m_counter.retraceCR());
+        flush();
+    }
+    
+private:
+    
+    void reportToken(TokenClass categoryHint, TokenClass type, qint64 offset, qint64 length, int line, int column, quint8 flags = 0, char literal = '\0')
+    {
+        TokenSpan token;
+        token.offset = (quint32) offset;
+        token.length = (quint32) length;
+        token.line = line;
+        token.column = column;
+        token.flags = flags;
+        token.literal = literal;
+        token.hint = 0;
+        switch(type) {
+            case Error:
+                token.kind = TokenSpan::SyntaxError;
+                token.hint = hintCode(Tokeniser::IllegalCharacter, tokenType(categoryHint));
+                break;
+            case Syntax:
+                token.kind = TokenSpan::SyntaxError;
+                if(literal == '[') {
+                    token.hint = hintCode(Tokeniser::MissingIdentifier, Tokeniser::Section);
+                }
+                else {
+                    token.hint = hintCode(Tokeniser::UnterminatedItem, tokenType(m_type));
+                }
+                break;
+            case Space:
+                token.kind = TokenSpan::Space;
+                token.hint = hintCode(Tokeniser::NotASyntaxError, tokenType(categoryHint));
+                break;
+            case Key:
+                token.kind = TokenSpan::Key;
+                break;
+            case Value:
+                token.kind = TokenSpan::Value;
+                break;
+            case Section:
+                token.kind = TokenSpan::Section;
+                break;
+            case Comment:
+                token.kind = TokenSpan::Comment;
+                break;
+            default:
+                return;
+        }
+        SDUIKIT_TRACE(tokeniserTrace) << "Token of kind:" << token.kind << "hint:" << token.hint << "at:" << line << ":" << column << "offset:" << offset << "length:" << length;
+        m_sink->token(token);
+    }
+    
+    inline int hintCode(Tokeniser::SyntaxError err, Tokeniser::TokenType type)
+    {
+        return ((int) err) | ((int) type);
+    }
+    
+    Tokeniser::TokenType tokenType(TokenClass categoryHint)
+    {
+        switch(categoryHint) {
+            case Syntax:
+            case Key:
+                return Tokeniser::Key;
+            case Section:
+                return Tokeniser::Section;
+            case Value:
+                return Tokeniser::Value;
+            default:
+                return Tokeniser::Space;
+        }
+    }
+    
+    void reportMissing(char literal)
+    {
+        reportToken(Syntax, Syntax, m_tokenEnd, 0, m_tokenLine, m_tokenColumn + m_tokenUnits, TokenSpan::Synthetic, literal);
+    }
+    
+    void flush(void)
+    {
+        switch(m_type)
+        {
+            case Section:
+                report();
+                reportMissing(']');
+            case Key:
+                report();
+                reportMissing('=');
+                break;
+            case Space:
+            case Error:
+            case Value:
+            case Comment:
+                report();
+                break;
+            case Syntax:
+                TokenClass bias= m_cls.bias();
+                switch(bias) {
+                    case Section: // just a single '['
+                        reportToken(Syntax, Syntax, m_tokenOffset, m_tokenEnd - m_tokenOffset, m_tokenLine, 1, TokenSpan::Synthetic, '[');
+                        break;
+                    case Comment: // synthesise 'empty' comment token
+                        reportToken(bias, bias, m_tokenOffset, m_tokenEnd - m_tokenOffset, m_tokenLine, m_tokenColumn);
+                        break;
+                    case Value: // synthesise 'empty' value token, on the '='
+                        reportToken(bias, bias, m_tokenOffset, m_tokenEnd - m_tokenOffset, m_tokenLine, m_tokenColumn, TokenSpan::EmptyValue);
+                        break;
+                    default:
+                        break;
+                }
+                break;
+        }
+    }
+    
+    void report(void)
+    {
+        if(m_type != Syntax) {
+            TokenClass bias = m_cls.bias();
+            reportToken(bias == Syntax ? m_type : bias, m_type, m_tokenOffset, m_tokenEnd - m_tokenOffset, m_tokenLine, m_tokenColumn,
+                        m_tokenContinued ? TokenSpan::Continued : 0);
+        }
+    }
+    
+    void mark(void)
+    {
+       m_tokenLine = m_counter.line();
+       m_tokenColumn = m_counter.column();
+       m_tokenOffset = m_tokenEnd = m_pos;
+       m_tokenUnits = 0;
+       m_tokenBackslash = m_tokenContinued = false;
+    }
+    
+    /*
+     * Extends the current token with the character at offset. Units is the number of QChar it takes.
+     */
+    void append(qint64 offset, int width, int units, bool backslash)
+    {
+        if(m_tokenUnits == 0) {
+            m_tokenOffset = offset;
+        }
+        m_tokenEnd = offset + width;
+        m_tokenUnits += units;
+        m_tokenBackslash = backslash;
+    }
+    
+    void update(TokenClass t)
+    {
+        if(t != m_type) {
+            report();
+            mark();
+            m_type = t;
+        }
+    }
+    
+    void retrace(bool retraceCR)
+    {
+        if(retraceCR) {
+            m_pos = m_crOffset;
+            update(m_cls.type(QLatin1Char('\r')));
+            append(m_crOffset, 1, 1, false);
+            m_counter.retraceFixCount();
+        }
+    }
+    
+    void newLineDecision(void)
+    {
+        if(m_type == Value && m_tokenBackslash) {
+            // the trailing backslash is reported as a space
+            m_tokenContinued = true;
+            report();
+            mark();
+            m_cls.resetToValue();
+            m_sink->newLine(m_pos, true);
+        }
+        else {
+            flush();
+            mark();
+            m_type = Syntax;
+            m_cls.resetToNewLine();
+            m_sink->newLine(m_pos, false);
+        }
+    }
+private:
+    TokenSink * const m_sink;
+    TokenClass m_type;
+    LineCounter m_counter;
+    TokenClassifier m_cls;
+    int m_tokenLine, m_tokenColumn, m_tokenUnits;
+    qint64 m_tokenOffset, m_tokenEnd;
+    bool m_tokenBackslash, m_tokenContinued;
+    qint64 m_pos, m_crOffset;
+};
+
+/*
+ * Collects tokens into a vector.
+ */
+class TokenCollector: public TokenSink {
+public:
+    TokenCollector(QVector<TokenSpan>& tokens) : m_tokens(tokens) {}
+    void token(const TokenSpan& token) Q_DECL_OVERRIDE
+    {
+        m_tokens.append(token);
+    }
+private:
+    QVector<TokenSpan>& m_tokens;
+};
+
+/*
+ * Validates UTF-8 and passes the well formed runs on to a TokeniserEngine. Invalid bytes are skipped, and recorded if asked to.
+ */
+class UTF8TokeniserFeed: public UTF8Validator::Sink {
+public:
+    UTF8TokeniserFeed(TokeniserEngine& engine, QVector<ByteRange> * invalid = 0) : m_engine(engine), m_invalid(invalid) {}
+    
+    void valid(const char * data, qint64 length, qint64 offset) Q_DECL_OVERRIDE
+    {
+        m_engine.pushUTF8(data, length, offset);
+    }
+    
+    void invalid(const char *, qint64 length, qint64 offset) Q_DECL_OVERRIDE
+    {
+        // the validator may report a run in parts (e.g. an incomplete sequence at the end of input): report it as one, as UTF8Reader does
+        if(m_invalid && !m_invalid->isEmpty() && m_invalid->last().offset + m_invalid->last().length == (quint64) offset) {
+            m_invalid->last().length += (quint32) length;
+        }
+        else if(m_invalid) {
+            ByteRange range;
+            range.offset = (quint32) offset;
+            range.length = (quint32) length;
+            m_invalid->append(range);
+        }
+    }
+private:
+    TokeniserEngine& m_engine;
+    QVector<ByteRange> * const m_invalid;
+};
+
+/*
+ * Tokenises a buffer of UTF-8 in one go, reporting tokens by byte offset.
+ */
+QVector<TokenSpan> tokeniseUTF8(const char * data, qint64 size, const Tokeniser::LineEnding& lineEnding, QVector<ByteRange> * invalid);
+
+/*
+ * The text of a token found in UTF-8 input as it would be reported by the Tokeniser signals.
+ * If the input may contain invalid bytes these must be skipped, which takes a validation pass over the token.
+ */
+QString tokenTextUTF8(const char * data, const TokenSpan& token, bool skipInvalid);
+
+#endif
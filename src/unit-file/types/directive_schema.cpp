@@ -0,0 +1,852 @@
+#include "directive_schema.h"
+#include "keyword_table.h"
+
+typedef DirectiveSchema Schema;
+
+/*
+ * Keyword values hold the ValueType of a directive, plus this flag for deprecated ones.
+ */
+enum {
+    Deprecated = 0x100,
+    TypeMask = 0xFF
+};
+
+/*
+ * Groups of directives. A section accepts the directives of one or more groups, like systemd shares e.g. the settings of the execution
+ * environment between services, sockets, mounts and swaps.
+ */
+enum Group {
+    UnitGroup = 0x1,
+    ConditionGroup = 0x2,
+    InstallGroup = 0x4,
+    ExecGroup = 0x8,
+    SandboxGroup = 0x10,
+    KillGroup = 0x20,
+    ResourceGroup = 0x40,
+    ServiceGroup = 0x80,
+    SocketGroup = 0x100,
+    TimerGroup = 0x200,
+    PathGroup = 0x400,
+    MountGroup = 0x800,
+    AutomountGroup = 0x1000,
+    SwapGroup = 0x2000,
+    ScopeGroup = 0x4000
+};
+
+static constexpr Keyword sectionKeywords[] = {
+    { "Unit", UnitGroup | ConditionGroup },
+    { "Install", InstallGroup },
+    { "Service", ServiceGroup | ExecGroup | SandboxGroup | KillGroup | ResourceGroup },
+    { "Socket", SocketGroup | ExecGroup | SandboxGroup | KillGroup | ResourceGroup },
+    { "Mount", MountGroup | ExecGroup | SandboxGroup | KillGroup | ResourceGroup },
+    { "Swap", SwapGroup | ExecGroup | SandboxGroup | KillGroup | ResourceGroup },
+    { "Automount", AutomountGroup },
+    { "Timer", TimerGroup },
+    { "Path", PathGroup },
+    { "Slice", ResourceGroup },
+    { "Scope", ScopeGroup | KillGroup | ResourceGroup }
+};
+static constexpr KeywordTable<11, 32> sections(sectionKeywords);
+
+/*
+ * The manual page which documents each section, in the order of sectionKeywords.
+ */
+static const char * const manualPages[] = {
+    "man:systemd.unit(5)",
+    "man:systemd.unit(5)",
+    "man:systemd.service(5)",
+    "man:systemd.socket(5)",
+    "man:systemd.mount(5)",
+    "man:systemd.swap(5)",
+    "man:systemd.automount(5)",
+    "man:systemd.timer(5)",
+    "man:systemd.path(5)",
+    "man:systemd.slice(5)",
+    "man:systemd.scope(5)"
+};
+
+static constexpr Keyword unitKeywords[] = {
+    { "Description", Schema::String },
+    { "Documentation", Schema::String },
+    { "Requires", Schema::UnitList },
+    { "Requisite", Schema::UnitList },
+    { "Wants", Schema::UnitList },
+    { "BindsTo", Schema::UnitList },
+    { "PartOf", Schema::UnitList },
+    { "Upholds", Schema::UnitList },
+    { "Conflicts", Schema::UnitList },
+    { "Before", Schema::UnitList },
+    { "After", Schema::UnitList },
+    { "OnFailure", Schema::UnitList },
+    { "OnSuccess", Schema::UnitList },
+    { "PropagatesReloadTo", Schema::UnitList },
+    { "ReloadPropagatedFrom", Schema::UnitList },
+    { "PropagatesStopTo", Schema::UnitList },
+    { "StopPropagatedFrom", Schema::UnitList },
+    { "JoinsNamespaceOf", Schema::UnitList },
+    { "RequiresMountsFor", Schema::Path },
+    { "OnFailureJobMode", Schema::Enumeration },
+    { "OnSuccessJobMode", Schema::Enumeration },
+    { "IgnoreOnIsolate", Schema::Boolean },
+    { "StopWhenUnneeded", Schema::Boolean },
+    { "SurviveFinalKillSignal", Schema::Boolean },
+    { "RefuseManualStart", Schema::Boolean },
+    { "RefuseManualStop", Schema::Boolean },
+    { "AllowIsolate", Schema::Boolean },
+    { "DefaultDependencies", Schema::Boolean },
+    { "CollectMode", Schema::Enumeration },
+    { "FailureAction", Schema::Enumeration },
+    { "SuccessAction", Schema::Enumeration },
+    { "FailureActionExitStatus", Schema::Integer },
+    { "SuccessActionExitStatus", Schema::Integer },
+    { "JobTimeoutSec", Schema::TimeSpan },
+    { "JobRunningTimeoutSec", Schema::TimeSpan },
+    { "JobTimeoutAction", Schema::Enumeration },
+    { "JobTimeoutRebootArgument", Schema::String },
+    { "StartLimitIntervalSec", Schema::TimeSpan },
+    { "StartLimitBurst", Schema::Integer },
+    { "StartLimitAction", Schema::Enumeration },
+    { "RebootArgument", Schema::String },
+    { "SourcePath", Schema::Path },
+    { "OnFailureIsolate", Schema::Boolean | Deprecated },
+    { "StartLimitInterval", Schema::TimeSpan | Deprecated },
+    { "BindTo", Schema::UnitList | Deprecated },
+    { "RequiresOverridable", Schema::UnitList | Deprecated },
+    { "RequisiteOverridable", Schema::UnitList | Deprecated },
+    { "IgnoreOnSnapshot", Schema::Boolean | Deprecated },
+    { "PropagateReloadTo", Schema::UnitList | Deprecated },
+    { "PropagateReloadFrom", Schema::UnitList | Deprecated }
+};
+static constexpr KeywordTable<50, 512> unitKeys(unitKeywords);
+
+static constexpr Keyword conditionKeywords[] = {
+    { "ConditionArchitecture", Schema::String },
+    { "ConditionVirtualization", Schema::String },
+    { "ConditionHost", Schema::String },
+    { "ConditionKernelCommandLine", Schema::String },
+    { "ConditionKernelVersion", Schema::String },
+    { "ConditionSecurity", Schema::String },
+    { "ConditionCapability", Schema::String },
+    { "ConditionACPower", Schema::Boolean },
+    { "ConditionNeedsUpdate", Schema::Path },
+    { "ConditionFirstBoot", Schema::Boolean },
+    { "ConditionPathExists", Schema::Path },
+    { "ConditionPathExistsGlob", Schema::Path },
+    { "ConditionPathIsDirectory", Schema::Path },
+    { "ConditionPathIsSymbolicLink", Schema::Path },
+    { "ConditionPathIsMountPoint", Schema::Path },
+    { "ConditionPathIsReadWrite", Schema::Path },
+    { "ConditionPathIsEncrypted", Schema::Path },
+    { "ConditionDirectoryNotEmpty", Schema::Path },
+    { "ConditionFileNotEmpty", Schema::Path },
+    { "ConditionFileIsExecutable", Schema::Path },
+    { "ConditionUser", Schema::String },
+    { "ConditionGroup", Schema::String },
+    { "ConditionControlGroupController", Schema::String },
+    { "ConditionMemory", Schema::String },
+    { "ConditionCPUs", Schema::String },
+    { "ConditionEnvironment", Schema::String },
+    { "ConditionFirmware", Schema::String },
+    { "ConditionCredential", Schema::String },
+    { "ConditionCPUFeature", Schema::String },
+    { "ConditionOSRelease", Schema::String },
+    { "ConditionMemoryPressure", Schema::String },
+    { "ConditionCPUPressure", Schema::String },
+    { "ConditionIOPressure", Schema::String },
+    { "AssertArchitecture", Schema::String },
+    { "AssertVirtualization", Schema::String },
+    { "AssertHost", Schema::String },
+    { "AssertKernelCommandLine", Schema::String },
+    { "AssertKernelVersion", Schema::String },
+    { "AssertSecurity", Schema::String },
+    { "AssertCapability", Schema::String },
+    { "AssertACPower", Schema::Boolean },
+    { "AssertNeedsUpdate", Schema::Path },
+    { "AssertFirstBoot", Schema::Boolean },
+    { "AssertPathExists", Schema::Path },
+    { "AssertPathExistsGlob", Schema::Path },
+    { "AssertPathIsDirectory", Schema::Path },
+    { "AssertPathIsSymbolicLink", Schema::Path },
+    { "AssertPathIsMountPoint", Schema::Path },
+    { "AssertPathIsReadWrite", Schema::Path },
+    { "AssertPathIsEncrypted", Schema::Path },
+    { "AssertDirectoryNotEmpty", Schema::Path },
+    { "AssertFileNotEmpty", Schema::Path },
+    { "AssertFileIsExecutable", Schema::Path },
+    { "AssertUser", Schema::String },
+    { "AssertGroup", Schema::String },
+    { "AssertControlGroupController", Schema::String },
+    { "AssertMemory", Schema::String },
+    { "AssertCPUs", Schema::String },
+    { "AssertEnvironment", Schema::String },
+    { "AssertFirmware", Schema::String },
+    { "AssertCredential", Schema::String },
+    { "AssertCPUFeature", Schema::String },
+    { "AssertOSRelease", Schema::String },
+    { "AssertMemoryPressure", Schema::String },
+    { "AssertCPUPressure", Schema::String },
+    { "AssertIOPressure", Schema::String }
+};
+static constexpr KeywordTable<66, 512> conditionKeys(conditionKeywords);
+
+static constexpr Keyword installKeywords[] = {
+    { "Alias", Schema::UnitList },
+    { "WantedBy", Schema::UnitList },
+    { "RequiredBy", Schema::UnitList },
+    { "Also", Schema::UnitList },
+    { "DefaultInstance", Schema::String }
+};
+static constexpr KeywordTable<5, 16> installKeys(installKeywords);
+
+/*
+ * The execution environment of processes, see systemd.exec(5), apart from sandboxing.
+ */
+static constexpr Keyword execKeywords[] = {
+    { "WorkingDirectory", Schema::Path },
+    { "RootDirectory", Schema::Path },
+    { "RootImage", Schema::Path },
+    { "User", Schema::String },
+    { "Group", Schema::String },
+    { "SupplementaryGroups", Schema::String },
+    { "DynamicUser", Schema::Boolean },
+    { "PAMName", Schema::String },
+    { "Nice", Schema::Integer },
+    { "OOMScoreAdjust", Schema::Integer },
+    { "IOSchedulingClass", Schema::Enumeration },
+    { "IOSchedulingPriority", Schema::Integer },
+    { "CPUSchedulingPolicy", Schema::Enumeration },
+    { "CPUSchedulingPriority", Schema::Integer },
+    { "CPUSchedulingResetOnFork", Schema::Boolean },
+    { "CPUAffinity", Schema::String },
+    { "NUMAPolicy", Schema::Enumeration },
+    { "NUMAMask", Schema::String },
+    { "UMask", Schema::Integer },
+    { "Personality", Schema::Enumeration },
+    { "TimerSlackNSec", Schema::TimeSpan },
+    { "CoredumpFilter", Schema::String },
+    { "MemoryKSM", Schema::Boolean },
+    { "IgnoreSIGPIPE", Schema::Boolean },
+    { "Environment", Schema::Environment },
+    { "EnvironmentFile", Schema::Path },
+    { "PassEnvironment", Schema::String },
+    { "UnsetEnvironment", Schema::String },
+    { "ExecSearchPath", Schema::Path },
+    { "StandardInput", Schema::Enumeration },
+    { "StandardOutput", Schema::Enumeration },
+    { "StandardError", Schema::Enumeration },
+    { "StandardInputText", Schema::String },
+    { "StandardInputData", Schema::String },
+    { "SyslogIdentifier", Schema::String },
+    { "SyslogFacility", Schema::Enumeration },
+    { "SyslogLevel", Schema::Enumeration },
+    { "SyslogLevelPrefix", Schema::Boolean },
+    { "LogLevelMax", Schema::Enumeration },
+    { "LogExtraFields", Schema::String },
+    { "LogRateLimitIntervalSec", Schema::TimeSpan },
+    { "LogRateLimitBurst", Schema::Integer },
+    { "LogFilterPatterns", Schema::String },
+    { "LogNamespace", Schema::String },
+    { "TTYPath", Schema::Path },
+    { "TTYReset", Schema::Boolean },
+    { "TTYVHangup", Schema::Boolean },
+    { "TTYVTDisallocate", Schema::Boolean },
+    { "TTYRows", Schema::Integer },
+    { "TTYColumns", Schema::Integer },
+    { "UtmpIdentifier", Schema::String },
+    { "UtmpMode", Schema::Enumeration },
+    { "LoadCredential", Schema::String },
+    { "LoadCredentialEncrypted", Schema::String },
+    { "ImportCredential", Schema::String },
+    { "SetCredential", Schema::String },
+    { "SetCredentialEncrypted", Schema::String },
+    { "TimeoutCleanSec", Schema::TimeSpan },
+    { "LimitCPU", Schema::String },
+    { "LimitFSIZE", Schema::String },
+    { "LimitDATA", Schema::String },
+    { "LimitSTACK", Schema::String },
+    { "LimitCORE", Schema::String },
+    { "LimitRSS", Schema::String },
+    { "LimitNOFILE", Schema::String },
+    { "LimitAS", Schema::String },
+    { "LimitNPROC", Schema::String },
+    { "LimitMEMLOCK", Schema::String },
+    { "LimitLOCKS", Schema::String },
+    { "LimitSIGPENDING", Schema::String },
+    { "LimitMSGQUEUE", Schema::String },
+    { "LimitNICE", Schema::String },
+    { "LimitRTPRIO", Schema::String },
+    { "LimitRTTIME", Schema::String }
+};
+static constexpr KeywordTable<74, 1024> execKeys(execKeywords);
+
+/*
+ * The security and sandboxing settings of the execution environment.
+ */
+static constexpr Keyword sandboxKeywords[] = {
+    { "CapabilityBoundingSet", Schema::String },
+    { "AmbientCapabilities", Schema::String },
+    { "SecureBits", Schema::Enumeration },
+    { "NoNewPrivileges", Schema::Boolean },
+    { "ProtectSystem", Schema::Enumeration },
+    { "ProtectHome", Schema::Enumeration },
+    { "ProtectProc", Schema::Enumeration },
+    { "ProcSubset", Schema::Enumeration },
+    { "ProtectKernelTunables", Schema::Boolean },
+    { "ProtectKernelModules", Schema::Boolean },
+    { "ProtectKernelLogs", Schema::Boolean },
+    { "ProtectControlGroups", Schema::Boolean },
+    { "ProtectClock", Schema::Boolean },
+    { "ProtectHostname", Schema::Boolean },
+    { "PrivateTmp", Schema::Boolean },
+    { "PrivateDevices", Schema::Boolean },
+    { "PrivateNetwork", Schema::Boolean },
+    { "PrivateUsers", Schema::Boolean },
+    { "PrivateMounts", Schema::Boolean },
+    { "PrivateIPC", Schema::Boolean },
+    { "NetworkNamespacePath", Schema::Path },
+    { "IPCNamespacePath", Schema::Path },
+    { "MountAPIVFS", Schema::Boolean },
+    { "ReadWritePaths", Schema::Path },
+    { "ReadOnlyPaths", Schema::Path },
+    { "InaccessiblePaths", Schema::Path },
+    { "ExecPaths", Schema::Path },
+    { "NoExecPaths", Schema::Path },
+    { "BindPaths", Schema::Path },
+    { "BindReadOnlyPaths", Schema::Path },
+    { "TemporaryFileSystem", Schema::Path },
+    { "RootImageOptions", Schema::String },
+    { "RootImagePolicy", Schema::String },
+    { "RootEphemeral", Schema::Boolean },
+    { "RootHash", Schema::String },
+    { "RootHashSignature", Schema::String },
+    { "RootVerity", Schema::Path },
+    { "MountImages", Schema::String },
+    { "MountImagePolicy", Schema::String },
+    { "ExtensionImages", Schema::String },
+    { "ExtensionImagePolicy", Schema::String },
+    { "ExtensionDirectories", Schema::Path },
+    { "RuntimeDirectory", Schema::Path },
+    { "StateDirectory", Schema::Path },
+    { "CacheDirectory", Schema::Path },
+    { "LogsDirectory", Schema::Path },
+    { "ConfigurationDirectory", Schema::Path },
+    { "RuntimeDirectoryMode", Schema::Integer },
+    { "StateDirectoryMode", Schema::Integer },
+    { "CacheDirectoryMode", Schema::Integer },
+    { "LogsDirectoryMode", Schema::Integer },
+    { "ConfigurationDirectoryMode", Schema::Integer },
+    { "RuntimeDirectoryPreserve", Schema::Enumeration },
+    { "MemoryDenyWriteExecute", Schema::Boolean },
+    { "RestrictRealtime", Schema::Boolean },
+    { "RestrictSUIDSGID", Schema::Boolean },
+    { "RestrictNamespaces", Schema::String },
+    { "RestrictAddressFamilies", Schema::String },
+    { "LockPersonality", Schema::Boolean },
+    { "SystemCallFilter", Schema::String },
+    { "SystemCallErrorNumber", Schema::String },
+    { "SystemCallArchitectures", Schema::String },
+    { "SystemCallLog", Schema::String },
+    { "RestrictFileSystems", Schema::String },
+    { "SELinuxContext", Schema::String },
+    { "AppArmorProfile", Schema::String },
+    { "SmackProcessLabel", Schema::String },
+    { "KeyringMode", Schema::Enumeration },
+    { "MountFlags", Schema::Enumeration },
+    { "RemoveIPC", Schema::Boolean },
+    { "ReadWriteDirectories", Schema::Path | Deprecated },
+    { "ReadOnlyDirectories", Schema::Path | Deprecated },
+    { "InaccessibleDirectories", Schema::Path | Deprecated },
+    { "Capabilities", Schema::String | Deprecated }
+};
+static constexpr KeywordTable<74, 512> sandboxKeys(sandboxKeywords);
+
+static constexpr Keyword killKeywords[] = {
+    { "KillMode", Schema::Enumeration },
+    { "KillSignal", Schema::String },
+    { "RestartKillSignal", Schema::String },
+    { "FinalKillSignal", Schema::String },
+    { "WatchdogSignal", Schema::String },
+    { "SendSIGHUP", Schema::Boolean },
+    { "SendSIGKILL", Schema::Boolean }
+};
+static constexpr KeywordTable<7, 32> killKeys(killKeywords);
+
+/*
+ * Resource control by control groups, see systemd.resource-control(5).
+ */
+static constexpr Keyword resourceKeywords[] = {
+    { "Slice", Schema::UnitList },
+    { "Delegate", Schema::String },
+    { "DelegateSubgroup", Schema::String },
+    { "DisableControllers", Schema::String },
+    { "CPUAccounting", Schema::Boolean },
+    { "CPUWeight", Schema::Integer },
+    { "StartupCPUWeight", Schema::Integer },
+    { "CPUQuota", Schema::String },
+    { "CPUQuotaPeriodSec", Schema::TimeSpan },
+    { "AllowedCPUs", Schema::String },
+    { "AllowedMemoryNodes", Schema::String },
+    { "StartupAllowedCPUs", Schema::String },
+    { "StartupAllowedMemoryNodes", Schema::String },
+    { "MemoryAccounting", Schema::Boolean },
+    { "MemoryMin", Schema::Size },
+    { "DefaultMemoryMin", Schema::Size },
+    { "DefaultMemoryLow", Schema::Size },
+    { "MemoryLow", Schema::Size },
+    { "MemoryHigh", Schema::Size },
+    { "MemoryMax", Schema::Size },
+    { "MemorySwapMax", Schema::Size },
+    { "MemoryZSwapMax", Schema::Size },
+    { "StartupMemoryLow", Schema::Size },
+    { "StartupMemoryHigh", Schema::Size },
+    { "StartupMemoryMax", Schema::Size },
+    { "StartupMemorySwapMax", Schema::Size },
+    { "StartupMemoryZSwapMax", Schema::Size },
+    { "MemoryPressureWatch", Schema::Enumeration },
+    { "MemoryPressureThresholdSec", Schema::TimeSpan },
+    { "TasksAccounting", Schema::Boolean },
+    { "TasksMax", Schema::String },
+    { "IOAccounting", Schema::Boolean },
+    { "IOWeight", Schema::Integer },
+    { "StartupIOWeight", Schema::Integer },
+    { "IODeviceWeight", Schema::String },
+    { "IOReadBandwidthMax", Schema::String },
+    { "IOWriteBandwidthMax", Schema::String },
+    { "IOReadIOPSMax", Schema::String },
+    { "IOWriteIOPSMax", Schema::String },
+    { "IODeviceLatencyTargetSec", Schema::String },
+    { "IPAccounting", Schema::Boolean },
+    { "IPAddressAllow", Schema::String },
+    { "IPAddressDeny", Schema::String },
+    { "IPIngressFilterPath", Schema::Path },
+    { "IPEgressFilterPath", Schema::Path },
+    { "BPFProgram", Schema::String },
+    { "SocketBindAllow", Schema::String },
+    { "SocketBindDeny", Schema::String },
+    { "RestrictNetworkInterfaces", Schema::String },
+    { "NFTSet", Schema::String },
+    { "DeviceAllow", Schema::String },
+    { "DevicePolicy", Schema::Enumeration },
+    { "ManagedOOMSwap", Schema::Enumeration },
+    { "ManagedOOMMemoryPressure", Schema::Enumeration },
+    { "ManagedOOMMemoryPressureLimit", Schema::String },
+    { "ManagedOOMPreference", Schema::Enumeration },
+    { "CPUShares", Schema::Integer | Deprecated },
+    { "StartupCPUShares", Schema::Integer | Deprecated },
+    { "MemoryLimit", Schema::Size | Deprecated },
+    { "BlockIOAccounting", Schema::Boolean | Deprecated },
+    { "BlockIOWeight", Schema::Integer | Deprecated },
+    { "StartupBlockIOWeight", Schema::Integer | Deprecated },
+    { "BlockIODeviceWeight", Schema::String | Deprecated },
+    { "BlockIOReadBandwidth", Schema::String | Deprecated },
+    { "BlockIOWriteBandwidth", Schema::String | Deprecated },
+    { "NetClass", Schema::String | Deprecated }
+};
+static constexpr KeywordTable<66, 512> resourceKeys(resourceKeywords);
+
+static constexpr Keyword serviceKeywords[] = {
+    { "Type", Schema::Enumeration },
+    { "ExitType", Schema::Enumeration },
+    { "RemainAfterExit", Schema::Boolean },
+    { "GuessMainPID", Schema::Boolean },
+    { "PIDFile", Schema::Path },
+    { "BusName", Schema::String },
+    { "ExecCondition", Schema::CommandLine },
+    { "ExecStartPre", Schema::CommandLine },
+    { "ExecStart", Schema::CommandLine },
+    { "ExecStartPost", Schema::CommandLine },
+    { "ExecReload", Schema::CommandLine },
+    { "ExecStop", Schema::CommandLine },
+    { "ExecStopPost", Schema::CommandLine },
+    { "RestartSec", Schema::TimeSpan },
+    { "TimeoutStartSec", Schema::TimeSpan },
+    { "TimeoutStopSec", Schema::TimeSpan },
+    { "TimeoutAbortSec", Schema::TimeSpan },
+    { "TimeoutStartFailureMode", Schema::Enumeration },
+    { "TimeoutStopFailureMode", Schema::Enumeration },
+    { "TimeoutSec", Schema::TimeSpan },
+    { "RuntimeMaxSec", Schema::TimeSpan },
+    { "RuntimeRandomizedExtraSec", Schema::TimeSpan },
+    { "WatchdogSec", Schema::TimeSpan },
+    { "Restart", Schema::Enumeration },
+    { "RestartMode", Schema::Enumeration },
+    { "RestartSteps", Schema::Integer },
+    { "RestartMaxDelaySec", Schema::TimeSpan },
+    { "SuccessExitStatus", Schema::String },
+    { "RestartPreventExitStatus", Schema::String },
+    { "RestartForceExitStatus", Schema::String },
+    { "RootDirectoryStartOnly", Schema::Boolean },
+    { "NonBlocking", Schema::Boolean },
+    { "NotifyAccess", Schema::Enumeration },
+    { "Sockets", Schema::UnitList },
+    { "FileDescriptorStoreMax", Schema::Integer },
+    { "USBFunctionDescriptors", Schema::Path },
+    { "USBFunctionStrings", Schema::Path },
+    { "OOMPolicy", Schema::Enumeration },
+    { "OpenFile", Schema::String },
+    { "ReloadSignal", Schema::String },
+    { "PermissionsStartOnly", Schema::Boolean | Deprecated },
+    { "StartLimitInterval", Schema::TimeSpan | Deprecated },
+    { "StartLimitBurst", Schema::Integer | Deprecated },
+    { "StartLimitAction", Schema::Enumeration | Deprecated },
+    { "FailureAction", Schema::Enumeration | Deprecated },
+    { "RebootArgument", Schema::String | Deprecated },
+    { "BusPolicy", Schema::String | Deprecated },
+    { "SysVStartPriority", Schema::Integer | Deprecated }
+};
+static constexpr KeywordTable<48, 512> serviceKeys(serviceKeywords);
+
+static constexpr Keyword socketKeywords[] = {
+    { "ListenStream", Schema::String },
+    { "ListenDatagram", Schema::String },
+    { "ListenSequentialPacket", Schema::String },
+    { "ListenFIFO", Schema::Path },
+    { "ListenSpecial", Schema::Path },
+    { "ListenNetlink", Schema::String },
+    { "ListenMessageQueue", Schema::String },
+    { "ListenUSBFunction", Schema::Path },
+    { "SocketProtocol", Schema::Enumeration },
+    { "BindIPv6Only", Schema::Enumeration },
+    { "Backlog", Schema::Integer },
+    { "BindToDevice", Schema::String },
+    { "SocketUser", Schema::String },
+    { "SocketGroup", Schema::String },
+    { "SocketMode", Schema::Integer },
+    { "DirectoryMode", Schema::Integer },
+    { "Accept", Schema::Boolean },
+    { "Writable", Schema::Boolean },
+    { "MaxConnections", Schema::Integer },
+    { "MaxConnectionsPerSource", Schema::Integer },
+    { "KeepAlive", Schema::Boolean },
+    { "KeepAliveTimeSec", Schema::TimeSpan },
+    { "KeepAliveIntervalSec", Schema::TimeSpan },
+    { "KeepAliveProbes", Schema::Integer },
+    { "NoDelay", Schema::Boolean },
+    { "Priority", Schema::Integer },
+    { "DeferAcceptSec", Schema::TimeSpan },
+    { "ReceiveBuffer", Schema::Size },
+    { "SendBuffer", Schema::Size },
+    { "IPTOS", Schema::Integer },
+    { "IPTTL", Schema::Integer },
+    { "Mark", Schema::Integer },
+    { "ReusePort", Schema::Boolean },
+    { "SmackLabel", Schema::String },
+    { "SmackLabelIPIn", Schema::String },
+    { "SmackLabelIPOut", Schema::String },
+    { "SELinuxContextFromNet", Schema::Boolean },
+    { "PipeSize", Schema::Size },
+    { "MessageQueueMaxMessages", Schema::Integer },
+    { "MessageQueueMessageSize", Schema::Integer },
+    { "FreeBind", Schema::Boolean },
+    { "Transparent", Schema::Boolean },
+    { "Broadcast", Schema::Boolean },
+    { "PassCredentials", Schema::Boolean },
+    { "PassSecurity", Schema::Boolean },
+    { "PassPacketInfo", Schema::Boolean },
+    { "Timestamping", Schema::Enumeration },
+    { "TCPCongestion", Schema::String },
+    { "ExecStartPre", Schema::CommandLine },
+    { "ExecStartPost", Schema::CommandLine },
+    { "ExecStopPre", Schema::CommandLine },
+    { "ExecStopPost", Schema::CommandLine },
+    { "TimeoutSec", Schema::TimeSpan },
+    { "Service", Schema::UnitList },
+    { "RemoveOnStop", Schema::Boolean },
+    { "FlushPending", Schema::Boolean },
+    { "Symlinks", Schema::Path },
+    { "FileDescriptorName", Schema::String },
+    { "TriggerLimitIntervalSec", Schema::TimeSpan },
+    { "TriggerLimitBurst", Schema::Integer }
+};
+static constexpr KeywordTable<60, 512> socketKeys(socketKeywords);
+
+static constexpr Keyword timerKeywords[] = {
+    { "OnActiveSec", Schema::TimeSpan },
+    { "OnBootSec", Schema::TimeSpan },
+    { "OnStartupSec", Schema::TimeSpan },
+    { "OnUnitActiveSec", Schema::TimeSpan },
+    { "OnUnitInactiveSec", Schema::TimeSpan },
+    { "OnCalendar", Schema::String },
+    { "AccuracySec", Schema::TimeSpan },
+    { "RandomizedDelaySec", Schema::TimeSpan },
+    { "FixedRandomDelay", Schema::Boolean },
+    { "OnClockChange", Schema::Boolean },
+    { "OnTimezoneChange", Schema::Boolean },
+    { "Unit", Schema::UnitList },
+    { "Persistent", Schema::Boolean },
+    { "WakeSystem", Schema::Boolean },
+    { "RemainAfterElapse", Schema::Boolean }
+};
+static constexpr KeywordTable<15, 128> timerKeys(timerKeywords);
+
+static constexpr Keyword pathKeywords[] = {
+    { "PathExists", Schema::Path },
+    { "PathExistsGlob", Schema::Path },
+    { "PathChanged", Schema::Path },
+    { "PathModified", Schema::Path },
+    { "DirectoryNotEmpty", Schema::Path },
+    { "Unit", Schema::UnitList },
+    { "MakeDirectory", Schema::Boolean },
+    { "DirectoryMode", Schema::Integer },
+    { "TriggerLimitIntervalSec", Schema::TimeSpan },
+    { "TriggerLimitBurst", Schema::Integer }
+};
+static constexpr KeywordTable<10, 32> pathKeys(pathKeywords);
+
+static constexpr Keyword mountKeywords[] = {
+    { "What", Schema::String },
+    { "Where", Schema::Path },
+    { "Type", Schema::String },
+    { "Options", Schema::String },
+    { "SloppyOptions", Schema::Boolean },
+    { "LazyUnmount", Schema::Boolean },
+    { "ReadWriteOnly", Schema::Boolean },
+    { "ForceUnmount", Schema::Boolean },
+    { "DirectoryMode", Schema::Integer },
+    { "TimeoutSec", Schema::TimeSpan }
+};
+static constexpr KeywordTable<10, 64> mountKeys(mountKeywords);
+
+static constexpr Keyword automountKeywords[] = {
+    { "Where", Schema::Path },
+    { "ExtraOptions", Schema::String },
+    { "DirectoryMode", Schema::Integer },
+    { "TimeoutIdleSec", Schema::TimeSpan }
+};
+static constexpr KeywordTable<4, 16> automountKeys(automountKeywords);
+
+static constexpr Keyword swapKeywords[] = {
+    { "What", Schema::Path },
+    { "Priority", Schema::Integer },
+    { "Options", Schema::String },
+    { "TimeoutSec", Schema::TimeSpan }
+};
+static constexpr KeywordTable<4, 16> swapKeys(swapKeywords);
+
+static constexpr Keyword scopeKeywords[] = {
+    { "RuntimeMaxSec", Schema::TimeSpan },
+    { "RuntimeRandomizedExtraSec", Schema::TimeSpan },
+    { "TimeoutStopSec", Schema::TimeSpan },
+    { "OOMPolicy", Schema::Enumeration }
+};
+static constexpr KeywordTable<4, 8> scopeKeys(scopeKeywords);
+
+/*
+ * Calls the visitor with the table of a group. The tables differ in type, so this takes the place of an array of them.
+ */
+template<class Visitor>
+static bool visitGroup(int group, Visitor& visitor)
+{
+    switch(group) {
+        case UnitGroup:
+            return visitor(unitKeys);
+        case ConditionGroup:
+            return visitor(conditionKeys);
+        case InstallGroup:
+            return visitor(installKeys);
+        case ExecGroup:
+            return visitor(execKeys);
+        case SandboxGroup:
+            return visitor(sandboxKeys);
+        case KillGroup:
+            return visitor(killKeys);
+        case ResourceGroup:
+            return visitor(resourceKeys);
+        case ServiceGroup:
+            return visitor(serviceKeys);
+        case SocketGroup:
+            return visitor(socketKeys);
+        case TimerGroup:
+            return visitor(timerKeys);
+        case PathGroup:
+            return visitor(pathKeys);
+        case MountGroup:
+            return visitor(mountKeys);
+        case AutomountGroup:
+            return visitor(automountKeys);
+        case SwapGroup:
+            return visitor(swapKeys);
+        case ScopeGroup:
+            return visitor(scopeKeys);
+        default:
+            return false;
+    }
+}
+
+struct KeyLookup
+{
+    const char * key;
+    int size;
+    int value;
+
+    template<int N, int M>
+    bool operator()(const KeywordTable<N, M>& keys)
+    {
+        return keys.lookup(key, size, value);
+    }
+};
+
+static inline char toLower(char c)
+{
+    return c >= 'A' && c <= 'Z' ? (char) (c + ('a' - 'A')) : c;
+}
+
+/*
+ * Finds the keyword closest to a (misspelled) key: the one with the fewest insertions, deletions, substitutions and transpositions of
+ * adjacent characters, ignoring case. Keywords further away than the limit are not considered.
+ */
+struct ClosestKey
+{
+    enum {
+        MaximumSize = 64
+    };
+    const char * key;
+    int size;
+    int limit;
+    const char * closest;
+
+    int distance(const char * name) const
+    {
+        const int length = (int) qstrlen(name);
+        if(length > MaximumSize || qAbs(length - size) > limit) {
+            return limit + 1;
+        }
+        // three rows of the dynamic programming matrix: for the previous but one, the previous and the current character of the key
+        int rows[3][MaximumSize + 1];
+        for(int j = 0; j <= length; ++j) {
+            rows[0][j] = j;
+        }
+        for(int i = 1; i <= size; ++i) {
+            int * before = rows[(i + 1) % 3];
+            int * previous = rows[(i + 2) % 3];
+            int * current = rows[i % 3];
+            current[0] = i;
+            int best = i;
+            for(int j = 1; j <= length; ++j) {
+                const bool same = toLower(key[i - 1]) == toLower(name[j - 1]);
+                int d = qMin(qMin(previous[j] + 1, current[j - 1] + 1), previous[j - 1] + (same ? 0 : 1));
+                if(i > 1 && j > 1 && toLower(key[i - 1]) == toLower(name[j - 2]) && toLower(key[i - 2]) == toLower(name[j - 1])) {
+                    d = qMin(d, before[j - 2] + 1);
+                }
+                current[j] = d;
+                best = qMin(best, d);
+            }
+            if(best > limit) {
+                return limit + 1;
+            }
+        }
+        return rows[size % 3][length];
+    }
+
+    template<int N, int M>
+    bool operator()(const KeywordTable<N, M>& keys)
+    {
+        for(int i = 0; i < keys.size(); ++i) {
+            const int d = distance(keys.at(i).name);
+            if(d <= limit && !(keys.at(i).value & Deprecated)) {
+                closest = keys.at(i).name;
+                limit = d - 1;
+            }
+        }
+        return limit < 0;
+    }
+};
+
+static inline bool isExtension(const char * name, int size)
+{
+    return size > 2 && name[0] == 'X' && name[1] == '-';
+}
+
+/*
+ * Classifies a key given the groups of its section, 0 if the section is not known.
+ */
+static DirectiveSchema::Directive findKey(int groups, const char * key, int size)
+{
+    DirectiveSchema::Directive result = { DirectiveSchema::Unknown, DirectiveSchema::String };
+    if(isExtension(key, size)) {
+        result.status = DirectiveSchema::Extension;
+        return result;
+    }
+    // the groups are probed in the order of their bits, which puts the specific directives of a section before those it shares
+    for(int group = groups & -groups; groups; groups &= ~group, group = groups & -groups) {
+        KeyLookup lookup = { key, size, 0 };
+        if(visitGroup(group, lookup)) {
+            result.status = lookup.value & Deprecated ? DirectiveSchema::Deprecated : DirectiveSchema::Known;
+            result.type = (DirectiveSchema::ValueType) (lookup.value & TypeMask);
+            return result;
+        }
+    }
+    return result;
+}
+
+DirectiveSchema::Directive DirectiveSchema::find(const char * section, int sectionSize, const char * key, int keySize)
+{
+    int groups = 0;
+    if(!sections.lookup(section, sectionSize, groups)) {
+        const Directive result = { isExtension(section, sectionSize) ? Extension : UnknownSection, String };
+        return result;
+    }
+    return findKey(groups, key, keySize);
+}
+
+DirectiveSchema::Directive DirectiveSchema::find(const QByteArray& section, const QByteArray& key)
+{
+    return find(section.constData(), section.size(), key.constData(), key.size());
+}
+
+bool DirectiveSchema::isKnownSection(const char * section, int size)
+{
+    return sections.indexOf(section, size) >= 0;
+}
+
+const char * DirectiveSchema::suggest(const char * section, int sectionSize, const char * key, int keySize)
+{
+    int groups = 0;
+    if(!sections.lookup(section, sectionSize, groups)) {
+        return 0;
+    }
+    ClosestKey closest = { key, keySize, keySize > 4 ? 2 : 1, 0 };
+    for(int group = groups & -groups; groups; groups &= ~group, group = groups & -groups) {
+        if(visitGroup(group, closest)) {
+            break;
+        }
+    }
+    return closest.closest;
+}
+
+const char * DirectiveSchema::manualPage(const char * section, int size)
+{
+    const int i = sections.indexOf(section, size);
+    return i >= 0 ? manualPages[i] : 0;
+}
+
+QVector<DirectiveSchema::Issue> DirectiveSchema::check(const char * utf8, const QVector<TokenSpan>& tokens)
+{
+    QVector<Issue> issues;
+    // -1 until the first section, and for sections whose keys are not checked
+    int groups = -1;
+    for(int i = 0; i < tokens.size(); ++i) {
+        const TokenSpan& token = tokens.at(i);
+        const char * text = utf8 + token.offset;
+        int size = (int) token.length;
+        if(token.kind == TokenSpan::Section) {
+            groups = -1;
+            if(!sections.lookup(text, size, groups) && !isExtension(text, size)) {
+                const Issue issue = { i, UnknownSection };
+                issues << issue;
+            }
+        }
+        else if(token.kind == TokenSpan::Key && groups >= 0) {
+            // whitespace between the key and the '=' is part of the Key token
+            while(size > 0 && (text[size - 1] == ' ' || text[size - 1] == '\t')) {
+                --size;
+            }
+            const Status status = findKey(groups, text, size).status;
+            if(status == Unknown || status == Deprecated) {
+                const Issue issue = { i, status };
+                issues << issue;
+            }
+        }
+    }
+    return issues;
+}
@@ -0,0 +1,85 @@
+#ifndef SD_UIKIT_UNITFILE_DIRECTIVE_SCHEMA
+#define SD_UIKIT_UNITFILE_DIRECTIVE_SCHEMA
+
+#include <QByteArray>
+#include <QVector>
+#include <QtGlobal>
+
+#include "../parser/token.h"
+
+/**
+ * \brief The sections of unit files known to systemd, the keys (directives) which may occur in each of them and the type of their values.
+ * The schema is laid out at compile time in KeywordTable instances, one per group of related directives (e.g. those shared by all units which
+ * run processes), so classifying a key takes a perfect hash lookup in each of the few groups of its section, and no tables are built at runtime.
+ *
+ * As systemd does, sections and keys which start with X- are accepted as extensions without further checks.
+ *
+ * The keys are those which systemd 254 accepts, as listed in its src/core/load-fragment-gperf.gperf.in. Keys which systemd still accepts
+ * but ignores, or which are aliases of newer keys, are Deprecated.
+ */
+class DirectiveSchema
+{
+public:
+    enum ValueType {
+        String = 0,
+        Boolean, /* see ValueParser::parseBoolean() */
+        Integer,
+        Size, /* see ValueParser::parseSize() */
+        TimeSpan, /* see ValueParser::parseTimeSpan() */
+        Enumeration, /* one of a fixed set of keywords, such as Restart=on-failure */
+        UnitList, /* a whitespace separated list of unit names */
+        Path,
+        CommandLine,
+        Environment
+    };
+    enum Status {
+        Known = 0,
+        Deprecated, /* the key is still understood, but superseded by another one or no longer has any effect */
+        Unknown, /* the key is not valid in its section */
+        UnknownSection, /* the section is not a section systemd knows about */
+        Extension /* an X- section or key */
+    };
+    struct Directive {
+        Status status;
+        /**
+         * \brief the type of the value, String if the directive is not known.
+         */
+        ValueType type;
+    };
+    /**
+     * \brief a key or section which is not known, as found by #check().
+     */
+    struct Issue {
+        /**
+         * \brief the index of the Key or Section token.
+         */
+        qint32 token;
+        Status status;
+    };
+
+    /**
+     * \brief classifies a key in a section.
+     */
+    static Directive find(const char * section, int sectionSize, const char * key, int keySize);
+    static Directive find(const QByteArray& section, const QByteArray& key);
+    static bool isKnownSection(const char * section, int size);
+    /**
+     * \brief finds the known key which a misspelled or wrongly capitalised key was most likely meant to be, e.g. Restart for Restrt.
+     * \return the name of the key, or 0 if no key in the section is close enough.
+     */
+    static const char * suggest(const char * section, int sectionSize, const char * key, int keySize);
+    /**
+     * \brief the reference to the manual page which documents a section, e.g. man:systemd.service(5).
+     * \return the reference, or 0 if the section is not known.
+     */
+    static const char * manualPage(const char * section, int size);
+    /**
+     * \brief classifies all keys and sections in the output of Tokeniser::tokenise(const QByteArray&, const Tokeniser::LineEnding&, QVector<ByteRange>*).
+     * \return the sections and keys which are not Known (nor an Extension), in order. Keys in unknown sections are not reported one by one.
+     */
+    static QVector<Issue> check(const char * utf8, const QVector<TokenSpan>& tokens);
+};
+
+Q_DECLARE_TYPEINFO(DirectiveSchema::Issue, Q_PRIMITIVE_TYPE);
+
+#endif
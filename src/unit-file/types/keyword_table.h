@@ -0,0 +1,195 @@
+#ifndef SD_UIKIT_UNITFILE_KEYWORD_TABLE
+#define SD_UIKIT_UNITFILE_KEYWORD_TABLE
+
+#include <QByteArray>
+#include <QtGlobal>
+
+/**
+ * \brief a keyword which may occur in a value, e.g. on-failure in Restart=on-failure, and what it stands for.
+ */
+struct Keyword
+{
+    const char * name;
+    int value;
+};
+
+/**
+ * \brief The hash function used by KeywordTable: FNV-1a over the bytes of a name.
+ * A table picks the slot of a name by mixing its hash with a seed, so the hash itself is computed once per keyword, however many seeds are tried.
+ * The constexpr overload works on NUL terminated names, so tables can be laid out by the compiler.
+ */
+struct KeywordHash
+{
+    static constexpr quint32 step(quint32 h, char c)
+    {
+        return (h ^ (quint8) c) * 16777619u;
+    }
+    static constexpr quint32 hash(const char * name, quint32 h = 2166136261u)
+    {
+        return *name ? hash(name + 1, step(h, *name)) : h;
+    }
+    static inline quint32 hash(const char * text, int size)
+    {
+        quint32 h = 2166136261u;
+        for(int i = 0; i < size; ++i) {
+            h = step(h, text[i]);
+        }
+        return h;
+    }
+    /*
+     * The finaliser of MurmurHash3: the low bits of FNV-1a only depend on the low bits of the input, so the hash is mixed before it is used to pick a slot.
+     */
+    static constexpr quint32 mix(quint32 h)
+    {
+        return fold(fold(fold(h, 16) * 0x85EBCA6Bu, 13) * 0xC2B2AE35u, 16);
+    }
+    static constexpr quint32 slot(quint32 h, quint32 seed, int tableSize)
+    {
+        return mix(h ^ (seed * 0x9E3779B9u)) & (quint32) (tableSize - 1);
+    }
+    static inline bool equals(const char * name, const char * text, int size)
+    {
+        for(int i = 0; i < size; ++i) {
+            if(name[i] != text[i] || !name[i]) {
+                return false;
+            }
+        }
+        return !name[size];
+    }
+private:
+    static constexpr quint32 fold(quint32 h, int shift)
+    {
+        return h ^ (h >> shift);
+    }
+};
+
+/*
+ * Never defined: it is called when evaluating a KeywordTable in a constant expression fails to find a perfect hash, which turns that into a compile error.
+ */
+quint32 keywordTableHasNoPerfectHash(void);
+
+/*
+ * The list of indices 0 up to N, for expanding into the elements of an array. It is built in halves, so large tables stay well within the
+ * compiler's limit on nested template instantiations.
+ */
+template<int... I> struct KeywordIndexList {};
+template<class A, class B> struct KeywordIndexConcat;
+template<int... I, int... J> struct KeywordIndexConcat<KeywordIndexList<I...>, KeywordIndexList<J...> >
+{
+    typedef KeywordIndexList<I..., (int) sizeof...(I) + J...> Type;
+};
+template<int N> struct MakeKeywordIndexList
+{
+    typedef typename KeywordIndexConcat<typename MakeKeywordIndexList<N / 2>::Type, typename MakeKeywordIndexList<N - N / 2>::Type>::Type Type;
+};
+template<> struct MakeKeywordIndexList<0>
+{
+    typedef KeywordIndexList<> Type;
+};
+template<> struct MakeKeywordIndexList<1>
+{
+    typedef KeywordIndexList<0> Type;
+};
+
+/**
+ * \brief A table of N keywords, laid out at compile time as a perfect hash table of M slots.
+ * The compiler searches for a seed for which the hash of every keyword ends up in a slot of its own, so looking up a word takes one hash and
+ * at most one comparison (which is skipped unless the full hash matches as well), and the table needs no construction at runtime. Tables should be declared constexpr:
+ *
+ *     static constexpr Keyword restartKeywords[] = { { "no", 0 }, { "always", 1 }, ... };
+ *     static constexpr KeywordTable<7, 16> restartModes(restartKeywords);
+ *
+ * M must be a power of two, and at least N. If no seed is found, compilation fails with a call to keywordTableHasNoPerfectHash(): use a larger M.
+ */
+template<int N, int M>
+class KeywordTable
+{
+    static_assert(N > 0 && M >= N && M <= 0x8000 && (M & (M - 1)) == 0, "KeywordTable: M must be a power of two, and at least N");
+public:
+    constexpr KeywordTable(const Keyword (&keywords)[N]) : KeywordTable(keywords, typename MakeKeywordIndexList<N>::Type()) {}
+    /**
+     * \brief the index of the keyword which matches the text exactly.
+     * \return the index, or -1 if the text is not a keyword.
+     */
+    inline int indexOf(const char * text, int size) const
+    {
+        const quint32 h = KeywordHash::hash(text, size);
+        const int i = m_slots[KeywordHash::slot(h, m_seed, M)];
+        return i >= 0 && m_hashes.values[i] == h && KeywordHash::equals(m_keywords[i].name, text, size) ? i : -1;
+    }
+    inline int indexOf(const QByteArray& text) const
+    {
+        return indexOf(text.constData(), text.size());
+    }
+    /**
+     * \brief looks up the value of a keyword.
+     * \return false if the text is not a keyword, in which case value is left alone.
+     */
+    inline bool lookup(const char * text, int size, int& value) const
+    {
+        const int i = indexOf(text, size);
+        if(i < 0) {
+            return false;
+        }
+        value = m_keywords[i].value;
+        return true;
+    }
+    inline const Keyword& at(int i) const
+    {
+        return m_keywords[i];
+    }
+    constexpr int size(void) const
+    {
+        return N;
+    }
+private:
+    enum {
+        MaximumSeed = 256
+    };
+    struct Hashes {
+        quint32 values[N];
+    };
+
+    template<int... I>
+    constexpr KeywordTable(const Keyword (&keywords)[N], KeywordIndexList<I...>) :
+        KeywordTable(keywords, Hashes { { KeywordHash::hash(keywords[I].name)... } }) {}
+    constexpr KeywordTable(const Keyword (&keywords)[N], const Hashes& hashes) :
+        KeywordTable(keywords, hashes, findSeed(hashes, 0), typename MakeKeywordIndexList<M>::Type()) {}
+    template<int... S>
+    constexpr KeywordTable(const Keyword (&keywords)[N], const Hashes& hashes, quint32 seed, KeywordIndexList<S...>) :
+        m_keywords(keywords), m_hashes(hashes), m_seed(seed), m_slots { (qint16) entryAt(hashes, seed, S, 0, N)... } {}
+
+    /*
+     * The searches below split their range in two rather than recursing once per keyword, so the compiler's limit on recursion is never reached.
+     */
+    static constexpr int either(int a, int b)
+    {
+        return a >= 0 ? a : b;
+    }
+    static constexpr int entryAt(const Hashes& hashes, quint32 seed, int slot, int from, int to)
+    {
+        return to - from > 1 ? either(entryAt(hashes, seed, slot, from, (from + to) / 2), entryAt(hashes, seed, slot, (from + to) / 2, to)) :
+            from < to && KeywordHash::slot(hashes.values[from], seed, M) == (quint32) slot ? from : -1;
+    }
+    static constexpr bool isAlone(const Hashes& hashes, quint32 seed, quint32 slot, int from, int to)
+    {
+        return to - from > 1 ? isAlone(hashes, seed, slot, from, (from + to) / 2) && isAlone(hashes, seed, slot, (from + to) / 2, to) :
+            from >= to || KeywordHash::slot(hashes.values[from], seed, M) != slot;
+    }
+    static constexpr bool isPerfect(const Hashes& hashes, quint32 seed, int from, int to)
+    {
+        return to - from > 1 ? isPerfect(hashes, seed, from, (from + to) / 2) && isPerfect(hashes, seed, (from + to) / 2, to) :
+            from >= to || isAlone(hashes, seed, KeywordHash::slot(hashes.values[from], seed, M), from + 1, N);
+    }
+    static constexpr quint32 findSeed(const Hashes& hashes, quint32 seed)
+    {
+        return seed == MaximumSeed ? keywordTableHasNoPerfectHash() : isPerfect(hashes, seed, 0, N) ? seed : findSeed(hashes, seed + 1);
+    }
+private:
+    const Keyword * m_keywords;
+    Hashes m_hashes;
+    quint32 m_seed;
+    qint16 m_slots[M];
+};
+
+#endif
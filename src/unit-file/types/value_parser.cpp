@@ -0,0 +1,318 @@
+#include "value_parser.h"
+
+const quint64 ValueParser::Infinity;
+const quint64 ValueParser::usecPerSecond;
+
+static constexpr Keyword booleanKeywords[] = {
+    { "1", 1 }, { "yes", 1 }, { "y", 1 }, { "true", 1 }, { "t", 1 }, { "on", 1 },
+    { "0", 0 }, { "no", 0 }, { "n", 0 }, { "false", 0 }, { "f", 0 }, { "off", 0 }
+};
+static constexpr KeywordTable<12, 32> booleans(booleanKeywords);
+
+/*
+ * Units of time spans, as understood by systemd. The values are indices into usecPerUnit.
+ */
+enum TimeUnit {
+    Microseconds = 0,
+    Milliseconds,
+    Seconds,
+    Minutes,
+    Hours,
+    Days,
+    Weeks,
+    Months,
+    Years
+};
+
+static const quint64 usecPerUnit[] = {
+    Q_UINT64_C(1),
+    Q_UINT64_C(1000),
+    Q_UINT64_C(1000000),
+    Q_UINT64_C(60000000),
+    Q_UINT64_C(3600000000),
+    Q_UINT64_C(86400000000),
+    Q_UINT64_C(604800000000),
+    Q_UINT64_C(2629800000000), /* 30.44 days */
+    Q_UINT64_C(31557600000000) /* 365.25 days */
+};
+
+static constexpr Keyword timeUnitKeywords[] = {
+    { "usec", Microseconds }, { "us", Microseconds }, { "\xC2\xB5s", Microseconds },
+    { "msec", Milliseconds }, { "ms", Milliseconds },
+    { "seconds", Seconds }, { "second", Seconds }, { "sec", Seconds }, { "s", Seconds },
+    { "minutes", Minutes }, { "minute", Minutes }, { "min", Minutes }, { "m", Minutes },
+    { "hours", Hours }, { "hour", Hours }, { "hr", Hours }, { "h", Hours },
+    { "days", Days }, { "day", Days }, { "d", Days },
+    { "weeks", Weeks }, { "week", Weeks }, { "w", Weeks },
+    { "months", Months }, { "month", Months }, { "M", Months },
+    { "years", Years }, { "year", Years }, { "y", Years }
+};
+static constexpr KeywordTable<29, 128> timeUnits(timeUnitKeywords);
+
+/*
+ * The power of the base each size suffix stands for, indexed by the letter: B, K, M, G, T, P and E. -1 for letters which are not a suffix.
+ */
+static const qint8 sizeSuffixPowers[26] = {
+    -1, 0, -1, -1, 6, -1, 3, -1, -1, -1, 1, -1, 2, -1, -1, 5, -1, -1, -1, 4, -1, -1, -1, -1, -1, -1
+};
+
+static const quint64 siPowers[] = {
+    Q_UINT64_C(1), Q_UINT64_C(1000), Q_UINT64_C(1000000), Q_UINT64_C(1000000000), Q_UINT64_C(1000000000000),
+    Q_UINT64_C(1000000000000000), Q_UINT64_C(1000000000000000000)
+};
+
+static const quint64 iecPowers[] = {
+    Q_UINT64_C(1), Q_UINT64_C(1) << 10, Q_UINT64_C(1) << 20, Q_UINT64_C(1) << 30, Q_UINT64_C(1) << 40, Q_UINT64_C(1) << 50, Q_UINT64_C(1) << 60
+};
+
+static constexpr Keyword serviceTypeKeywords[] = {
+    { "simple", ValueParser::Simple },
+    { "exec", ValueParser::Exec },
+    { "forking", ValueParser::Forking },
+    { "oneshot", ValueParser::OneShot },
+    { "dbus", ValueParser::DBus },
+    { "notify", ValueParser::Notify },
+    { "idle", ValueParser::Idle }
+};
+constexpr KeywordTable<7, 16> ValueParser::serviceTypes(serviceTypeKeywords);
+
+static constexpr Keyword restartKeywords[] = {
+    { "no", ValueParser::RestartNo },
+    { "on-success", ValueParser::RestartOnSuccess },
+    { "on-failure", ValueParser::RestartOnFailure },
+    { "on-abnormal", ValueParser::RestartOnAbnormal },
+    { "on-watchdog", ValueParser::RestartOnWatchdog },
+    { "on-abort", ValueParser::RestartOnAbort },
+    { "always", ValueParser::RestartAlways }
+};
+constexpr KeywordTable<7, 16> ValueParser::restartModes(restartKeywords);
+
+static constexpr Keyword killModeKeywords[] = {
+    { "control-group", ValueParser::KillControlGroup },
+    { "mixed", ValueParser::KillMixed },
+    { "process", ValueParser::KillProcess },
+    { "none", ValueParser::KillNone }
+};
+constexpr KeywordTable<4, 8> ValueParser::killModes(killModeKeywords);
+
+static constexpr Keyword notifyAccessKeywords[] = {
+    { "none", ValueParser::NotifyNone },
+    { "main", ValueParser::NotifyMain },
+    { "exec", ValueParser::NotifyExec },
+    { "all", ValueParser::NotifyAll }
+};
+constexpr KeywordTable<4, 8> ValueParser::notifyAccess(notifyAccessKeywords);
+
+static constexpr Keyword secureBitKeywords[] = {
+    { "keep-caps", ValueParser::KeepCaps },
+    { "keep-caps-locked", ValueParser::KeepCapsLocked },
+    { "no-setuid-fixup", ValueParser::NoSetuidFixup },
+    { "no-setuid-fixup-locked", ValueParser::NoSetuidFixupLocked },
+    { "noroot", ValueParser::NoRoot },
+    { "noroot-locked", ValueParser::NoRootLocked }
+};
+constexpr KeywordTable<6, 16> ValueParser::secureBits(secureBitKeywords);
+
+static inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/*
+ * A number with an optional fraction, as it occurs in sizes and time spans: digits, optionally followed by a '.' and more digits.
+ */
+struct Number
+{
+    quint64 whole;
+    const char * fraction;
+    const char * fractionEnd;
+
+    bool parse(const char *& p, const char * end)
+    {
+        if(p == end || !isDigit(*p)) {
+            return false;
+        }
+        whole = 0;
+        for(; p < end && isDigit(*p); ++p) {
+            const quint64 digit = (quint64) (*p - '0');
+            if(whole > (ValueParser::Infinity - digit) / 10) {
+                return false;
+            }
+            whole = whole * 10 + digit;
+        }
+        fraction = fractionEnd = p;
+        if(p < end && *p == '.') {
+            for(fraction = ++p; p < end && isDigit(*p); ++p) {}
+            fractionEnd = p;
+        }
+        return true;
+    }
+
+    /*
+     * Multiplies the number by a unit, and adds it to total. Like systemd does for time spans, each digit of the fraction is worth a tenth
+     * of the previous one, rounded down: digits beyond the precision of the unit are ignored.
+     * Returns false on overflow.
+     */
+    bool addTo(quint64& total, quint64 unit) const
+    {
+        quint64 term;
+        if(!multiply(unit, term)) {
+            return false;
+        }
+        quint64 part = 0;
+        for(const char * digit = fraction; digit < fractionEnd && unit; ++digit) {
+            unit /= 10;
+            part += (quint64) (*digit - '0') * unit;
+        }
+        return add(total, term) && add(total, part);
+    }
+
+    /*
+     * Like addTo(), but the fraction is taken as a whole, as systemd does for sizes: 1.5K is exactly 1536 bytes.
+     * Only the first 9 digits of the fraction count, which keeps the arithmetic within 64 bits.
+     */
+    bool addExactlyTo(quint64& total, quint64 unit) const
+    {
+        quint64 term;
+        if(!multiply(unit, term)) {
+            return false;
+        }
+        quint64 digits = 0, scale = 1;
+        for(const char * digit = fraction; digit < fractionEnd && scale < Q_UINT64_C(1000000000); ++digit) {
+            digits = digits * 10 + (quint64) (*digit - '0');
+            scale *= 10;
+        }
+        // unit * digits / scale, without overflowing: digits < scale
+        return add(total, term) && add(total, digits * (unit / scale) + digits * (unit % scale) / scale);
+    }
+
+private:
+    bool multiply(quint64 unit, quint64& product) const
+    {
+        if(unit && whole > ValueParser::Infinity / unit) {
+            return false;
+        }
+        product = whole * unit;
+        return true;
+    }
+
+    static bool add(quint64& total, quint64 term)
+    {
+        if(term > ValueParser::Infinity - total) {
+            return false;
+        }
+        total += term;
+        return true;
+    }
+};
+
+bool ValueParser::parseBoolean(const char * text, int size, bool& value)
+{
+    const char * end = trimSpace(text, text + size);
+    text = skipSpace(text, end);
+    char lower[5];
+    const int length = (int) (end - text);
+    if(length > (int) sizeof(lower)) {
+        return false;
+    }
+    for(int i = 0; i < length; ++i) {
+        lower[i] = text[i] >= 'A' && text[i] <= 'Z' ? (char) (text[i] + ('a' - 'A')) : text[i];
+    }
+    int result;
+    if(!booleans.lookup(lower, length, result)) {
+        return false;
+    }
+    value = result != 0;
+    return true;
+}
+
+bool ValueParser::parseSize(const char * text, int size, SizeBase base, quint64& bytes)
+{
+    const quint64 * powers = base == SI ? siPowers : iecPowers;
+    const char * end = trimSpace(text, text + size);
+    const char * p = skipSpace(text, end);
+    if(p == end) {
+        return false;
+    }
+    quint64 total = 0;
+    while(p < end) {
+        Number number;
+        if(!number.parse(p, end)) {
+            return false;
+        }
+        p = skipSpace(p, end);
+        int power = 0;
+        if(p < end && *p >= 'A' && *p <= 'Z') {
+            power = sizeSuffixPowers[*p - 'A'];
+            if(power < 0) {
+                return false;
+            }
+            ++p;
+        }
+        if(!number.addExactlyTo(total, powers[power])) {
+            return false;
+        }
+        p = skipSpace(p, end);
+    }
+    bytes = total;
+    return true;
+}
+
+static inline bool isUnitChar(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c & 0x80);
+}
+
+bool ValueParser::parseTimeSpan(const char * text, int size, quint64& usec, quint64 defaultUnit)
+{
+    const char * end = trimSpace(text, text + size);
+    const char * p = skipSpace(text, end);
+    if(p == end) {
+        return false;
+    }
+    if(KeywordHash::equals("infinity", p, (int) (end - p))) {
+        usec = Infinity;
+        return true;
+    }
+    quint64 total = 0;
+    while(p < end) {
+        Number number;
+        if(!number.parse(p, end)) {
+            return false;
+        }
+        p = skipSpace(p, end);
+        const char * unit = p;
+        while(p < end && isUnitChar(*p)) {
+            ++p;
+        }
+        quint64 multiplier = defaultUnit;
+        if(p > unit) {
+            int index;
+            if(!timeUnits.lookup(unit, (int) (p - unit), index)) {
+                return false;
+            }
+            multiplier = usecPerUnit[index];
+        }
+        if(!number.addTo(total, multiplier)) {
+            return false;
+        }
+        p = skipSpace(p, end);
+    }
+    usec = total;
+    return true;
+}
+
+bool ValueParser::parseBoolean(const QByteArray& text, bool& value)
+{
+    return parseBoolean(text.constData(), text.size(), value);
+}
+
+bool ValueParser::parseSize(const QByteArray& text, SizeBase base, quint64& bytes)
+{
+    return parseSize(text.constData(), text.size(), base, bytes);
+}
+
+bool ValueParser::parseTimeSpan(const QByteArray& text, quint64& usec, quint64 defaultUnit)
+{
+    return parseTimeSpan(text.constData(), text.size(), usec, defaultUnit);
+}
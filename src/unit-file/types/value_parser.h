@@ -0,0 +1,160 @@
+#ifndef SD_UIKIT_UNITFILE_VALUE_PARSER
+#define SD_UIKIT_UNITFILE_VALUE_PARSER
+
+#include <QByteArray>
+#include <QtGlobal>
+
+#include "keyword_table.h"
+
+/**
+ * \brief Parsers for the types of values found in unit files, following the rules systemd uses.
+ * All parsers work directly on UTF-8 text (such as UnitFile::rawValue()) and never allocate. Leading and trailing whitespace is ignored.
+ * Each returns false if the text is not a valid value of its type, in which case the output is left alone.
+ */
+class ValueParser
+{
+public:
+    enum SizeBase {
+        SI = 1000, /* si_size: K is 1000 bytes */
+        IEC = 1024 /* iec_size: K is 1024 bytes */
+    };
+    enum ServiceType {
+        Simple = 0,
+        Exec,
+        Forking,
+        OneShot,
+        DBus,
+        Notify,
+        Idle
+    };
+    enum RestartMode {
+        RestartNo = 0,
+        RestartOnSuccess,
+        RestartOnFailure,
+        RestartOnAbnormal,
+        RestartOnWatchdog,
+        RestartOnAbort,
+        RestartAlways
+    };
+    enum KillMode {
+        KillControlGroup = 0,
+        KillMixed,
+        KillProcess,
+        KillNone
+    };
+    enum NotifyAccess {
+        NotifyNone = 0,
+        NotifyMain,
+        NotifyExec,
+        NotifyAll
+    };
+    enum SecureBit {
+        KeepCaps = 0x1,
+        KeepCapsLocked = 0x2,
+        NoSetuidFixup = 0x4,
+        NoSetuidFixupLocked = 0x8,
+        NoRoot = 0x10,
+        NoRootLocked = 0x20
+    };
+
+    /**
+     * \brief the time span which stands for "infinity", i.e. no timeout at all.
+     */
+    static const quint64 Infinity = Q_UINT64_C(0xFFFFFFFFFFFFFFFF);
+    static const quint64 usecPerSecond = Q_UINT64_C(1000000);
+
+    /**
+     * \brief parses a boolean: 1, yes, y, true, t or on, and 0, no, n, false, f or off, in any case.
+     */
+    static bool parseBoolean(const char * text, int size, bool& value);
+    /**
+     * \brief parses a size in bytes, e.g. 512, 64K or 1.5G. The suffixes K, M, G, T, P and E stand for powers of the base, and B for bytes.
+     * Several terms may be given, which are added up: 1G 512M.
+     */
+    static bool parseSize(const char * text, int size, SizeBase base, quint64& bytes);
+    /**
+     * \brief parses a time span into microseconds, e.g. 90, 5min 20s, 1.5h or infinity.
+     * Terms without a unit are in defaultUnit microseconds, i.e. seconds unless stated otherwise.
+     */
+    static bool parseTimeSpan(const char * text, int size, quint64& usec, quint64 defaultUnit = usecPerSecond);
+    /**
+     * \brief parses a single keyword from a table.
+     */
+    template<int N, int M>
+    static bool parseEnum(const char * text, int size, const KeywordTable<N, M>& keywords, int& value)
+    {
+        const char * end = text + size;
+        text = skipSpace(text, end);
+        end = trimSpace(text, end);
+        return keywords.lookup(text, (int) (end - text), value);
+    }
+    /**
+     * \brief parses a whitespace separated list of keywords from a table, whose values are bits which are combined into a mask.
+     */
+    template<int N, int M>
+    static bool parseBitmask(const char * text, int size, const KeywordTable<N, M>& keywords, int& mask)
+    {
+        const char * end = text + size;
+        int result = 0;
+        for(const char * word = skipSpace(text, end); word < end; word = skipSpace(word, end)) {
+            const char * wordEnd = word;
+            while(wordEnd < end && !isSpace(*wordEnd)) {
+                ++wordEnd;
+            }
+            int bit;
+            if(!keywords.lookup(word, (int) (wordEnd - word), bit)) {
+                return false;
+            }
+            result |= bit;
+            word = wordEnd;
+        }
+        mask = result;
+        return true;
+    }
+
+    static bool parseBoolean(const QByteArray& text, bool& value);
+    static bool parseSize(const QByteArray& text, SizeBase base, quint64& bytes);
+    static bool parseTimeSpan(const QByteArray& text, quint64& usec, quint64 defaultUnit = usecPerSecond);
+
+    /**
+     * \brief Type= of services.
+     */
+    static const KeywordTable<7, 16> serviceTypes;
+    /**
+     * \brief Restart= of services.
+     */
+    static const KeywordTable<7, 16> restartModes;
+    /**
+     * \brief KillMode=.
+     */
+    static const KeywordTable<4, 8> killModes;
+    /**
+     * \brief NotifyAccess= of services.
+     */
+    static const KeywordTable<4, 8> notifyAccess;
+    /**
+     * \brief SecureBits=, whose values are SecureBit flags.
+     */
+    static const KeywordTable<6, 16> secureBits;
+private:
+    static inline bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+    static inline const char * skipSpace(const char * text, const char * end)
+    {
+        while(text < end && isSpace(*text)) {
+            ++text;
+        }
+        return text;
+    }
+    static inline const char * trimSpace(const char * begin, const char * end)
+    {
+        while(end > begin && isSpace(end[-1])) {
+            --end;
+        }
+        return end;
+    }
+};
+
+#endif
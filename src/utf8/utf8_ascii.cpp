@@ -0,0 +1,64 @@
+#include "utf8_ascii.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SD_UIKIT_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+qint64 scanAsciiScalar(const uchar * data, qint64 length)
+{
+    qint64 i = 0;
+    while(i < length && data[i] < 0x80) {
+        ++i;
+    }
+    return i;
+}
+
+#if defined(SD_UIKIT_X86_DISPATCH) && defined(__SSE2__)
+/*
+ * SSE2 is part of the x86-64 baseline, so this does not need a runtime check there.
+ * The high bit of every byte is gathered into a mask: the first set bit is the first non-ASCII byte.
+ */
+static qint64 scanAsciiSSE2(const uchar * data, qint64 length)
+{
+    qint64 i = 0;
+    for(; i + 16 <= length; i += 16) {
+        int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i)));
+        if(mask) {
+            return i + __builtin_ctz((unsigned) mask);
+        }
+    }
+    return i + scanAsciiScalar(data + i, length - i);
+}
+#endif
+
+#if defined(SD_UIKIT_X86_DISPATCH)
+/*
+ * Compiled for AVX2 regardless of the flags used for the rest of the library; only ever called if the CPU reports AVX2 support.
+ */
+__attribute__((target("avx2")))
+static qint64 scanAsciiAVX2(const uchar * data, qint64 length)
+{
+    qint64 i = 0;
+    for(; i + 32 <= length; i += 32) {
+        unsigned mask = (unsigned) _mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i)));
+        if(mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + scanAsciiScalar(data + i, length - i);
+}
+#endif
+
+AsciiScanner vectorisedAsciiScanner(void)
+{
+#if defined(SD_UIKIT_X86_DISPATCH)
+    if(__builtin_cpu_supports("avx2")) {
+        return scanAsciiAVX2;
+    }
+#if defined(__SSE2__)
+    return scanAsciiSSE2;
+#endif
+#endif
+    return scanAsciiScalar;
+}
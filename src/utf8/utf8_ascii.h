@@ -0,0 +1,24 @@
+#ifndef SD_UIKIT_UTF8_ASCII_H
+#define SD_UIKIT_UTF8_ASCII_H
+
+#include <QtGlobal>
+
+/**
+ * \brief function type used to skip a run of plain ASCII bytes.
+ * \return the number of leading bytes (at most length) which do not have their high bit set.
+ */
+typedef qint64 (*AsciiScanner)(const uchar * data, qint64 length);
+
+/**
+ * \brief portable implementation which inspects one byte at a time.
+ */
+qint64 scanAsciiScalar(const uchar * data, qint64 length);
+
+/**
+ * \brief selects the fastest ASCII scanner supported by the CPU at runtime.
+ * On x86 this is AVX2 (32 bytes per step) if the CPU supports it, otherwise SSE2 (16 bytes per step).
+ * Other platforms get #scanAsciiScalar(const uchar*, qint64).
+ */
+AsciiScanner vectorisedAsciiScanner(void);
+
+#endif
@@ -1,8 +1,17 @@
 
 #include "utf8_reader.h"
+#include "utf8_validator.h"
+#include "../tracing.h"
+#include <QList>
+#include <QMetaMethod>
 #include <QTextStream>
 #include <QString>
-#include <QtDebug>
+#include <QTimer>
+#include <cstring>
+
+#ifdef SDUIKIT_TRACING
+Q_LOGGING_CATEGORY(utf8Trace, "sduikit.utf8.trace", QtWarningMsg)
+#endif
 
 #define COUNT_UTF8_BYTE(cP, l, sz) ((cP) <= (l) ? (sz) : (sz + 1))
 
@@ -21,11 +30,496 @@ static inline qint64 utf8SequenceLength(uint codePoint)
 
 typedef enum { Clear = 0, Hi, Low, SurrogatePair } UTFState;
 
-UTF8Reader::UTF8Reader(QObject * parent) : QObject(parent) {}
+static const qint64 blockSize = 16384;
+
+/*
+ * The number of blocks read while streaming before control is returned to the event loop.
+ */
+static const int blocksPerPass = 4;
+
+class ReaderStream;
+
+class UTF8ReaderPrivate {
+public:
+    UTF8ReaderPrivate(const UTF8Reader::Mode& mode) : m_mode(mode), m_recovery(UTF8Reader::Seek), m_stream(0), m_maximumPending(0) {}
+    UTF8Reader::Mode m_mode;
+    UTF8Reader::Recovery m_recovery;
+    ReaderStream * m_stream;
+    qint64 m_maximumPending;
+};
+
+/*
+ * A read-ahead window over a QIODevice which never seeks: bytes are only ever read once and consumed from the front.
+ * This works on sequential devices and makes skipping an invalid byte as cheap as skipping a valid one.
+ */
+class LookaheadBuffer
+{
+public:
+    LookaheadBuffer(QIODevice * input) : m_input(input), m_buffer((int) blockSize, Qt::Uninitialized), m_pos(0), m_size(0), m_eof(false), m_error(false) {}
+    const char * data(void) const { return m_buffer.constData() + m_pos; }
+    bool error(void) const { return m_error; }
+    void advance(int count) { m_pos += count; }
+
+    /*
+     * Makes at least count bytes available, unless input is exhausted first.
+     * Returns the number of bytes available.
+     */
+    int ensure(int count)
+    {
+        if(m_size - m_pos >= count || m_eof) {
+            return m_size - m_pos;
+        }
+        m_size -= m_pos;
+        memmove(m_buffer.data(), m_buffer.constData() + m_pos, m_size);
+        m_pos = 0;
+        while(m_size < count && !m_eof) {
+            qint64 read = m_input->read(m_buffer.data() + m_size, m_buffer.size() - m_size);
+            if(read > 0) {
+                m_size += (int) read;
+            }
+            else if(read < 0) {
+                m_error = m_eof = true;
+            }
+            // nothing to read right now: sequential devices may yet produce more data
+            else if(!m_input->isSequential() || !m_input->waitForReadyRead(-1)) {
+                m_eof = true;
+            }
+        }
+        return m_size;
+    }
+private:
+    QIODevice * const m_input;
+    QByteArray m_buffer;
+    int m_pos, m_size;
+    bool m_eof, m_error;
+};
+
+/*
+ * Translates the results of UTF8Validator into UTF8Reader signals.
+ * Runs of invalid bytes are buffered until valid data follows (or input ends), so they are reported the same way as in TextStream mode.
+ */
+class ReaderSink: public UTF8Validator::Sink
+{
+public:
+    ReaderSink(UTF8Reader * reader, qint64 offset, bool pushChunks, bool pushChars, int maximumBadBytes = 0) :
+        m_reader(reader), m_offset(offset), m_badOffset(0), m_pushed(0), m_hasBadBytes(false), m_pushChunks(pushChunks), m_pushChars(pushChars),
+        m_maximumBadBytes(maximumBadBytes) {}
+    bool hasBadBytes(void) const { return m_hasBadBytes; }
+    /*
+     * The number of QChar pushed so far.
+     */
+    qint64 pushed(void) const { return m_pushed; }
+
+    void valid(const char * data, qint64 length, qint64 offset) Q_DECL_OVERRIDE
+    {
+        flushBadBytes();
+        SDUIKIT_TRACE(utf8Trace) << "Pushing" << length << "valid bytes at:" << m_offset + offset;
+        const QString text = QString::fromUtf8(data, (int) length);
+        m_pushed += text.size();
+        if(m_pushChunks) {
+            emit m_reader->pushChunk(text);
+        }
+        if(!m_pushChars) {
+            return;
+        }
+        const QChar * c = text.constData(), * end = c + text.size();
+        for(; c < end; ++c) {
+            // input is known to be valid: a high surrogate is always followed by its low surrogate
+            if(c->isHighSurrogate()) {
+                emit m_reader->pushPair(c[0], c[1]);
+                ++c;
+            }
+            else {
+                emit m_reader->push(*c);
+            }
+        }
+    }
+
+    void invalid(const char * data, qint64 length, qint64 offset) Q_DECL_OVERRIDE
+    {
+        // a run of invalid bytes may be reported in parts, rather than be buffered without bound
+        if(m_maximumBadBytes > 0 && m_badBytes.size() >= m_maximumBadBytes) {
+            flushBadBytes();
+        }
+        if(m_badBytes.isEmpty()) {
+            m_badOffset = offset;
+        }
+        m_badBytes.append(data, (int) length);
+        m_hasBadBytes = true;
+    }
+
+    void flushBadBytes(void)
+    {
+        if(m_badBytes.size() > 0) {
+            SDUIKIT_TRACE(utf8Trace) << "Reporting" << m_badBytes.size() << "invalid bytes at:" << m_offset + m_badOffset;
+            emit m_reader->reportBytes(m_badBytes, m_badOffset, m_offset + m_badOffset);
+            m_badBytes.clear();
+        }
+    }
+private:
+    UTF8Reader * const m_reader;
+    const qint64 m_offset;
+    qint64 m_badOffset, m_pushed;
+    bool m_hasBadBytes;
+    const bool m_pushChunks, m_pushChars;
+    const int m_maximumBadBytes;
+    QByteArray m_badBytes;
+};
+
+/*
+ * The state kept while streaming from a device: everything which must carry over from one read to the next.
+ * The validator holds on to a sequence which straddles two reads, and the sink to a run of invalid bytes which may yet continue.
+ */
+class ReaderStream
+{
+public:
+    ReaderStream(UTF8Reader * reader, QIODevice * input, UTF8Validator::Strategy strategy, bool pushChunks, bool pushChars) :
+        m_input(input), m_sink(reader, input->isSequential() ? 0 : input->pos(), pushChunks, pushChars, (int) blockSize), m_validator(strategy),
+        m_block((int) blockSize, Qt::Uninitialized), m_acknowledged(0), m_finished(false), m_closing(false), m_paused(false), m_scheduled(false),
+        m_reading(false) {}
+
+    ~ReaderStream()
+    {
+        disconnect();
+    }
+
+    void disconnect(void)
+    {
+        for(const QMetaObject::Connection& c: m_connections) {
+            QObject::disconnect(c);
+        }
+        m_connections.clear();
+    }
+
+    qint64 pending(void) const
+    {
+        return m_sink.pushed() - m_acknowledged;
+    }
+
+    QIODevice * const m_input;
+    ReaderSink m_sink;
+    UTF8Validator m_validator;
+    QByteArray m_block;
+    QList<QMetaObject::Connection> m_connections;
+    qint64 m_acknowledged;
+    /*
+     * m_finished: no more data will become available, m_closing: the device is about to be closed, so whatever is left must be read now.
+     * m_paused: reading waits for text to be acknowledged, m_scheduled: a read is due on the next pass of the event loop.
+     * m_reading: guards against re-entry from slots connected to the signals emitted while reading.
+     */
+    bool m_finished, m_closing, m_paused, m_scheduled, m_reading;
+};
+
+UTF8Reader::UTF8Reader(QObject * parent) : QObject(parent), d_ptr(new UTF8ReaderPrivate(TextStream)) {}
+
+UTF8Reader::UTF8Reader(const UTF8Reader::Mode& mode, QObject * parent) : QObject(parent), d_ptr(new UTF8ReaderPrivate(mode)) {}
+
+UTF8Reader::~UTF8Reader()
+{
+    Q_D(UTF8Reader);
+    delete d->m_stream;
+    delete d;
+}
+
+UTF8Reader::Mode UTF8Reader::mode(void) const
+{
+    Q_D(const UTF8Reader);
+    return d->m_mode;
+}
+
+void UTF8Reader::setMode(const UTF8Reader::Mode& mode)
+{
+    Q_D(UTF8Reader);
+    d->m_mode = mode;
+}
+
+UTF8Reader::Recovery UTF8Reader::recovery(void) const
+{
+    Q_D(const UTF8Reader);
+    return d->m_recovery;
+}
+
+void UTF8Reader::setRecovery(const UTF8Reader::Recovery& recovery)
+{
+    Q_D(UTF8Reader);
+    d->m_recovery = recovery;
+}
 
 void UTF8Reader::consume(QIODevice & input) { consume(&input); }
 
+void UTF8Reader::start(QIODevice * input)
+{
+    Q_D(UTF8Reader);
+    stop();
+    ReaderStream * stream = new ReaderStream(this, input, d->m_mode == Vectorised ? UTF8Validator::Vectorised : UTF8Validator::Scalar,
+                                             isSignalConnected(QMetaMethod::fromSignal(&UTF8Reader::pushChunk)),
+                                             isSignalConnected(QMetaMethod::fromSignal(&UTF8Reader::push)) ||
+                                             isSignalConnected(QMetaMethod::fromSignal(&UTF8Reader::pushPair)));
+    d->m_stream = stream;
+    stream->m_connections.append(connect(input, &QIODevice::readyRead, this, &UTF8Reader::readStream));
+    stream->m_connections.append(connect(input, &QIODevice::readChannelFinished, this, [stream, this]() -> void {
+        stream->m_finished = true;
+        readStream();
+    }));
+    stream->m_connections.append(connect(input, &QIODevice::aboutToClose, this, [stream, this]() -> void {
+        stream->m_finished = stream->m_closing = true;
+        readStream();
+    }));
+    stream->m_connections.append(connect(input, &QObject::destroyed, this, [this]() -> void {
+        stop();
+        emit failed();
+    }));
+    // data may be buffered already, and random access devices do not emit readyRead() at all
+    scheduleRead();
+}
+
+void UTF8Reader::stop(void)
+{
+    Q_D(UTF8Reader);
+    ReaderStream * stream = d->m_stream;
+    if(stream) {
+        d->m_stream = 0;
+        stream->disconnect();
+        // if stopped from a slot while reading, the stream is deleted once reading returns
+        if(!stream->m_reading) {
+            delete stream;
+        }
+    }
+}
+
+bool UTF8Reader::isStreaming(void) const
+{
+    Q_D(const UTF8Reader);
+    return d->m_stream != 0;
+}
+
+void UTF8Reader::setMaximumPending(qint64 maximum)
+{
+    Q_D(UTF8Reader);
+    d->m_maximumPending = qMax(Q_INT64_C(0), maximum);
+    // reading may have been paused for want of room which is there now
+    acknowledge(0);
+}
+
+qint64 UTF8Reader::maximumPending(void) const
+{
+    Q_D(const UTF8Reader);
+    return d->m_maximumPending;
+}
+
+qint64 UTF8Reader::pending(void) const
+{
+    Q_D(const UTF8Reader);
+    return d->m_stream ? d->m_stream->pending() : 0;
+}
+
+void UTF8Reader::acknowledge(qint64 count)
+{
+    Q_D(UTF8Reader);
+    ReaderStream * stream = d->m_stream;
+    if(!stream) {
+        return;
+    }
+    stream->m_acknowledged += count;
+    // resuming only once a good part of the window is free avoids reading a sliver of data per acknowledgement
+    if(stream->m_paused && (d->m_maximumPending == 0 || stream->pending() * 2 < d->m_maximumPending)) {
+        stream->m_paused = false;
+        scheduleRead();
+    }
+}
+
+void UTF8Reader::scheduleRead(void)
+{
+    Q_D(UTF8Reader);
+    ReaderStream * stream = d->m_stream;
+    if(stream && !stream->m_scheduled) {
+        stream->m_scheduled = true;
+        QTimer::singleShot(0, this, [stream, this]() -> void {
+            Q_D(UTF8Reader);
+            // the stream may have been stopped (and deleted) in the meantime
+            if(d->m_stream == stream) {
+                stream->m_scheduled = false;
+                readStream();
+            }
+        });
+    }
+}
+
+void UTF8Reader::readStream(void)
+{
+    Q_D(UTF8Reader);
+    ReaderStream * stream = d->m_stream;
+    if(!stream || stream->m_reading) {
+        return;
+    }
+    stream->m_reading = true;
+    for(int blocks = 0; d->m_stream == stream; ++blocks) {
+        if(!stream->m_closing && d->m_maximumPending > 0 && stream->pending() >= d->m_maximumPending) {
+            SDUIKIT_TRACE(utf8Trace) << "Pausing with" << stream->pending() << "characters pending";
+            stream->m_paused = true;
+            break;
+        }
+        if(blocks == blocksPerPass && !stream->m_closing) {
+            scheduleRead();
+            break;
+        }
+        const qint64 read = stream->m_input->read(stream->m_block.data(), blockSize);
+        if(read > 0) {
+            stream->m_validator.feed(stream->m_block.constData(), read, stream->m_sink);
+        }
+        // a sequential device which has nothing to offer right now will emit readyRead() once it does
+        else if(read < 0 || stream->m_finished || !stream->m_input->isSequential()) {
+            finishStream(read == 0);
+        }
+        else {
+            break;
+        }
+    }
+    stream->m_reading = false;
+    if(d->m_stream != stream) {
+        delete stream;
+    }
+}
+
+void UTF8Reader::finishStream(bool ok)
+{
+    Q_D(UTF8Reader);
+    ReaderStream * stream = d->m_stream;
+    stream->m_validator.finish(stream->m_sink);
+    stream->m_sink.flushBadBytes();
+    // detach first: a slot connected to the signals below may well start reading the next input
+    d->m_stream = 0;
+    stream->disconnect();
+    if(!ok) {
+        emit failed();
+    }
+    else {
+        if(stream->m_sink.hasBadBytes()) {
+            emit doneWithInvalidBytes();
+        }
+        else {
+            emit done();
+        }
+    }
+}
+
 void UTF8Reader::consume(QIODevice * input)
+{
+    Q_D(UTF8Reader);
+    switch(d->m_mode) {
+        case Bulk:
+        case Vectorised:
+            consumeBulk(input);
+            break;
+        case TextStream:
+        default:
+            if(d->m_recovery == Lookahead || input->isSequential()) {
+                consumeLookahead(input);
+            }
+            else {
+                consumeTextStream(input);
+            }
+            break;
+    }
+}
+
+void UTF8Reader::consumeBulk(QIODevice * input)
+{
+    Q_D(UTF8Reader);
+    ReaderSink sink(this, input->pos(), isSignalConnected(QMetaMethod::fromSignal(&UTF8Reader::pushChunk)),
+                    isSignalConnected(QMetaMethod::fromSignal(&UTF8Reader::push)) || isSignalConnected(QMetaMethod::fromSignal(&UTF8Reader::pushPair)));
+    UTF8Validator validator(d->m_mode == Vectorised ? UTF8Validator::Vectorised : UTF8Validator::Scalar);
+    QByteArray block((int) blockSize, Qt::Uninitialized);
+    qint64 read;
+
+    while((read = input->read(block.data(), blockSize)) > 0) {
+        validator.feed(block.constData(), read, sink);
+    }
+    validator.finish(sink);
+    sink.flushBadBytes();
+
+    if(read < 0) {
+        emit failed();
+    }
+    else {
+        if(sink.hasBadBytes()) {
+            emit doneWithInvalidBytes();
+        }
+        else {
+            emit done();
+        }
+    }
+}
+
+void UTF8Reader::consumeLookahead(QIODevice * input)
+{
+    const qint64 offset = input->pos();
+    const bool pushChunks = isSignalConnected(QMetaMethod::fromSignal(&UTF8Reader::pushChunk));
+    qint64 count = 0;
+    bool hasBadBytes = false;
+    QByteArray badBytes;
+    LookaheadBuffer lookahead(input);
+    int available;
+
+    while((available = lookahead.ensure(4)) > 0) {
+        const uchar lead = (uchar) lookahead.data()[0];
+        const int length = lead < 0xC0 ? 1 : (lead < 0xE0 ? 2 : (lead < 0xF0 ? 3 : 4));
+        /*
+         * Decode exactly one sequence using Qt's codec, and apply the same checks as the QTextStream based loop:
+         * the sequence is valid only if it decodes to a single character (or surrogate pair) which re-encodes to the same number of bytes.
+         */
+        const QString chars = QString::fromUtf8(lookahead.data(), qMin(length, available));
+        bool valid = false;
+        if(chars.size() == 1 && !chars[0].isSurrogate()) {
+            valid = utf8SequenceLength(chars[0].unicode()) == length;
+        }
+        else if(chars.size() == 2 && chars[0].isHighSurrogate() && chars[1].isLowSurrogate()) {
+            valid = utf8SequenceLength(QChar::surrogateToUcs4(chars[0], chars[1])) == length;
+        }
+
+        if(valid) {
+            if(badBytes.size() > 0) {
+                emit reportBytes(badBytes, count, offset + count);
+                count += badBytes.size();
+                badBytes.clear();
+            }
+            if(pushChunks) {
+                emit pushChunk(chars);
+            }
+            if(chars.size() == 2) {
+                emit pushPair(chars[0], chars[1]);
+            }
+            else {
+                emit push(chars[0]);
+            }
+            count += length;
+            lookahead.advance(length);
+        }
+        else {
+            // resynchronise in place on the next byte: no seeking or re-reading required.
+            SDUIKIT_TRACE(utf8Trace) << "Skipping invalid byte at:" << offset + count + badBytes.size();
+            badBytes.append((char) lead);
+            hasBadBytes = true;
+            lookahead.advance(1);
+        }
+    }
+    if(badBytes.size() > 0) {
+        emit reportBytes(badBytes, count, offset + count);
+    }
+    if(lookahead.error()) {
+        emit failed();
+    }
+    else {
+        if(hasBadBytes) {
+            emit doneWithInvalidBytes();
+        }
+        else {
+            emit done();
+        }
+    }
+}
+
+void UTF8Reader::consumeTextStream(QIODevice * input)
 {
     qint64 count = 0, offset = input->pos(), size, location;
     UTFState utfState = Clear, oldState = Clear;
@@ -41,6 +535,7 @@ void UTF8Reader::consume(QIODevice * input)
     str.setCodec("UTF-8");
     str.setAutoDetectUnicode(false);
     bool fail = false, hasBadBytes = false;
+    const bool pushChunks = isSignalConnected(QMetaMethod::fromSignal(&UTF8Reader::pushChunk));
     char byte;
     QByteArray badBytes;
     
@@ -80,11 +575,17 @@ void UTF8Reader::consume(QIODevice * input)
                     badBytes.clear();
                 }
                 if(oldState == Hi) {
-                    qDebug() << "Pushing hi-lo surrogate pair";
+                    SDUIKIT_TRACE(utf8Trace) << "Pushing hi-lo surrogate pair at:" << offset + count;
+                    if(pushChunks) {
+                        emit pushChunk(QString(hi).append(lo));
+                    }
                     emit pushPair(hi, lo);
                 }
                 else {
-                    qDebug() << "Pushing lo-hi surrogate pair";
+                    SDUIKIT_TRACE(utf8Trace) << "Pushing lo-hi surrogate pair at:" << offset + count;
+                    if(pushChunks) {
+                        emit pushChunk(QString(lo).append(hi));
+                    }
                     emit pushPair(lo, hi);
                 }
                 utfState = Clear;
@@ -101,6 +602,9 @@ void UTF8Reader::consume(QIODevice * input)
                         count += badBytes.size();
                         badBytes.clear();
                     }
+                    if(pushChunks) {
+                        emit pushChunk(QString(chr));
+                    }
                     emit push(chr);
                     count += size;
                     continue;
@@ -151,7 +655,7 @@ void UTF8Reader::consume(QIODevice * input)
         }
     }
     // check if the stream ended with an invalid byte sequence trailing the UTF8 data & report if true.
-    if(badBytes.size() > 1) {
+    if(badBytes.size() > 0) {
         emit reportBytes(badBytes, count, offset + count);
     }
     if(fail) {
@@ -5,6 +5,9 @@
 #include <QChar>
 #include <QIODevice>
 #include <QObject>
+#include <QString>
+
+class UTF8ReaderPrivate;
 
 /**
  * \brief Provides a validating layer on top of a QIODevice for reading UTF8 encoded text.
@@ -12,12 +15,45 @@
  * It is a validating alternative from using e.g. QTextStream directly.
  * \note Qt uses a UTF-16 based scheme for representing characters (QChar) instead of UTF-8. This means that the UTF8Reader may report characters either as 
  * a single QChar or as a surrogate pair of QChar.
+ *
+ * Valid text is reported in runs through #pushChunk(QString). The per-character #push(QChar) and #pushPair(QChar,QChar) signals
+ * are a compatibility layer on top of that: they are only emitted if something is connected to them.
+ *
+ * Input is either consumed in one go (#consume(QIODevice*)), which blocks until the device is exhausted, or streamed from the event loop
+ * (#start(QIODevice*)), which suits slow devices such as pipes, sockets and QProcess.
  */
 class UTF8Reader: public QObject
 {
     Q_OBJECT
+    Q_ENUMS(Mode)
+    Q_ENUMS(Recovery)
 public:
+    /**
+     * \brief selects the strategy used to validate and decode input.
+     */
+    enum Mode {
+        TextStream = 0, /* decode one QChar at a time using Qt's UTF-8 codec, recover from malformed input as selected by #Recovery */
+        Bulk = 1, /* validate blocks of raw bytes read from the QIODevice using a table driven state machine, see UTF8Validator */
+        Vectorised = 2 /* like Bulk, but skip runs of plain ASCII 16 or 32 bytes at a time using SSE2/AVX2 (chosen at runtime) */
+    };
+    /**
+     * \brief selects how TextStream mode recovers from malformed input. Bulk and Vectorised modes never seek.
+     */
+    enum Recovery {
+        Seek = 0, /* decode through QTextStream, seek back into the QIODevice to skip each invalid byte */
+        Lookahead = 1 /* decode from a lookahead buffer owned by the reader, skipping invalid bytes in place */
+    };
     UTF8Reader(QObject * parent = 0);
+    UTF8Reader(const Mode& mode, QObject * parent = 0);
+    virtual ~UTF8Reader();
+    Mode mode(void) const;
+    void setMode(const Mode& mode);
+    /**
+     * \brief the recovery strategy for TextStream mode, defaults to #Seek.
+     * \note Sequential devices (pipes, sockets, QProcess) do not support seeking: #Lookahead is always used for those.
+     */
+    Recovery recovery(void) const;
+    void setRecovery(const Recovery& recovery);
     /**
      * \brief reads UTF-8 encoded text from the given input stream until it is exhausted.
      * This is a convenience flavour of #consume(QIODevice*)
@@ -27,7 +63,50 @@ public:
      * \brief reads UTF-8 encoded text from the given input stream until it is exhausted.
      */
     void consume(QIODevice * input);
+    /**
+     * \brief starts reading UTF-8 encoded text from the given device as it becomes available, without blocking.
+     * Whatever the device has to offer is read whenever it emits readyRead(), a few blocks per pass of the event loop. Input ends when the
+     * read channel of a sequential device is finished (or the device is closed), or when a random access device is at its end;
+     * #done(), #doneWithInvalidBytes() or #failed() is emitted then as usual. Any reading already in progress is stopped first.
+     *
+     * Input is always validated in blocks as in Bulk mode (Vectorised mode is honoured), so a character which straddles two reads is simply
+     * carried over to the next one. If #maximumPending() is set, reading pauses once that much text has been pushed but not acknowledged.
+     * \note The device must outlive streaming, or at least be closed before it is destroyed.
+     */
+    void start(QIODevice * input);
+    /**
+     * \brief stops reading started by #start(QIODevice*). No further signals are emitted for that input.
+     */
+    void stop(void);
+    bool isStreaming(void) const;
+    /**
+     * \brief the amount of text (in QChar) which may be pushed while streaming without being acknowledged through #acknowledge(qint64).
+     * The default is 0, which means reading never pauses.
+     *
+     * This applies backpressure to the producer when downstream consumers fall behind, e.g. a Tokeniser which receives text through a queued
+     * connection from another thread: while reading is paused, data is left to the device, so that (for devices which bound what they buffer,
+     * like sockets with a read buffer size) memory use remains bounded however large the input.
+     */
+    void setMaximumPending(qint64 maximum);
+    qint64 maximumPending(void) const;
+    /**
+     * \brief the amount of text (in QChar) pushed while streaming which was not acknowledged yet.
+     */
+    qint64 pending(void) const;
+public Q_SLOTS:
+    /**
+     * \brief acknowledges that count QChar of the text pushed while streaming were dealt with, see Tokeniser::consumed(int).
+     * Reading resumes once less than half of #maximumPending() remains unacknowledged.
+     */
+    void acknowledge(qint64 count);
 Q_SIGNALS:
+    /**
+     * \brief emitted when a run of valid text is found.
+     * \param chunk the text which was found. A chunk never ends with only half of a surrogate pair.
+     * In Bulk and Vectorised modes a chunk spans everything in between invalid byte sequences, up to the size of the blocks read from the QIODevice.
+     * In TextStream mode every character is reported as a chunk of its own.
+     */
+    void pushChunk(QString chunk);
     /**
      * \brief emitted when a valid character is found.
      * \param c the character which was found. It is guaranteed not to be part of a surrogate pair.
@@ -63,6 +142,18 @@ Q_SIGNALS:
      * \brief emitted when some I/O operation fails (during error recovery, as the result of malformed UTF-8 sequences).
      */
     void recoveryError(qint64 at);
+private:
+    void consumeTextStream(QIODevice * input);
+    void consumeLookahead(QIODevice * input);
+    void consumeBulk(QIODevice * input);
+    void readStream(void);
+    void scheduleRead(void);
+    void finishStream(bool ok);
+private:
+    Q_DISABLE_COPY(UTF8Reader)
+
+    Q_DECLARE_PRIVATE(UTF8Reader)
+    UTF8ReaderPrivate *const d_ptr;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "utf8_validator.h"
+
+/*
+ * Byte classes: each byte is mapped to one of the following classes before being fed to the state machine.
+ * Lead bytes which restrict the range of their first continuation byte (E0, ED, F0, F4) get their own class;
+ * this is how overlong forms, surrogates and code points beyond U+10FFFF are rejected without decoding anything.
+ */
+typedef enum {
+    Ascii = 0,  /* 00..7F */
+    Cont80,     /* 80..8F */
+    Cont90,     /* 90..9F */
+    ContA0,     /* A0..BF */
+    Illegal,    /* C0, C1, F5..FF */
+    Lead2,      /* C2..DF */
+    LeadE0,     /* E0: next byte must be A0..BF */
+    Lead3,      /* E1..EC, EE, EF */
+    LeadED,     /* ED: next byte must be 80..9F */
+    LeadF0,     /* F0: next byte must be 90..BF */
+    Lead4,      /* F1..F3 */
+    LeadF4,     /* F4: next byte must be 80..8F */
+    ByteClasses
+} ByteClass;
+
+typedef enum {
+    Accept = 0,
+    Reject,
+    Need1,
+    Need2,
+    Need2E0,
+    Need2ED,
+    Need3,
+    Need3F0,
+    Need3F4,
+    States
+} ValidatorState;
+
+static const quint8 byteClasses[256] = {
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, /* 00..0F */
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, /* 10..1F */
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, /* 20..2F */
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, /* 30..3F */
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, /* 40..4F */
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, /* 50..5F */
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, /* 60..6F */
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, /* 70..7F */
+     1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1, /* 80..8F */
+     2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2, /* 90..9F */
+     3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3, /* A0..AF */
+     3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3, /* B0..BF */
+     4,  4,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5, /* C0..CF */
+     5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5, /* D0..DF */
+     6,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  8,  7,  7, /* E0..EF */
+     9, 10, 10, 10, 11,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4  /* F0..FF */
+};
+
+static const quint8 transitions[States * ByteClasses] = {
+/*             Ascii   80      90      A0      Ill     Lead2   E0       Lead3   ED       F0       Lead4   F4 */
+/* Accept  */  Accept, Reject, Reject, Reject, Reject, Need1,  Need2E0, Need2,  Need2ED, Need3F0, Need3,  Need3F4,
+/* Reject  */  Reject, Reject, Reject, Reject, Reject, Reject, Reject,  Reject, Reject,  Reject,  Reject, Reject,
+/* Need1   */  Reject, Accept, Accept, Accept, Reject, Reject, Reject,  Reject, Reject,  Reject,  Reject, Reject,
+/* Need2   */  Reject, Need1,  Need1,  Need1,  Reject, Reject, Reject,  Reject, Reject,  Reject,  Reject, Reject,
+/* Need2E0 */  Reject, Reject, Reject, Need1,  Reject, Reject, Reject,  Reject, Reject,  Reject,  Reject, Reject,
+/* Need2ED */  Reject, Need1,  Need1,  Reject, Reject, Reject, Reject,  Reject, Reject,  Reject,  Reject, Reject,
+/* Need3   */  Reject, Need2,  Need2,  Need2,  Reject, Reject, Reject,  Reject, Reject,  Reject,  Reject, Reject,
+/* Need3F0 */  Reject, Reject, Need2,  Need2,  Reject, Reject, Reject,  Reject, Reject,  Reject,  Reject, Reject,
+/* Need3F4 */  Reject, Need2,  Reject, Reject, Reject, Reject, Reject,  Reject, Reject,  Reject,  Reject, Reject
+};
+
+static inline quint8 transition(quint8 state, uchar byte)
+{
+    return transitions[state * ByteClasses + byteClasses[byte]];
+}
+
+UTF8Validator::UTF8Validator(const UTF8Validator::Strategy& strategy) :
+    m_scanAscii(strategy == Vectorised ? vectorisedAsciiScanner() : scanAsciiScalar), m_pendingSize(0), m_offset(0) {}
+
+void UTF8Validator::reset(void)
+{
+    m_pendingSize = 0;
+    m_offset = 0;
+}
+
+qint64 UTF8Validator::offset(void) const
+{
+    return m_offset + m_pendingSize;
+}
+
+/*
+ * Validates data up to the last complete sequence and returns the number of bytes which were reported to the sink.
+ * Any remaining bytes form the (incomplete) start of a multi-byte sequence.
+ */
+qint64 UTF8Validator::scan(const char * data, qint64 length, qint64 base, Sink & sink)
+{
+    const uchar * bytes = reinterpret_cast<const uchar *>(data);
+    qint64 runStart = 0, seqStart = 0, badStart = -1, i = 0;
+    quint8 state = Accept;
+
+    while(i < length) {
+        // fast path: runs of plain ASCII in between well formed sequences
+        if(state == Accept && badStart < 0 && bytes[i] < 0x80) {
+            i += m_scanAscii(bytes + i, length - i);
+            seqStart = i;
+            continue;
+        }
+        state = transition(state, bytes[i]);
+        ++i;
+        if(state == Accept) {
+            if(badStart >= 0) {
+                sink.invalid(data + badStart, seqStart - badStart, base + badStart);
+                badStart = -1;
+                runStart = seqStart;
+            }
+            seqStart = i;
+        }
+        else if(state == Reject) {
+            /*
+             * The sequence starting at seqStart is malformed.
+             * Flag only its leading byte as invalid and resynchronise on the byte immediately after it.
+             */
+            if(badStart < 0) {
+                if(seqStart > runStart) {
+                    sink.valid(data + runStart, seqStart - runStart, base + runStart);
+                }
+                badStart = seqStart;
+            }
+            i = ++seqStart;
+            state = Accept;
+        }
+    }
+
+    if(badStart >= 0) {
+        sink.invalid(data + badStart, seqStart - badStart, base + badStart);
+    }
+    else if(seqStart > runStart) {
+        sink.valid(data + runStart, seqStart - runStart, base + runStart);
+    }
+    return seqStart;
+}
+
+void UTF8Validator::resolvePending(Sink & sink)
+{
+    qint64 consumed = scan(m_pending, m_pendingSize, m_offset, sink);
+    if(consumed > 0) {
+        m_offset += consumed;
+        m_pendingSize -= (int) consumed;
+        for(int i = 0; i < m_pendingSize; ++i) {
+            m_pending[i] = m_pending[i + consumed];
+        }
+    }
+}
+
+void UTF8Validator::feed(const char * data, qint64 length, Sink & sink)
+{
+    qint64 pos = 0;
+    /*
+     * Complete (or reject) a sequence carried over from the previous block first.
+     * This only ever involves a handful of bytes, so simply re-scan the pending buffer for each byte added.
+     */
+    while(m_pendingSize > 0 && pos < length) {
+        m_pending[m_pendingSize++] = data[pos++];
+        resolvePending(sink);
+    }
+    if(pos < length) {
+        qint64 consumed = scan(data + pos, length - pos, m_offset, sink);
+        m_offset += consumed;
+        pos += consumed;
+        // hold back the incomplete sequence at the end of the block
+        while(pos < length) {
+            m_pending[m_pendingSize++] = data[pos++];
+        }
+    }
+}
+
+void UTF8Validator::finish(Sink & sink)
+{
+    /*
+     * What is left is a lead byte followed by too few continuation bytes.
+     * Resynchronising on each byte in turn flags every one of them, so report them in one go.
+     */
+    if(m_pendingSize > 0) {
+        sink.invalid(m_pending, m_pendingSize, m_offset);
+        m_offset += m_pendingSize;
+        m_pendingSize = 0;
+    }
+}
+
+qint64 UTF8Validator::findInvalid(const char * data, qint64 length)
+{
+    const uchar * bytes = reinterpret_cast<const uchar *>(data);
+    qint64 seqStart = 0;
+    quint8 state = Accept;
+    for(qint64 i = 0; i < length; ++i) {
+        state = transition(state, bytes[i]);
+        if(state == Accept) {
+            seqStart = i + 1;
+        }
+        else if(state == Reject) {
+            return seqStart;
+        }
+    }
+    return state == Accept ? -1 : seqStart;
+}
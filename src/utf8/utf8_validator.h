@@ -0,0 +1,85 @@
+#ifndef SD_UIKIT_UTF8_VALIDATOR_H
+#define SD_UIKIT_UTF8_VALIDATOR_H
+
+#include <QtGlobal>
+
+#include "utf8_ascii.h"
+
+/**
+ * \brief A table driven UTF-8 validation engine which works on blocks of raw bytes.
+ * Input is classified using a DFA (one table lookup per byte) rather than being decoded one QChar at a time.
+ * Input may be fed in arbitrarily sized blocks: sequences which straddle a block boundary are carried over internally,
+ * so the engine never needs to seek in (or re-read from) the underlying data source.
+ *
+ * Malformed input is handled the same way as UTF8Reader has always done: when a sequence turns out to be malformed
+ * only its leading byte is flagged as invalid and validation resumes at the very next byte.
+ * Consecutive invalid bytes within a block are reported as a single run. A run may still be reported in parts when it continues
+ * into the next block, or when it ends with an incomplete sequence which is only flagged by #finish(Sink&): sinks which list runs
+ * should merge adjacent ones.
+ *
+ * \note Validation follows RFC 3629: overlong forms, UTF-16 surrogates and code points beyond U+10FFFF are rejected.
+ */
+class UTF8Validator
+{
+public:
+    /**
+     * \brief selects how runs of plain ASCII are skipped. Both strategies produce identical results.
+     */
+    enum Strategy {
+        Scalar = 0, /* inspect every byte */
+        Vectorised = 1 /* skip 16 (SSE2) or 32 (AVX2) bytes per step, depending on the CPU */
+    };
+    /**
+     * \brief Receives the result of validation.
+     * Offsets are relative to the first byte fed to the validator since it was constructed or #reset().
+     */
+    class Sink
+    {
+    public:
+        virtual ~Sink() {}
+        /**
+         * \brief called for a run of well formed UTF-8. A run never ends in the middle of a multi-byte sequence.
+         * \param data the valid bytes. The pointer is only valid for the duration of the call.
+         */
+        virtual void valid(const char * data, qint64 length, qint64 offset) = 0;
+        /**
+         * \brief called for a run of bytes which do not belong to any well formed UTF-8 sequence.
+         * \param data the invalid bytes. The pointer is only valid for the duration of the call.
+         */
+        virtual void invalid(const char * data, qint64 length, qint64 offset) = 0;
+    };
+
+    UTF8Validator(const Strategy& strategy = Scalar);
+    /**
+     * \brief discards any partial sequence carried over from a previous block and resets the offset to 0.
+     */
+    void reset(void);
+    /**
+     * \brief validates the given block of bytes, reporting results to the sink.
+     * A multi-byte sequence which is incomplete at the end of the block is held back until more data is fed or #finish(Sink&) is called.
+     */
+    void feed(const char * data, qint64 length, Sink & sink);
+    /**
+     * \brief signals the end of input: any incomplete sequence still held back is reported as invalid.
+     */
+    void finish(Sink & sink);
+    /**
+     * \brief the number of bytes fed so far, including bytes of an incomplete sequence which is held back.
+     */
+    qint64 offset(void) const;
+    /**
+     * \brief validates a complete buffer in one go.
+     * \return the offset of the first invalid byte, or -1 if the buffer is well formed UTF-8.
+     */
+    static qint64 findInvalid(const char * data, qint64 length);
+private:
+    qint64 scan(const char * data, qint64 length, qint64 base, Sink & sink);
+    void resolvePending(Sink & sink);
+private:
+    AsciiScanner m_scanAscii;
+    char m_pending[4];
+    int m_pendingSize;
+    qint64 m_offset;
+};
+
+#endif